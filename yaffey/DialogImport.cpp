@@ -19,6 +19,22 @@ void DialogImport::on_pushImportDirectory_clicked() {
     done(RESULT_DIRECTORY);
 }
 
+void DialogImport::on_pushImportDirectoryFsConfig_clicked() {
+    done(RESULT_DIRECTORY_FS_CONFIG);
+}
+
+void DialogImport::on_pushImportLayers_clicked() {
+    done(RESULT_LAYERS);
+}
+
+void DialogImport::on_pushImportArchive_clicked() {
+    done(RESULT_ARCHIVE);
+}
+
+void DialogImport::on_pushImportImage_clicked() {
+    done(RESULT_IMAGE);
+}
+
 void DialogImport::on_pushCancel_clicked() {
     done(RESULT_CANCEL);
 }
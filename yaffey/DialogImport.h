@@ -17,12 +17,20 @@ public:
     enum Result {
         RESULT_CANCEL,
         RESULT_FILE,
-        RESULT_DIRECTORY
+        RESULT_DIRECTORY,
+        RESULT_DIRECTORY_FS_CONFIG,
+        RESULT_LAYERS,
+        RESULT_ARCHIVE,
+        RESULT_IMAGE
     };
 
 private slots:
     void on_pushImportFile_clicked();
     void on_pushImportDirectory_clicked();
+    void on_pushImportDirectoryFsConfig_clicked();
+    void on_pushImportLayers_clicked();
+    void on_pushImportArchive_clicked();
+    void on_pushImportImage_clicked();
     void on_pushCancel_clicked();
 
 private:
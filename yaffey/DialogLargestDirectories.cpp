@@ -0,0 +1,59 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "DialogLargestDirectories.h"
+#include "ui_DialogLargestDirectories.h"
+#include "Utils.h"
+
+enum LargestColumn {
+    COLUMN_PATH,
+    COLUMN_SIZE,
+    COLUMN_OBJECTS
+};
+
+DialogLargestDirectories::DialogLargestDirectories(const QList<YaffsItem*>& directories,
+                                                   QWidget* parent) : QDialog(parent),
+                                                                      mUi(new Ui::DialogLargestDirectories),
+                                                                      mDirectories(directories) {
+    mUi->setupUi(this);
+    setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
+    mSelectedItem = NULL;
+
+    //the row's position in the list is kept so the item can be found again
+    for (int i = 0; i < mDirectories.size(); ++i) {
+        const YaffsItem* dir = mDirectories.at(i);
+        QTreeWidgetItem* row = new QTreeWidgetItem(mUi->treeDirectories);
+        row->setText(COLUMN_PATH, dir->getFullPath());
+        row->setText(COLUMN_SIZE, Utils::formatSize(dir->getTotalSize()));
+        row->setText(COLUMN_OBJECTS, QString::number(dir->getTotalCount()));
+        row->setTextAlignment(COLUMN_SIZE, Qt::AlignRight | Qt::AlignVCenter);
+        row->setTextAlignment(COLUMN_OBJECTS, Qt::AlignRight | Qt::AlignVCenter);
+        row->setData(COLUMN_PATH, Qt::UserRole, i);
+    }
+    mUi->treeDirectories->resizeColumnToContents(COLUMN_PATH);
+}
+
+DialogLargestDirectories::~DialogLargestDirectories() {
+    delete mUi;
+}
+
+void DialogLargestDirectories::on_treeDirectories_itemDoubleClicked(QTreeWidgetItem* item, int /*column*/) {
+    int i = item->data(COLUMN_PATH, Qt::UserRole).toInt();
+    mSelectedItem = mDirectories.value(i);
+    accept();
+}
@@ -0,0 +1,50 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef DIALOGLARGESTDIRECTORIES_H
+#define DIALOGLARGESTDIRECTORIES_H
+
+#include <QDialog>
+#include <QTreeWidgetItem>
+
+#include "YaffsItem.h"
+
+namespace Ui {
+    class DialogLargestDirectories;
+}
+
+//lists the directories taking up the most space, double clicking one picks it
+class DialogLargestDirectories : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DialogLargestDirectories(const QList<YaffsItem*>& directories, QWidget* parent = 0);
+    ~DialogLargestDirectories();
+
+    YaffsItem* getSelectedItem() const { return mSelectedItem; }
+
+private slots:
+    void on_treeDirectories_itemDoubleClicked(QTreeWidgetItem* item, int column);
+
+private:
+    Ui::DialogLargestDirectories* mUi;
+    QList<YaffsItem*> mDirectories;
+    YaffsItem* mSelectedItem;
+};
+
+#endif  //DIALOGLARGESTDIRECTORIES_H
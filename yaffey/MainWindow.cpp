@@ -22,12 +22,17 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QListView>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QInputDialog>
+#include <QTimer>
 
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 #include "DialogEditProperties.h"
 #include "DialogFastboot.h"
 #include "DialogImport.h"
+#include "DialogLargestDirectories.h"
 #include "YaffsManager.h"
 #include "YaffsTreeView.h"
 #include "Utils.h"
@@ -36,16 +41,20 @@ static const QString AUTHOR = "DavidPlace";
 static const QString APPNAME = "Yaffey";
 static const QString VERSION = "0.3";
 
-//xml tag names and attributes
-static const char* TAG_MENUITEM = "menuitem";
-static const char* TAG_FILE = "file";
-static const char* TAG_SYMLINK = "symlink";
-static const char* ATTR_NAME = "name";
-static const char* ATTR_ALIAS = "alias";
-static const char* ATTR_DEST = "dest";
-static const char* ATTR_PERMISSIONS = "permissions";
-static const char* ATTR_USER = "user";
-static const char* ATTR_GROUP = "group";
+static const int MAX_LARGEST_DIRECTORIES = 100;
+
+static const QString DEFAULT_FS_CONFIG_MOUNT_POINT = "system";
+
+//in milliseconds, how long a directory import runs before showing its progress and how often it's updated
+static const int IMPORT_PROGRESS_DELAY = 500;
+static const int IMPORT_PROGRESS_INTERVAL = 50;
+
+//searches with more matches than this aren't expanded automatically
+static const int MAX_SEARCH_EXPAND = 1000;
+
+//boxSearchMode lists the name index modes first, then the content searches
+static const int SEARCH_MODE_CONTENTS = 3;
+static const int SEARCH_MODE_CONTENTS_REGEX = 4;
 
 MainWindow::MainWindow(QWidget* parent, QString imageFilename) : QMainWindow(parent),
                                                                  mUi(new Ui::MainWindow),
@@ -56,7 +65,6 @@ MainWindow::MainWindow(QWidget* parent, QString imageFilename) : QMainWindow(par
     //create and connect the signal mapper for dynamic actions and parse dynamic menu xml
     mSignalMapper = new QSignalMapper(this);
     connect(mSignalMapper, SIGNAL(mapped(const QString&)), this, SLOT(on_dynamicActionTriggered(const QString&)));
-    mDoc = NULL;
     parseDynamicMenuXml("files/android-menu.xml");
 
     //setup context menu for the treeview
@@ -79,7 +87,9 @@ MainWindow::MainWindow(QWidget* parent, QString imageFilename) : QMainWindow(par
     mHeaderContextMenu.addAction(mUi->actionColumnUser);
     mHeaderContextMenu.addAction(mUi->actionColumnGroup);
 
-    //get YaffsManager instance and create model
+    //get YaffsManager instance and create model, the view sees it through the search filter
+    mFilterModel = new YaffsFilterProxyModel(this);
+    mSearchQueued = false;
     mYaffsManager = YaffsManager::getInstance();
     newModel();
     updateWindowTitle();
@@ -104,6 +114,10 @@ MainWindow::MainWindow(QWidget* parent, QString imageFilename) : QMainWindow(par
     mUi->treeView->hideColumn(YaffsItem::DATE_CREATED);
     mUi->treeView->hideColumn(YaffsItem::DATE_ACCESSED);
 
+    //images are shown in the order they were read until a column header is clicked
+    headerView->setSortIndicator(-1, Qt::AscendingOrder);
+    mUi->treeView->setSortingEnabled(true);
+
     mUi->actionColumnName->setEnabled(false);
     mUi->actionColumnName->setChecked(!mUi->treeView->isColumnHidden(YaffsItem::NAME));
     mUi->actionColumnSize->setChecked(!mUi->treeView->isColumnHidden(YaffsItem::SIZE));
@@ -116,7 +130,6 @@ MainWindow::MainWindow(QWidget* parent, QString imageFilename) : QMainWindow(par
     mUi->actionColumnGroup->setChecked(!mUi->treeView->isColumnHidden(YaffsItem::GROUP));
 
     connect(headerView, SIGNAL(customContextMenuRequested(QPoint)), SLOT(on_treeViewHeader_customContextMenuRequested(QPoint)));
-    connect(mUi->actionExpandAll, SIGNAL(triggered()), mUi->treeView, SLOT(expandAll()));
     connect(mUi->actionCollapseAll, SIGNAL(triggered()), mUi->treeView, SLOT(collapseAll()));
     connect(mUi->treeView, SIGNAL(selectionChanged()), SLOT(on_treeView_selectionChanged()));
 
@@ -136,17 +149,21 @@ MainWindow::~MainWindow() {
     delete mUi;
     delete mFastbootDialog;
     delete mSignalMapper;
-    delete mDoc;
 }
 
 void MainWindow::newModel() {
     mYaffsModel = mYaffsManager->newModel();
-    mUi->treeView->setModel(mYaffsModel);
+    mFilterModel->setSourceModel(mYaffsModel);
+    mUi->treeView->setModel(mFilterModel);
+    mUi->lineSearch->clear();
+    applySearch();
+    connect(mYaffsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), SLOT(on_modelRowsChanged()));
+    connect(mYaffsModel, SIGNAL(dataChanged(QModelIndex, QModelIndex)), SLOT(on_modelRowsChanged()));
     connect(mYaffsManager, SIGNAL(modelChanged()), SLOT(on_modelChanged()));
 }
 
 void MainWindow::on_treeView_doubleClicked(const QModelIndex& itemIndex) {
-    YaffsItem* item = static_cast<YaffsItem*>(itemIndex.internalPointer());
+    YaffsItem* item = static_cast<YaffsItem*>(mUi->treeView->sourceIndex(itemIndex).internalPointer());
     if (item) {
         if (item->isFile() || item->isSymLink()) {
             mUi->actionEditProperties->trigger();
@@ -210,8 +227,16 @@ void MainWindow::openImage(const QString& imageFilename) {
     if (imageFilename.length() > 0) {
         YaffsReadInfo readInfo = mYaffsModel->openImage(imageFilename);
         if (readInfo.result) {
+            QHeaderView* headerView = mUi->treeView->header();
+            if (headerView->sortIndicatorSection() >= 0) {
+                mYaffsModel->sort(headerView->sortIndicatorSection(), headerView->sortIndicatorOrder());
+            }
+
             QModelIndex rootIndex = mYaffsModel->index(0, 0);
-            mUi->treeView->expand(rootIndex);
+            if (mYaffsModel->canFetchMore(rootIndex)) {
+                mYaffsModel->fetchMore(rootIndex);
+            }
+            mUi->treeView->expand(mFilterModel->mapFromSource(rootIndex));
             mUi->statusBar->showMessage("Opened image: " + imageFilename);
 
             updateWindowTitle();
@@ -264,7 +289,9 @@ void MainWindow::on_actionClose_triggered() {
 }
 
 void MainWindow::on_actionSaveAs_triggered() {
-    if (mYaffsModel->isImageOpen()) {
+    if (mYaffsModel->getNumPendingImports() > 0) {
+        QMessageBox::information(this, "Save Image As", "Wait for the directories being imported to finish first.");
+    } else if (mYaffsModel->isImageOpen()) {
         QString imgName = mYaffsModel->getImageFilename();
         QString saveAsFilename = QFileDialog::getSaveFileName(this, "Save Image As", "./" + imgName);
         if (saveAsFilename.length() > 0) {
@@ -280,7 +307,10 @@ void MainWindow::on_actionSaveAs_triggered() {
                                 "<tr><td colspan=2><hr/></td></tr>" +
                                 "<tr><td width=120>Files Failed:</td><td>" + QString::number(saveInfo.numFilesFailed) + "</td></tr>" +
                                 "<tr><td width=120>Directories Failed:</td><td>" + QString::number(saveInfo.numDirsFailed) + "</td></tr>" +
-                                "<tr><td width=120>SymLinks Failed:</td><td>" + QString::number(saveInfo.numSymLinksFailed) + "</td></tr></td></tr></table>");
+                                "<tr><td width=120>SymLinks Failed:</td><td>" + QString::number(saveInfo.numSymLinksFailed) + "</td></tr>" +
+                                "<tr><td colspan=2><hr/></td></tr>" +
+                                "<tr><td width=120>Files Changed:</td><td>" + QString::number(saveInfo.numFilesRefreshed) + "</td></tr>" +
+                                "<tr><td width=120>Files Missing:</td><td>" + QString::number(saveInfo.numFilesMissing) + "</td></tr></td></tr></table>");
 
                 if (result) {
                     mUi->statusBar->showMessage("Image saved: " + saveAsFilename);
@@ -302,30 +332,199 @@ void MainWindow::on_actionImport_triggered() {
     int result = import.exec();
 
     if (result == DialogImport::RESULT_FILE) {
-        QModelIndex parentIndex = mUi->treeView->selectionModel()->currentIndex();
+        QModelIndex parentIndex = mUi->treeView->currentSourceIndex();
         YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
         if (parentItem && parentItem->isDir()) {
             QStringList fileNames = QFileDialog::getOpenFileNames(this, "Select file(s) to import...");
+            mYaffsModel->beginBatch();
             foreach (QString importFilename, fileNames) {
                 importFilename.replace('\\', '/');
                 mYaffsModel->importFile(parentItem, importFilename);
             }
+            mYaffsModel->endBatch();
         }
-    } else if (result == DialogImport::RESULT_DIRECTORY) {
-        QModelIndex parentIndex = mUi->treeView->selectionModel()->currentIndex();
+    } else if (result == DialogImport::RESULT_DIRECTORY || result == DialogImport::RESULT_DIRECTORY_FS_CONFIG) {
+        QModelIndex parentIndex = mUi->treeView->currentSourceIndex();
         YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
         if (parentItem && parentItem->isDir()) {
             QString directoryName = QFileDialog::getExistingDirectory(this, "Select directory to import...");
             if (directoryName.length() > 0) {
                 directoryName.replace('\\', '/');
-                mYaffsModel->importDirectory(parentItem, directoryName);
+                if (result == DialogImport::RESULT_DIRECTORY) {
+                    importDirectory(parentItem, directoryName, NULL);
+                } else {
+                    YaffsFsConfig fsConfig;
+                    if (loadFsConfig(fsConfig)) {
+                        importDirectory(parentItem, directoryName, &fsConfig);
+                    }
+                }
             }
         }
+    } else if (result == DialogImport::RESULT_LAYERS) {
+        QModelIndex parentIndex = mUi->treeView->currentSourceIndex();
+        YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
+        if (parentItem && parentItem->isDir()) {
+            importLayers(parentItem);
+        }
+    } else if (result == DialogImport::RESULT_ARCHIVE) {
+        QModelIndex parentIndex = mUi->treeView->currentSourceIndex();
+        YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
+        if (parentItem && parentItem->isDir()) {
+            QString archiveFilename = QFileDialog::getOpenFileName(this, "Select archive to import...", QString(),
+                                                                   "Archives (*.tar *.cpio *.img);;All Files (*)");
+            if (archiveFilename.length() > 0) {
+                importArchive(parentItem, archiveFilename);
+            }
+        }
+    } else if (result == DialogImport::RESULT_IMAGE) {
+        QModelIndex parentIndex = mUi->treeView->currentSourceIndex();
+        YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
+        if (parentItem && parentItem->isDir()) {
+            QString imageFilename = QFileDialog::getOpenFileName(this, "Select image to import from...");
+            if (imageFilename.length() > 0) {
+                bool ok = false;
+                QString sourcePath = QInputDialog::getText(this, "Import from Image", "Path of the directory or file to import:",
+                                                           QLineEdit::Normal, "/", &ok);
+                if (ok) {
+                    importFromImage(parentItem, imageFilename, sourcePath);
+                }
+            }
+        }
+    }
+}
+
+//the other image is only open while the items are copied, their data is read from it again when
+//saving so it has to stay where it is until then
+void MainWindow::importFromImage(YaffsItem* parentItem, const QString& imageFilename, const QString& sourcePath) {
+    if (imageFilename.compare(mYaffsModel->getImageFilename()) == 0) {
+        QMessageBox::critical(this, "Error importing from image", "Can't import from the current image, choose another image.");
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    YaffsModel sourceModel;
+    sourceModel.setWriteOptions(mYaffsModel->getWriteOptions());
+    YaffsReadInfo readInfo = sourceModel.openImage(imageFilename);
+    bool found = (readInfo.result && sourceModel.itemAtPath(sourcePath) != NULL);
+    int itemsImported = (found ? mYaffsModel->importFromImage(parentItem, sourceModel, sourcePath) : 0);
+    QApplication::restoreOverrideCursor();
+
+    if (!readInfo.result) {
+        mUi->statusBar->showMessage("Error importing from image: " + imageFilename);
+        QMessageBox::critical(this, "Error importing from image", "Couldn't read " + imageFilename);
+    } else if (!found) {
+        mUi->statusBar->showMessage("Error importing from image: " + imageFilename);
+        QMessageBox::critical(this, "Error importing from image", sourcePath + " isn't in " + imageFilename);
+    } else {
+        mUi->statusBar->showMessage("Imported " + QString::number(itemsImported) + " items from " + imageFilename);
+    }
+}
+
+//the archive has to stay where it is until the image is saved, the file data is read from it then
+//the layers are asked for one at a time from the bottom up until the dialog is cancelled
+void MainWindow::importLayers(YaffsItem* parentItem) {
+    QStringList layerDirNames;
+    forever {
+        QString title = "Select layer " + QString::number(layerDirNames.size() + 1) + " to import (cancel when done)...";
+        QString layerDirName = QFileDialog::getExistingDirectory(this, title);
+        if (layerDirName.length() == 0) {
+            break;
+        }
+        layerDirNames.append(layerDirName);
+    }
+
+    if (layerDirNames.size() > 0) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        YaffsOverlay overlay;
+        bool composed = overlay.compose(layerDirNames);
+        int itemsImported = (composed ? mYaffsModel->importLayers(parentItem, overlay) : 0);
+        QApplication::restoreOverrideCursor();
+
+        if (composed) {
+            mUi->statusBar->showMessage("Imported " + QString::number(itemsImported) + " items from " + QString::number(layerDirNames.size()) +
+                                        " layers, " + QString::number(overlay.getNumReplaced()) + " replaced by a higher layer, " +
+                                        QString::number(overlay.getNumWhiteouts()) + " whiteouts");
+        } else {
+            mUi->statusBar->showMessage("Error importing layers");
+            QMessageBox::critical(this, "Error importing layers", overlay.getError());
+        }
+    }
+}
+
+void MainWindow::importArchive(YaffsItem* parentItem, const QString& archiveFilename) {
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    YaffsArchive archive;
+    bool opened = archive.open(archiveFilename);
+    int itemsImported = (opened ? mYaffsModel->importArchive(parentItem, archive) : 0);
+    QApplication::restoreOverrideCursor();
+
+    if (opened) {
+        int itemsSkipped = archive.getNumSkipped() + archive.getEntries().size() - itemsImported;
+        QString message = "Imported " + QString::number(itemsImported) + " items from " + archiveFilename;
+        if (itemsSkipped > 0) {
+            message += ", " + QString::number(itemsSkipped) + " skipped";
+        }
+        mUi->statusBar->showMessage(message);
+    } else {
+        mUi->statusBar->showMessage("Error importing archive: " + archiveFilename);
+        QMessageBox::critical(this, "Error importing archive", archive.getError());
+    }
+}
+
+//asks for an fs_config file and where the image root is in it
+bool MainWindow::loadFsConfig(YaffsFsConfig& fsConfig) {
+    QString filename = QFileDialog::getOpenFileName(this, "Select fs_config file...");
+    if (filename.length() == 0) {
+        return false;
+    }
+
+    bool ok = false;
+    QString mountPoint = QInputDialog::getText(this, "fs_config", "Path of the image root in the fs_config file:",
+                                               QLineEdit::Normal, DEFAULT_FS_CONFIG_MOUNT_POINT, &ok);
+    if (!ok) {
+        return false;
+    }
+
+    if (!fsConfig.load(filename, mountPoint)) {
+        QMessageBox::critical(this, "fs_config", "Couldn't read " + filename);
+        return false;
+    }
+
+    if (fsConfig.getNumErrors() > 0) {
+        QMessageBox::warning(this, "fs_config", QString::number(fsConfig.getNumErrors()) + " lines in " + filename + " couldn't be read and were skipped");
+    }
+    return true;
+}
+
+//the directory is walked on the thread pool while the progress dialog keeps the window going,
+//the items are only added to the model once the walk has finished
+void MainWindow::importDirectory(YaffsItem* parentItem, const QString& directoryName, const YaffsFsConfig* fsConfig) {
+    YaffsImportWalker walker(directoryName);
+    walker.start();
+
+    QProgressDialog progress("Reading " + directoryName + "...", "Cancel", 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(IMPORT_PROGRESS_DELAY);
+    while (!walker.waitForFinished(IMPORT_PROGRESS_INTERVAL)) {
+        progress.setLabelText("Found " + QString::number(walker.getNumEntries()) + " files and directories...");
+        progress.setValue(0);
+        QApplication::processEvents();
+        if (progress.wasCanceled()) {
+            walker.cancel();
+        }
+    }
+    progress.reset();
+
+    if (walker.isCanceled()) {
+        mUi->statusBar->showMessage("Import cancelled");
+    } else {
+        mYaffsModel->importDirectory(parentItem, walker.getRoot(), fsConfig);
+        mUi->statusBar->showMessage("Imported " + QString::number(walker.getNumEntries()) + " files and directories");
     }
 }
 
 void MainWindow::on_actionExport_triggered() {
-    QModelIndexList selectedRows = mUi->treeView->selectionModel()->selectedRows();
+    QModelIndexList selectedRows = mUi->treeView->selectedSourceRows();
     if (selectedRows.size() > 0) {
         QString path = QFileDialog::getExistingDirectory(this);
         if (path.length() > 0) {
@@ -344,7 +543,7 @@ void MainWindow::on_actionExit_triggered() {
 
 void MainWindow::on_actionRename_triggered() {
     QModelIndex index = mUi->treeView->selectionModel()->currentIndex();
-    YaffsItem* item = static_cast<YaffsItem*>(index.internalPointer());
+    YaffsItem* item = static_cast<YaffsItem*>(mUi->treeView->sourceIndex(index).internalPointer());
     if (item && !item->isRoot()) {
         if (index.column() == YaffsItem::NAME) {
             mUi->treeView->edit(index);
@@ -353,13 +552,20 @@ void MainWindow::on_actionRename_triggered() {
 }
 
 void MainWindow::on_actionDelete_triggered() {
-    QModelIndexList selectedRows = mUi->treeView->selectionModel()->selectedRows();
+    QModelIndexList selectedRows = mUi->treeView->selectedSourceRows();
+    bool contentSearch = (mFilterModel->isFiltering() && mUi->boxSearchMode->currentIndex() >= SEARCH_MODE_CONTENTS);
+    if (contentSearch) {
+        mFilterModel->removeContentMatches(selectedRows);
+    }
     int numRowsDeleted = mYaffsModel->removeRows(selectedRows);
+    if (mFilterModel->isFiltering() && !contentSearch) {
+        applySearch();
+    }
     mUi->statusBar->showMessage("Deleted " + QString::number(numRowsDeleted) + " items");
 }
 
 void MainWindow::on_actionEditProperties_triggered() {
-    QModelIndexList selectedRows = mUi->treeView->selectionModel()->selectedRows();
+    QModelIndexList selectedRows = mUi->treeView->selectedSourceRows();
     if (selectedRows.size() > 0) {
         QDialog* dialog = new DialogEditProperties(*mYaffsModel, selectedRows, this);
         dialog->exec();
@@ -385,6 +591,30 @@ void MainWindow::on_actionAbout_triggered() {
     QMessageBox::information(this, "About " + APPNAME, about);
 }
 
+//directories are populated lazily so everything has to be fetched before the view can expand it
+void MainWindow::on_actionExpandAll_triggered() {
+    mYaffsModel->fetchAll();
+    mUi->treeView->expandAll();
+}
+
+//picking one of the directories selects it in the tree
+void MainWindow::on_actionLargestDirectories_triggered() {
+    DialogLargestDirectories dialog(mYaffsModel->largestDirectories(MAX_LARGEST_DIRECTORIES), this);
+    if (dialog.exec() == QDialog::Accepted) {
+        YaffsItem* item = dialog.getSelectedItem();
+        if (item) {
+            if (mFilterModel->isFiltering()) {
+                mUi->lineSearch->clear();
+                applySearch();
+            }
+            mYaffsModel->fetchItem(item);
+            QModelIndex index = mFilterModel->mapFromSource(mYaffsModel->itemIndex(item));
+            mUi->treeView->scrollTo(index);
+            mUi->treeView->setCurrentIndex(index);
+        }
+    }
+}
+
 void MainWindow::on_actionColumnName_triggered() {
     if (mUi->actionColumnName->isChecked()) {
         mUi->treeView->showColumn(YaffsItem::NAME);
@@ -478,79 +708,75 @@ void MainWindow::on_modelChanged() {
     setupActions();
 }
 
-void MainWindow::on_dynamicActionTriggered(const QString& menuText) {
-    QDomElement docElem = mDoc->documentElement();
-    QDomElement* menuItem = NULL;
+//imported and renamed items have to be checked against a name search too. the name index is only
+//cleared when the tree changes, so rows fetched for the view don't search again. the search waits
+//until the model is done changing, content searches read every file so they wait to be asked
+void MainWindow::on_modelRowsChanged() {
+    if (!mSearchQueued && mFilterModel->isFiltering() && mUi->boxSearchMode->currentIndex() < SEARCH_MODE_CONTENTS &&
+        !mYaffsModel->isNameIndexBuilt()) {
+        mSearchQueued = true;
+        QTimer::singleShot(0, this, SLOT(on_searchQueued()));
+    }
+}
 
-    if (mYaffsModel->isImageOpen()) {
-        QDomNode node = docElem.firstChild();
-        while (!node.isNull()) {
-            QDomElement element = node.toElement();
-            if (!element.isNull() && element.tagName() == TAG_MENUITEM && element.hasAttribute(ATTR_NAME)) {
-                if (element.attribute(ATTR_NAME) == menuText) {
-                    menuItem = &element;
-                    break;
-                }
-            }
-            node = node.nextSibling();
-        }
+void MainWindow::on_searchQueued() {
+    mSearchQueued = false;
+    if (mFilterModel->isFiltering() && mUi->boxSearchMode->currentIndex() < SEARCH_MODE_CONTENTS) {
+        applySearch();
+    }
+}
 
-        //if the menu item element was found and is valid then we're ready to start creating stuff
-        if (menuItem != NULL) {
-            int failCount = 0;
-            int xmlErrorCount = 0;
-
-            QDomNode node = menuItem->firstChild();
-            while (!node.isNull()) {
-                QDomElement element = node.toElement();
-                if (!element.isNull()) {
-                    QString tag = element.tagName();
-                    QString dest = element.attribute(ATTR_DEST);
-                    QString permissions = element.attribute(ATTR_PERMISSIONS);
-                    QString user = element.attribute(ATTR_USER);
-                    QString group = element.attribute(ATTR_GROUP);
-
-                    if (dest.length() > 0 && permissions.length() > 0 && user.length() > 0 && group.length() > 0) {
-                        uint uid = user.toUInt();
-                        uint gid = group.toUInt();
-                        uint perms = permissions.toUInt(0, 8);
-
-                        if (tag == TAG_FILE) {
-                            QString name = element.attribute(ATTR_NAME);
-
-                            if (name.length() > 0) {
-                                YaffsItem* importedFile = mYaffsModel->importFile("files/" + name, dest, uid, gid, perms);
-                                if (importedFile == NULL) {
-                                    failCount++;
-                                }
-                            } else {
-                                xmlErrorCount++;
-                            }
-                        } else if (tag == TAG_SYMLINK) {
-                            QString alias = element.attribute(ATTR_ALIAS);
-
-                            if (alias.length() > 0) {
-                                YaffsItem* newSymLink = mYaffsModel->createSymLink(dest, alias, uid, gid, perms);
-                                if (newSymLink == NULL) {
-                                    failCount++;
-                                }
-                            } else {
-                                xmlErrorCount++;
-                            }
-                        }
-                    } else {
-                        xmlErrorCount++;
-                    }
-                }
-                node = node.nextSibling();
-            }
+void MainWindow::on_lineSearch_textChanged(const QString& /*text*/) {
+    //content searches read every file in the image so they wait for return to be pressed
+    if (mUi->boxSearchMode->currentIndex() < SEARCH_MODE_CONTENTS) {
+        applySearch();
+    }
+}
+
+void MainWindow::on_lineSearch_returnPressed() {
+    applySearch();
+}
+
+void MainWindow::on_boxSearchMode_currentIndexChanged(int /*index*/) {
+    applySearch();
+}
+
+//the search box text is matched against names, or full paths if it has a slash in it,
+//or against the data of the files for the content modes
+void MainWindow::applySearch() {
+    QString pattern = mUi->lineSearch->text();
+    int searchMode = mUi->boxSearchMode->currentIndex();
+    int numMatches;
+    QString found;
 
-            if (failCount > 0) {
-                QMessageBox::critical(this, menuText, "Failed to import " + QString::number(failCount) + " items");
+    if (searchMode >= SEARCH_MODE_CONTENTS) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        numMatches = mFilterModel->setContentSearch(pattern, searchMode == SEARCH_MODE_CONTENTS_REGEX);
+        QApplication::restoreOverrideCursor();
+        found = " matches";
+    } else {
+        numMatches = mFilterModel->setSearch(pattern, static_cast<YaffsNameIndex::MatchMode>(searchMode));
+        found = " items";
+    }
+
+    if (mFilterModel->isFiltering()) {
+        if (numMatches <= MAX_SEARCH_EXPAND) {
+            mUi->treeView->expandAll();
+        }
+        mUi->statusBar->showMessage("Found " + QString::number(numMatches) + found);
+    }
+}
+
+void MainWindow::on_dynamicActionTriggered(const QString& menuText) {
+    if (mYaffsModel->isImageOpen()) {
+        YaffsRecipeInfo recipeInfo;
+        if (mRecipes.apply(mYaffsModel, menuText, recipeInfo)) {
+            if (recipeInfo.numItemsFailed > 0) {
+                QMessageBox::critical(this, menuText, "Failed to import " + QString::number(recipeInfo.numItemsFailed) + " items");
             }
 
-            if (xmlErrorCount > 0) {
-                QMessageBox::critical(this, menuText, QString::number(xmlErrorCount) + " error(s) found in xml");
+            if (recipeInfo.numXmlErrors > 0) {
+                QMessageBox::critical(this, menuText, QString::number(recipeInfo.numXmlErrors) + " error(s) found in xml");
             }
         }
     } else {
@@ -577,35 +803,20 @@ void MainWindow::closeEvent(QCloseEvent* closeEvent) {
 }
 
 void MainWindow::parseDynamicMenuXml(const QString& xmlFilename) {
-    QFile file(xmlFilename);
-    if (file.open(QIODevice::ReadOnly)) {
-        mDoc = new QDomDocument(xmlFilename);
-        if (mDoc->setContent(&file)) {
-            QDomElement docElem = mDoc->documentElement();
-            if (docElem.hasAttribute(ATTR_NAME)) {
-                QMenu* menu = mUi->menuAndroid->addMenu(docElem.attribute(ATTR_NAME));
-
-                QDomNode node = docElem.firstChild();
-                while (!node.isNull()) {
-                    QDomElement element = node.toElement();
-                    if (!element.isNull() && element.tagName() == TAG_MENUITEM && element.hasAttribute(ATTR_NAME)) {
-                        //create new action, add it to the new menu and map the triggered signal
-                        QAction* action = new QAction(element.attribute(ATTR_NAME), NULL);
-                        menu->addAction(action);
-                        connect(action, SIGNAL(triggered()), mSignalMapper, SLOT(map()));
-                        mSignalMapper->setMapping(action, action->text());
-                    }
-                    node = node.nextSibling();
-                }
-            }
+    if (mRecipes.load(xmlFilename)) {
+        QMenu* menu = mUi->menuAndroid->addMenu(mRecipes.getMenuName());
+        foreach (QString name, mRecipes.getNames()) {
+            //create new action, add it to the new menu and map the triggered signal
+            QAction* action = new QAction(name, NULL);
+            menu->addAction(action);
+            connect(action, SIGNAL(triggered()), mSignalMapper, SLOT(map()));
+            mSignalMapper->setMapping(action, action->text());
         }
-
-        file.close();
     }
 }
 
 void MainWindow::exportSelectedItems(const QString& path) {
-    QModelIndexList selectedRows = mUi->treeView->selectionModel()->selectedRows();
+    QModelIndexList selectedRows = mUi->treeView->selectedSourceRows();
     if (selectedRows.size() > 0) {
         YaffsExportInfo* exportInfo = mYaffsManager->exportItems(selectedRows, path);
 
@@ -662,7 +873,7 @@ void MainWindow::exportSelectedItems(const QString& path) {
 void MainWindow::setupActions() {
     updateWindowTitle();
 
-    QModelIndexList selectedRows = mUi->treeView->selectionModel()->selectedRows();
+    QModelIndexList selectedRows = mUi->treeView->selectedSourceRows();
     int selectionFlags = Utils::identifySelectedRows(selectedRows);
     int selectionSize = selectedRows.size();
 
@@ -671,10 +882,12 @@ void MainWindow::setupActions() {
     if (mYaffsModel->index(0, 0).isValid()) {
         mUi->actionExpandAll->setEnabled(true);
         mUi->actionCollapseAll->setEnabled(true);
+        mUi->actionLargestDirectories->setEnabled(true);
         mUi->actionSaveAs->setEnabled(true);
     } else {
         mUi->actionExpandAll->setEnabled(false);
         mUi->actionCollapseAll->setEnabled(false);
+        mUi->actionLargestDirectories->setEnabled(false);
         mUi->actionSaveAs->setEnabled(false);
     }
 
@@ -23,12 +23,13 @@
 #include <QStandardItemModel>
 #include <QMenu>
 #include <QSignalMapper>
-#include <QDomDocument>
 #include <QCloseEvent>
 #include <QSettings>
 
 #include "YaffsModel.h"
 #include "YaffsManager.h"
+#include "YaffsFilterProxyModel.h"
+#include "YaffsRecipes.h"
 
 namespace Ui {
     class MainWindow;
@@ -55,6 +56,8 @@ private slots:
     void on_actionEditProperties_triggered();
     void on_actionAndroidFastboot_triggered();
     void on_actionAbout_triggered();
+    void on_actionExpandAll_triggered();
+    void on_actionLargestDirectories_triggered();
     void on_actionColumnName_triggered();
     void on_actionColumnSize_triggered();
     void on_actionColumnPermissions_triggered();
@@ -68,7 +71,12 @@ private slots:
     void on_treeView_customContextMenuRequested(const QPoint& pos);
     void on_treeView_selectionChanged();
     void on_modelChanged();
+    void on_modelRowsChanged();
+    void on_searchQueued();
     void on_dynamicActionTriggered(const QString& menuText);
+    void on_lineSearch_textChanged(const QString& text);
+    void on_lineSearch_returnPressed();
+    void on_boxSearchMode_currentIndexChanged(int index);
 
 protected:
     void closeEvent(QCloseEvent* closeEvent);
@@ -78,20 +86,28 @@ private:
     void newModel();
     void openImage(const QString& imageFilename);
     void closeImage();
+    void importDirectory(YaffsItem* parentItem, const QString& directoryName, const YaffsFsConfig* fsConfig);
+    bool loadFsConfig(YaffsFsConfig& fsConfig);
+    void importLayers(YaffsItem* parentItem);
+    void importArchive(YaffsItem* parentItem, const QString& archiveFilename);
+    void importFromImage(YaffsItem* parentItem, const QString& imageFilename, const QString& sourcePath);
     void exportSelectedItems(const QString& path);
     void setupActions();
     void updateWindowTitle();
+    void applySearch();
 
 private:
     Ui::MainWindow* mUi;                //owned
     YaffsModel* mYaffsModel;            //not owned
     YaffsManager* mYaffsManager;        //not owned - singleton
+    YaffsFilterProxyModel* mFilterModel;    //owned - parented
     QMenu mContextMenu;
     QMenu mHeaderContextMenu;
     QDialog* mFastbootDialog;           //owned
     QSignalMapper* mSignalMapper;       //owned
-    QDomDocument* mDoc;                 //owned
+    YaffsRecipes mRecipes;
     QSettings mSettings;
+    bool mSearchQueued;
 };
 
 #endif  //MAINWINDOW_H
@@ -19,6 +19,8 @@
 #include <QFile>
 #include <QTime>
 
+#include <time.h>
+
 #include "Utils.h"
 #include "YaffsItem.h"
 
@@ -67,3 +69,51 @@ QString Utils::randomString(int length) {
 
     return str;
 }
+
+//sizes shown to 2 decimal places, done in integer maths as it runs for every visible row
+QString Utils::formatSize(quint64 size) {
+    static const char* const units[] = { " KB", " MB", " GB" };
+    char buf[32];
+    int unit = -1;
+    quint64 hundredths = 0;
+
+    if (size >= 1073741824) {
+        unit = 2;
+        hundredths = (size * 100 + 536870912) / 1073741824;
+    } else if (size >= 1048576) {
+        unit = 1;
+        hundredths = (size * 100 + 524288) / 1048576;
+    } else if (size >= 1024) {
+        unit = 0;
+        hundredths = (size * 100 + 512) / 1024;
+    }
+
+    if (unit >= 0) {
+        qsnprintf(buf, sizeof(buf), "%u.%02u%s", static_cast<uint>(hundredths / 100), static_cast<uint>(hundredths % 100), units[unit]);
+    } else {
+        qsnprintf(buf, sizeof(buf), "%u b", static_cast<uint>(size));
+    }
+    return QString::fromLatin1(buf);
+}
+
+//local time as dd/MM/yyyy hh:mm:ss, written out directly rather than through QDateTime's locale aware formatting
+QString Utils::formatDateTime(uint time) {
+    time_t t = static_cast<time_t>(time);
+    struct tm* tm = localtime(&t);
+    if (tm == NULL) {
+        return QString();
+    }
+
+    char buf[20];
+    int values[] = { tm->tm_mday, tm->tm_mon + 1, (tm->tm_year + 1900) / 100, (tm->tm_year + 1900) % 100, tm->tm_hour, tm->tm_min, tm->tm_sec };
+    static const char separators[] = { '/', '/', 0, ' ', ':', ':', 0 };
+    int pos = 0;
+    for (int i = 0; i < 7; ++i) {
+        buf[pos++] = '0' + (values[i] / 10) % 10;
+        buf[pos++] = '0' + values[i] % 10;
+        if (separators[i]) {
+            buf[pos++] = separators[i];
+        }
+    }
+    return QString::fromLatin1(buf, pos);
+}
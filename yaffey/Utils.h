@@ -32,6 +32,8 @@ public:
     static int identifySelectedRows(const QModelIndexList& selectedRows);
     static bool saveDataToFile(const QString& filename, const char* data, size_t length);
     static QString randomString(int length);
+    static QString formatSize(quint64 size);
+    static QString formatDateTime(uint time);
 };
 
 #endif  //UTILS_H
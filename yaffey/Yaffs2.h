@@ -21,10 +21,16 @@
 
 extern "C" {
     #include "yaffs2/yaffs_packedtags2.h"
+    #include "yaffs2/yaffs_summary.h"
 }
 
 #define CHUNK_SIZE  2048
 #define SPARE_SIZE  64
 #define PAGE_SIZE   (CHUNK_SIZE + SPARE_SIZE)
 
+#define DEFAULT_PAGES_PER_BLOCK     64
+
+//the kernel numbers blocks from 1 when the partition starts at block 0
+#define INTERNAL_BLOCK_OFFSET       1
+
 #endif  //YAFFS_H
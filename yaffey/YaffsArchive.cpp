@@ -0,0 +1,575 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "YaffsArchive.h"
+#include "YaffsGzipDevice.h"
+
+static const int TAR_BLOCK_SIZE = 512;
+static const int MAX_TAR_EXTENSION_SIZE = 1024 * 1024;     //gnu long names, pax headers and cpio symlink targets
+static const int CPIO_HEADER_SIZE = 110;
+static const int CPIO_NUM_FIELDS = 13;
+static const uint MAX_CPIO_NAME_SIZE = 4096;                //PATH_MAX on linux, with the terminating null
+static const char* CPIO_TRAILER = "TRAILER!!!";
+static const int SKIP_BUFFER_SIZE = 65536;
+
+//st_mode file types
+static const uint MODE_TYPE_MASK = 0170000;
+static const uint MODE_FILE = 0100000;
+static const uint MODE_DIRECTORY = 0040000;
+static const uint MODE_SYMLINK = 0120000;
+
+YaffsArchive::YaffsArchive() {
+    mFormat = FORMAT_UNKNOWN;
+    mCompressed = false;
+    mBuffered = false;
+    mPos = 0;
+    mNumSkipped = 0;
+}
+
+//the archive is only read front to back, a gzipped one is inflated on the way
+bool YaffsArchive::open(const QString& filename) {
+    mFilename = filename;
+    mFormat = FORMAT_UNKNOWN;
+    mCompressed = false;
+    mBuffered = false;
+    mPos = 0;
+    mData.clear();
+    mEntries.clear();
+    mFileEntries.clear();
+    mNumSkipped = 0;
+    mError.clear();
+
+    QFile file;
+    bool opened;
+    if (filename == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly);
+    } else {
+        file.setFileName(filename);
+        opened = file.open(QIODevice::ReadOnly);
+    }
+    if (!opened) {
+        mError = "Couldn't open " + filename;
+        return false;
+    }
+    mBuffered = file.isSequential();
+
+    QByteArray magic = file.peek(6);
+    if ((magic.size() >= 4 && memcmp(magic.constData(), "\x28\xb5\x2f\xfd", 4) == 0) ||
+        (magic.size() >= 6 && memcmp(magic.constData(), "\xfd" "7zXZ\0", 6) == 0) ||
+        (magic.size() >= 3 && memcmp(magic.constData(), "BZh", 3) == 0)) {
+        mError = filename + " is compressed with something other than gzip, decompress it first";
+        return false;
+    }
+
+    QIODevice* device = &file;
+    YaffsGzipDevice gzip(&file);
+    if (YaffsGzipDevice::isGzip(magic)) {
+        if (!gzip.open(QIODevice::ReadOnly)) {
+            mError = "Couldn't inflate " + filename + ": " + gzip.errorString();
+            return false;
+        }
+        mCompressed = true;
+        device = &gzip;
+    }
+
+    QByteArray block = device->peek(TAR_BLOCK_SIZE);
+    bool result = false;
+    if (block.size() >= 6 && (memcmp(block.constData(), "070701", 6) == 0 || memcmp(block.constData(), "070702", 6) == 0)) {
+        mFormat = FORMAT_CPIO;
+        result = readCpio(*device);
+    } else if (block.size() == TAR_BLOCK_SIZE && isTarHeader(block.constData())) {
+        mFormat = FORMAT_TAR;
+        result = readTar(*device);
+    } else {
+        mError = filename + " isn't a tar or newc cpio archive";
+    }
+
+    qDebug() << "Archive: " << filename << ", entries: " << mEntries.size() << ", skipped: " << mNumSkipped;
+    return result;
+}
+
+bool YaffsArchive::readTar(QIODevice& device) {
+    char block[TAR_BLOCK_SIZE];
+    QString longName;
+    QString longLinkName;
+    QHash<QByteArray, QByteArray> paxValues;
+
+    qint64 bytesRead;
+    while ((bytesRead = read(device, block, TAR_BLOCK_SIZE)) == TAR_BLOCK_SIZE) {
+        //an empty block marks the end
+        if (block[0] == '\0') {
+            return true;
+        }
+        if (!isTarHeader(block)) {
+            mError = "Bad tar header at offset " + QString::number(mPos - TAR_BLOCK_SIZE);
+            return false;
+        }
+
+        char typeFlag = block[156];
+        qint64 size = parseOctal(block + 124, 12);
+        qint64 offset = mPos;
+        qint64 next = offset + ((size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE) * TAR_BLOCK_SIZE;
+
+        //gnu long names and pax headers describe the entry after them
+        if (typeFlag == 'L' || typeFlag == 'K' || typeFlag == 'x') {
+            QByteArray data = (size <= MAX_TAR_EXTENSION_SIZE ? read(device, size) : QByteArray());
+            if (data.size() != size) {
+                mError = "Bad tar extension header at offset " + QString::number(offset - TAR_BLOCK_SIZE);
+                return false;
+            }
+            if (typeFlag == 'L') {
+                longName = QString::fromUtf8(data.constData());
+            } else if (typeFlag == 'K') {
+                longLinkName = QString::fromUtf8(data.constData());
+            } else if (!parsePax(data, paxValues)) {
+                mError = "Bad pax header at offset " + QString::number(offset - TAR_BLOCK_SIZE);
+                return false;
+            }
+        } else if (typeFlag != 'g') {
+            QString path = parseString(block, 100);
+            if (longName.length() > 0) {
+                path = longName;
+            } else if (memcmp(block + 257, "ustar", 5) == 0 && block[345] != '\0') {
+                path = parseString(block + 345, 155) + "/" + path;
+            }
+            QString linkName = (longLinkName.length() > 0 ? longLinkName : parseString(block + 157, 100));
+
+            YaffsArchiveEntry entry;
+            entry.mode = static_cast<uint>(parseOctal(block + 100, 8)) & 07777;
+            entry.uid = static_cast<uint>(parseOctal(block + 108, 8));
+            entry.gid = static_cast<uint>(parseOctal(block + 116, 8));
+            entry.mtime = static_cast<uint>(parseOctal(block + 136, 12));
+            entry.offset = offset;
+            entry.size = size;
+
+            if (paxValues.contains("path")) {
+                path = QString::fromUtf8(paxValues.value("path"));
+            }
+            if (paxValues.contains("linkpath")) {
+                linkName = QString::fromUtf8(paxValues.value("linkpath"));
+            }
+            if (paxValues.contains("size")) {
+                entry.size = paxValues.value("size").toLongLong();
+                next = offset + ((entry.size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE) * TAR_BLOCK_SIZE;
+            }
+            if (paxValues.contains("mtime")) {
+                entry.mtime = static_cast<uint>(paxValues.value("mtime").toDouble());
+            }
+            if (paxValues.contains("uid")) {
+                entry.uid = paxValues.value("uid").toUInt();
+            }
+            if (paxValues.contains("gid")) {
+                entry.gid = paxValues.value("gid").toUInt();
+            }
+
+            bool ok = cleanPath(path, entry.path);
+            switch (typeFlag) {
+            case '0':
+            case '7':
+            case '\0':
+                entry.type = (path.endsWith('/') ? YAFFS_OBJECT_TYPE_DIRECTORY : YAFFS_OBJECT_TYPE_FILE);
+                break;
+            case '1': {
+                //yaffs hard links are objects the model doesn't show, so the
+                //link becomes another file with the same data
+                QString targetPath;
+                int target = (cleanPath(linkName, targetPath) ? mFileEntries.value(targetPath, -1) : -1);
+                if (target >= 0) {
+                    entry.type = YAFFS_OBJECT_TYPE_FILE;
+                    entry.offset = mEntries.at(target).offset;
+                    entry.size = mEntries.at(target).size;
+                } else {
+                    ok = false;
+                }
+                break;
+            }
+            case '2':
+                entry.type = YAFFS_OBJECT_TYPE_SYMLINK;
+                entry.alias = linkName;
+                entry.size = 0;
+                break;
+            case '5':
+                entry.type = YAFFS_OBJECT_TYPE_DIRECTORY;
+                entry.size = 0;
+                break;
+            default:
+                ok = false;
+                break;
+            }
+
+            if (!ok || (entry.type == YAFFS_OBJECT_TYPE_FILE && entry.size > INT_MAX)) {
+                qDebug() << "Skipped archive entry: " << path;
+                mNumSkipped++;
+            } else if (entry.path.length() > 0) {
+                //a hard link's data was kept with its target
+                if (typeFlag != '1' && entry.type == YAFFS_OBJECT_TYPE_FILE && !keepData(device, entry)) {
+                    return false;
+                }
+                addEntry(entry);
+            }
+
+            longName.clear();
+            longLinkName.clear();
+            paxValues.clear();
+        }
+
+        if (!skipTo(device, next)) {
+            mError = "Unexpected end of archive";
+            return false;
+        }
+    }
+
+    //plenty of archives just stop after the last entry
+    if (bytesRead == 0) {
+        return true;
+    }
+    mError = "Unexpected end of archive";
+    return false;
+}
+
+bool YaffsArchive::readCpio(QIODevice& device) {
+    //newc keeps the data of a hard linked file with the last of its links
+    QHash<quint64, QList<int> > hardLinks;
+
+    char header[CPIO_HEADER_SIZE];
+    while (read(device, header, CPIO_HEADER_SIZE) == CPIO_HEADER_SIZE) {
+        qint64 headerOffset = mPos - CPIO_HEADER_SIZE;
+        uint fields[CPIO_NUM_FIELDS];
+        bool ok = (memcmp(header, "070701", 6) == 0 || memcmp(header, "070702", 6) == 0);
+        for (int i = 0; i < CPIO_NUM_FIELDS && ok; ++i) {
+            ok = parseHex(header + 6 + (i * 8), fields[i]);
+        }
+        //the name and a symlink's target are read into memory, so their sizes can't be trusted
+        uint nameSize = fields[11];
+        ok = (ok && nameSize > 0 && nameSize <= MAX_CPIO_NAME_SIZE);
+        ok = (ok && ((fields[1] & MODE_TYPE_MASK) != MODE_SYMLINK || fields[6] <= static_cast<uint>(MAX_TAR_EXTENSION_SIZE)));
+        QByteArray name = (ok ? read(device, nameSize) : QByteArray());
+        if (!ok || static_cast<uint>(name.size()) != nameSize) {
+            mError = "Bad cpio header at offset " + QString::number(headerOffset);
+            return false;
+        }
+        if (strcmp(name.constData(), CPIO_TRAILER) == 0) {
+            return true;
+        }
+
+        //the name and the data are both padded to four bytes
+        qint64 offset = (mPos + 3) & ~3LL;
+        qint64 size = fields[6];
+        qint64 next = (offset + size + 3) & ~3LL;
+
+        YaffsArchiveEntry entry;
+        QString path = QString::fromUtf8(name.constData());
+        uint mode = fields[1];
+        entry.mode = mode & 07777;
+        entry.uid = fields[2];
+        entry.gid = fields[3];
+        entry.mtime = fields[5];
+        entry.offset = offset;
+        entry.size = size;
+
+        ok = cleanPath(path, entry.path);
+        switch (mode & MODE_TYPE_MASK) {
+        case MODE_FILE:
+            entry.type = YAFFS_OBJECT_TYPE_FILE;
+            break;
+        case MODE_DIRECTORY:
+            entry.type = YAFFS_OBJECT_TYPE_DIRECTORY;
+            break;
+        case MODE_SYMLINK:
+            entry.type = YAFFS_OBJECT_TYPE_SYMLINK;
+            entry.size = 0;
+            if (skipTo(device, offset)) {
+                entry.alias = QString::fromUtf8(read(device, size));
+            }
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (!ok || (entry.type == YAFFS_OBJECT_TYPE_FILE && size > INT_MAX)) {
+            qDebug() << "Skipped archive entry: " << path;
+            mNumSkipped++;
+        } else if (entry.path.length() > 0) {
+            if (entry.type == YAFFS_OBJECT_TYPE_FILE && !skipTo(device, offset)) {
+                break;
+            }
+            if (entry.type == YAFFS_OBJECT_TYPE_FILE && !keepData(device, entry)) {
+                return false;
+            }
+
+            int nlink = fields[4];
+            if (entry.type == YAFFS_OBJECT_TYPE_FILE && nlink > 1) {
+                quint64 key = (static_cast<quint64>(fields[7]) << 48) ^ (static_cast<quint64>(fields[8]) << 32) ^ fields[0];
+                QList<int>& links = hardLinks[key];
+                if (size > 0) {
+                    foreach (int index, links) {
+                        mEntries[index].offset = entry.offset;
+                        mEntries[index].size = size;
+                    }
+                }
+                links.append(mEntries.size());
+            }
+            addEntry(entry);
+        }
+
+        if (!skipTo(device, next)) {
+            break;
+        }
+    }
+
+    mError = "Unexpected end of archive";
+    return false;
+}
+
+//reads keep count of where they are in the archive, the device may not know
+qint64 YaffsArchive::read(QIODevice& device, char* data, qint64 size) {
+    qint64 total = 0;
+    while (total < size) {
+        qint64 bytesRead = device.read(data + total, size - total);
+        if (bytesRead <= 0) {
+            break;
+        }
+        total += bytesRead;
+    }
+    mPos += total;
+    return total;
+}
+
+//sizes a QByteArray can't hold read nothing
+QByteArray YaffsArchive::read(QIODevice& device, qint64 size) {
+    if (size < 0 || size > INT_MAX) {
+        return QByteArray();
+    }
+    QByteArray data(static_cast<int>(size), '\0');
+    data.truncate(static_cast<int>(read(device, data.data(), size)));
+    return data;
+}
+
+//a plain file is seeked, anything else is read through as it can only be read once
+bool YaffsArchive::skipTo(QIODevice& device, qint64 pos) {
+    if (!device.isSequential()) {
+        if (pos > device.size() || !device.seek(pos)) {
+            return false;
+        }
+        mPos = pos;
+        return true;
+    }
+
+    char buffer[SKIP_BUFFER_SIZE];
+    while (mPos < pos) {
+        qint64 size = qMin<qint64>(pos - mPos, SKIP_BUFFER_SIZE);
+        if (read(device, buffer, size) != size) {
+            return false;
+        }
+    }
+    return (mPos == pos);
+}
+
+//a file's data is read from the archive again when saving, unless the archive came down a
+//pipe. then the data is kept now, and the entry's offset is where it is in mData
+bool YaffsArchive::keepData(QIODevice& device, YaffsArchiveEntry& entry) {
+    if (mBuffered) {
+        int dataPos = mData.size();
+        if (entry.size > INT_MAX - dataPos) {
+            mError = "The files in an archive read from a pipe have to fit in 2GB";
+            return false;
+        }
+
+        mData.resize(dataPos + static_cast<int>(entry.size));
+        if (read(device, mData.data() + dataPos, entry.size) != entry.size) {
+            mError = "Unexpected end of archive";
+            return false;
+        }
+        entry.offset = dataPos;
+    }
+    return true;
+}
+
+void YaffsArchive::addEntry(const YaffsArchiveEntry& entry) {
+    if (entry.type == YAFFS_OBJECT_TYPE_FILE) {
+        mFileEntries.insert(entry.path, mEntries.size());
+    }
+    mEntries.append(entry);
+}
+
+//records are "length key=value\n" with the length counting the whole record
+bool YaffsArchive::parsePax(const QByteArray& data, QHash<QByteArray, QByteArray>& values) {
+    int pos = 0;
+    while (pos < data.size()) {
+        int space = data.indexOf(' ', pos);
+        bool ok = false;
+        int length = (space > pos ? data.mid(pos, space - pos).toInt(&ok) : 0);
+        if (!ok || length <= space - pos + 1 || pos + length > data.size()) {
+            return false;
+        }
+
+        QByteArray record = data.mid(space + 1, pos + length - space - 2);
+        int equals = record.indexOf('=');
+        if (equals < 0) {
+            return false;
+        }
+        values.insert(record.left(equals), record.mid(equals + 1));
+        pos += length;
+    }
+    return true;
+}
+
+//the checksum is the sum of the header bytes with its own field taken as spaces, some
+//old versions of tar summed them as signed chars
+bool YaffsArchive::isTarHeader(const char* block) {
+    int unsignedSum = 0;
+    int signedSum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; ++i) {
+        char c = (i >= 148 && i < 156 ? ' ' : block[i]);
+        unsignedSum += static_cast<uchar>(c);
+        signedSum += static_cast<signed char>(c);
+    }
+    qint64 checksum = parseOctal(block + 148, 8);
+    return (checksum == unsignedSum || checksum == signedSum);
+}
+
+QString YaffsArchive::parseString(const char* field, int length) {
+    return QString::fromUtf8(field, static_cast<int>(strnlen(field, length)));
+}
+
+//octal with optional leading spaces, or base 256 when the top bit is set for values too big for it
+qint64 YaffsArchive::parseOctal(const char* field, int length) {
+    qint64 value = 0;
+    if (static_cast<uchar>(field[0]) & 0x80) {
+        value = static_cast<uchar>(field[0]) & 0x7f;
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | static_cast<uchar>(field[i]);
+        }
+        return value;
+    }
+
+    int i = 0;
+    while (i < length && field[i] == ' ') {
+        ++i;
+    }
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = (value << 3) | (field[i] - '0');
+    }
+    return value;
+}
+
+bool YaffsArchive::parseHex(const char* field, uint& value) {
+    bool ok = false;
+    value = QByteArray(field, 8).toUInt(&ok, 16);
+    return ok;
+}
+
+//paths are made relative to the directory being imported into, anything
+//that would climb out of it is refused
+bool YaffsArchive::cleanPath(const QString& path, QString& cleanedPath) {
+    QStringList names;
+    foreach (const QString& name, path.split('/', QString::SkipEmptyParts)) {
+        if (name == "..") {
+            return false;
+        } else if (name != ".") {
+            names.append(name);
+        }
+    }
+    cleanedPath = names.join("/");
+    return true;
+}
+
+YaffsArchiveReader::YaffsArchiveReader(const QString& filename) {
+    mFile = new QFile(filename);
+    mGzip = NULL;
+    mMapped = NULL;
+    mSize = 0;
+    mPos = 0;
+
+    if (mFile->open(QIODevice::ReadOnly)) {
+        if (YaffsGzipDevice::isGzip(mFile->peek(2))) {
+            mGzip = new YaffsGzipDevice(mFile);
+            mGzip->open(QIODevice::ReadOnly);
+        } else {
+            mSize = mFile->size();
+            mMapped = (mSize > 0 ? mFile->map(0, mSize) : NULL);
+        }
+    }
+}
+
+YaffsArchiveReader::~YaffsArchiveReader() {
+    delete mGzip;
+    delete mFile;
+}
+
+//the data is valid until the next read, NULL if it isn't all there
+const char* YaffsArchiveReader::read(qint64 offset, qint64 size) {
+    if (offset < 0 || size < 0 || size > INT_MAX) {
+        return NULL;
+    }
+
+    if (mMapped) {
+        return (offset + size <= mSize ? reinterpret_cast<const char*>(mMapped) + offset : NULL);
+    }
+
+    QIODevice* device = (mGzip ? static_cast<QIODevice*>(mGzip) : static_cast<QIODevice*>(mFile));
+    if (!device->isOpen()) {
+        return NULL;
+    }
+
+    if (mGzip) {
+        if (offset < mPos && !rewind()) {
+            return NULL;
+        }
+
+        char buffer[SKIP_BUFFER_SIZE];
+        while (mPos < offset) {
+            qint64 bytesRead = mGzip->read(buffer, qMin<qint64>(offset - mPos, SKIP_BUFFER_SIZE));
+            if (bytesRead <= 0) {
+                return NULL;
+            }
+            mPos += bytesRead;
+        }
+    } else if (!mFile->seek(offset)) {
+        return NULL;
+    }
+
+    mBuffer.resize(static_cast<int>(size));
+    qint64 total = 0;
+    while (total < size) {
+        qint64 bytesRead = device->read(mBuffer.data() + total, size - total);
+        if (bytesRead <= 0) {
+            break;
+        }
+        total += bytesRead;
+    }
+    mPos = (mGzip ? mPos + total : offset + total);
+    return (total == size ? mBuffer.constData() : NULL);
+}
+
+//inflating starts again from the beginning of the file
+bool YaffsArchiveReader::rewind() {
+    qDebug() << "Rewinding " << mFile->fileName();
+    mGzip->close();
+    mPos = 0;
+    return (mFile->seek(0) && mGzip->open(QIODevice::ReadOnly));
+}
@@ -0,0 +1,123 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSARCHIVE_H
+#define YAFFSARCHIVE_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+
+#include "Yaffs2.h"
+
+class QFile;
+class QIODevice;
+class YaffsGzipDevice;
+
+//an entry of an archive, files only know where their data is in it
+struct YaffsArchiveEntry {
+    QString path;                       //without any leading ./ or /
+    yaffs_obj_type type;
+    uint mode;                          //permission bits only
+    uint uid;
+    uint gid;
+    uint mtime;
+    qint64 offset;                      //of the file's data in the archive, after inflating it
+    qint64 size;
+    QString alias;                      //symlinks
+};
+
+//reads the headers of a tar or newc cpio archive without unpacking anything, the file data
+//is read straight out of the archive when the image is saved so it has to stay where it is.
+//the archive can be gzipped and is read front to back, so it can also come from stdin ("-").
+//stdin can't be read a second time, so the data of its files is kept instead, see getData()
+class YaffsArchive {
+public:
+    enum Format {
+        FORMAT_UNKNOWN,
+        FORMAT_TAR,
+        FORMAT_CPIO
+    };
+
+    YaffsArchive();
+
+    bool open(const QString& filename);
+    QString getFilename() const { return mFilename; }
+    Format getFormat() const { return mFormat; }
+    bool isCompressed() const { return mCompressed; }
+    bool isBuffered() const { return mBuffered; }
+    const QByteArray& getData() const { return mData; }
+    const QList<YaffsArchiveEntry>& getEntries() const { return mEntries; }
+    int getNumSkipped() const { return mNumSkipped; }
+    QString getError() const { return mError; }
+
+private:
+    bool readTar(QIODevice& device);
+    bool readCpio(QIODevice& device);
+    qint64 read(QIODevice& device, char* data, qint64 size);
+    QByteArray read(QIODevice& device, qint64 size);
+    bool skipTo(QIODevice& device, qint64 pos);
+    bool keepData(QIODevice& device, YaffsArchiveEntry& entry);
+    void addEntry(const YaffsArchiveEntry& entry);
+    static bool parsePax(const QByteArray& data, QHash<QByteArray, QByteArray>& values);
+    static bool isTarHeader(const char* block);
+    static QString parseString(const char* field, int length);
+    static qint64 parseOctal(const char* field, int length);
+    static bool parseHex(const char* field, uint& value);
+    static bool cleanPath(const QString& path, QString& cleanedPath);
+
+private:
+    QString mFilename;
+    Format mFormat;
+    bool mCompressed;
+    bool mBuffered;                     //read from a pipe, the file data is kept in mData
+    qint64 mPos;                        //in the inflated archive
+    QByteArray mData;
+    QList<YaffsArchiveEntry> mEntries;
+    QHash<QString, int> mFileEntries;   //path to entry for files, for hard links to find their data
+    int mNumSkipped;                    //devices, fifos and anything else yaffs can't hold
+    QString mError;
+};
+
+//reads the data of archive files back when the image is saved. a plain archive is mapped,
+//a gzipped one is inflated again as it's read and only starts over from the beginning when
+//asked for data before what it last read, so it's quickest asked in the archive's order
+class YaffsArchiveReader {
+public:
+    YaffsArchiveReader(const QString& filename);
+    ~YaffsArchiveReader();
+
+    const char* read(qint64 offset, qint64 size);
+
+private:
+    YaffsArchiveReader(const YaffsArchiveReader&);
+    YaffsArchiveReader& operator=(const YaffsArchiveReader&);
+
+    bool rewind();
+
+private:
+    QFile* mFile;
+    YaffsGzipDevice* mGzip;
+    const uchar* mMapped;
+    qint64 mSize;
+    qint64 mPos;                        //in the inflated archive
+    QByteArray mBuffer;                 //what read() last returned, for archives that aren't mapped
+};
+
+#endif  //YAFFSARCHIVE_H
@@ -0,0 +1,140 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "YaffsArena.h"
+
+static const size_t BLOCK_SIZE = 64 * 1024;
+static const size_t ALIGNMENT = sizeof(void*);
+static const int MIN_INTERN_TABLE_SIZE = 1024;
+static const size_t MAX_FREE_LIST_SIZE = 256;
+
+YaffsArena::YaffsArena() {
+    mBlockPos = NULL;
+    mBlockRemaining = 0;
+    mBytesAllocated = 0;
+    mInternCount = 0;
+    mFreeLists.fill(NULL, MAX_FREE_LIST_SIZE / ALIGNMENT + 1);
+}
+
+YaffsArena::~YaffsArena() {
+    foreach (char* block, mBlocks) {
+        free(block);
+    }
+}
+
+void* YaffsArena::allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size > 0 && size <= MAX_FREE_LIST_SIZE) {
+        void*& freeList = mFreeLists[size / ALIGNMENT];
+        if (freeList) {
+            void* result = freeList;
+            freeList = *static_cast<void**>(result);
+            mBytesAllocated += size;
+            return result;
+        }
+    }
+
+    if (size > mBlockRemaining) {
+        //anything bigger than a block gets a block of its own
+        size_t blockSize = (size > BLOCK_SIZE ? size : BLOCK_SIZE);
+        char* block = static_cast<char*>(malloc(blockSize));
+        if (block == NULL) {
+            return NULL;
+        }
+        mBlocks.append(block);
+        mBlockPos = block;
+        mBlockRemaining = blockSize;
+    }
+
+    void* result = mBlockPos;
+    mBlockPos += size;
+    mBlockRemaining -= size;
+    mBytesAllocated += size;
+    return result;
+}
+
+//bigger blocks aren't worth tracking and just stay where they are until the arena goes
+void YaffsArena::release(void* ptr, size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (ptr && size > 0 && size <= MAX_FREE_LIST_SIZE) {
+        void*& freeList = mFreeLists[size / ALIGNMENT];
+        *static_cast<void**>(ptr) = freeList;
+        freeList = ptr;
+        mBytesAllocated -= size;
+    }
+}
+
+//return a shared copy of the string, identical strings are only stored once
+const char* YaffsArena::intern(const char* str, size_t length) {
+    if (mInternCount * 2 >= mInternTable.size()) {
+        growInternTable();
+    }
+
+    int mask = mInternTable.size() - 1;
+    int slot = hash(str, length) & mask;
+    const char* entry;
+    while ((entry = mInternTable.at(slot)) != NULL) {
+        if (strncmp(entry, str, length) == 0 && entry[length] == '\0') {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    char* copy = static_cast<char*>(allocate(length + 1));
+    if (copy) {
+        memcpy(copy, str, length);
+        copy[length] = '\0';
+        mInternTable[slot] = copy;
+        mInternCount++;
+    }
+    return copy;
+}
+
+const char* YaffsArena::intern(const char* str) {
+    return intern(str, strlen(str));
+}
+
+uint YaffsArena::hash(const char* str, size_t length) {
+    //FNV-1a
+    uint h = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(str[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void YaffsArena::growInternTable() {
+    int newSize = (mInternTable.size() > 0 ? mInternTable.size() * 2 : MIN_INTERN_TABLE_SIZE);
+    QVector<const char*> oldTable = mInternTable;
+    mInternTable.fill(NULL, newSize);
+
+    int mask = newSize - 1;
+    foreach (const char* entry, oldTable) {
+        if (entry) {
+            int slot = hash(entry, strlen(entry)) & mask;
+            while (mInternTable.at(slot) != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            mInternTable[slot] = entry;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSARENA_H
+#define YAFFSARENA_H
+
+#include <QList>
+#include <QVector>
+
+#include <stddef.h>
+
+//bump allocator for the model's items and strings, everything it hands out
+//is released together when the arena is destroyed. small blocks given back
+//with release() are kept on free lists and handed out again by allocate()
+class YaffsArena {
+public:
+    YaffsArena();
+    ~YaffsArena();
+
+    void* allocate(size_t size);
+    void release(void* ptr, size_t size);
+    const char* intern(const char* str, size_t length);
+    const char* intern(const char* str);
+
+    size_t getBytesAllocated() const { return mBytesAllocated; }
+
+    static uint hash(const char* str, size_t length);
+
+private:
+    YaffsArena(const YaffsArena&);
+    YaffsArena& operator=(const YaffsArena&);
+
+    void growInternTable();
+
+private:
+    QList<char*> mBlocks;
+    char* mBlockPos;
+    size_t mBlockRemaining;
+    size_t mBytesAllocated;
+    QVector<void*> mFreeLists;              //one list per aligned size, linked through the first word
+    QVector<const char*> mInternTable;      //open addressing, NULL for empty slots
+    int mInternCount;
+};
+
+#endif  //YAFFSARENA_H
@@ -0,0 +1,412 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+
+#include <string.h>
+
+#include "YaffsCheckpoint.h"
+
+//sizes of the kernel checkpoint structures
+static const int VALIDITY_SIZE = 16;
+static const int DEVICE_SIZE = 36;
+static const int BLOCK_INFO_SIZE = 8;
+static const int OBJECT_SIZE = 32;
+static const int MIN_TNODE_SIZE = 32;
+static const u32 END_MARKER = 0xffffffff;
+
+YaffsCheckpoint::YaffsCheckpoint(int pagesPerBlock, int numBlocks) {
+    mPagesPerBlock = pagesPerBlock;
+    mAllocBlock = -1;
+    mAllocPage = 0;
+    mSeqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER;
+
+    YaffsCheckpointBlock emptyBlock;
+    emptyBlock.state = YAFFS_BLOCK_STATE_EMPTY;
+    emptyBlock.pagesInUse = 0;
+    emptyBlock.seqNumber = 0;
+    emptyBlock.hasSummary = false;
+    mBlocks.fill(emptyBlock, numBlocks);
+
+    //tnode entries must be wide enough to hold any chunk number on the device, rounded up to an even number of bits
+    u32 chunks = pagesPerBlock * (numBlocks + INTERNAL_BLOCK_OFFSET);
+    int bits = 0;
+    while ((1u << bits) < chunks && bits < 32) {
+        bits++;
+    }
+    if (bits & 1) {
+        bits++;
+    }
+    mTnodeWidth = (bits < 16 ? 16 : bits);
+    mTnodeSize = (mTnodeWidth * YAFFS_NTNODES_LEVEL0) / 8;
+    if (mTnodeSize < MIN_TNODE_SIZE) {
+        mTnodeSize = MIN_TNODE_SIZE;
+    }
+}
+
+void YaffsCheckpoint::setAllocation(int allocBlock, int allocPage, u32 seqNumber) {
+    mAllocBlock = allocBlock;
+    mAllocPage = allocPage;
+    mSeqNumber = seqNumber;
+}
+
+void YaffsCheckpoint::setObjects(const QVector<YaffsCheckpointObject>& objects, const QVector<int>& dataPages) {
+    mObjects = objects;
+    mDataPages = dataPages;
+}
+
+QByteArray YaffsCheckpoint::build() const {
+    QByteArray data;
+    appendValidity(data, true);
+    appendDevice(data);
+
+    for (int i = 0; i < mObjects.size(); ++i) {
+        const YaffsCheckpointObject& object = mObjects.at(i);
+        appendObject(data, object);
+        if (object.type == YAFFS_OBJECT_TYPE_FILE) {
+            appendTnodes(data, object);
+        }
+    }
+
+    //end of the object list
+    QByteArray endMarker(OBJECT_SIZE, static_cast<char>(0xff));
+    data.append(endMarker);
+    data[data.size() - OBJECT_SIZE] = static_cast<char>(OBJECT_SIZE);
+    data[data.size() - OBJECT_SIZE + 1] = 0;
+    data[data.size() - OBJECT_SIZE + 2] = 0;
+    data[data.size() - OBJECT_SIZE + 3] = 0;
+
+    appendValidity(data, false);
+    appendU32(data, checksum(data.constData(), data.size()));
+    return data;
+}
+
+bool YaffsCheckpoint::parse(const QByteArray& data) {
+    const char* pos = data.constData();
+    const char* end = pos + data.size();
+
+    mObjects.clear();
+    mDataPages.clear();
+
+    bool result = parseValidity(pos, end, true) &&
+                  parseDevice(pos, end) &&
+                  parseObjects(pos, end) &&
+                  parseValidity(pos, end, false);
+
+    if (result) {
+        if (pos + 4 <= end) {
+            u32 sum = checksum(data.constData(), static_cast<int>(pos - data.constData()));
+            result = (readU32(pos) == sum);
+            if (!result) {
+                qDebug() << "Checkpoint checksum mismatch";
+            }
+        } else {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+void YaffsCheckpoint::appendValidity(QByteArray& data, bool head) const {
+    appendU32(data, VALIDITY_SIZE);
+    appendU32(data, YAFFS_MAGIC);
+    appendU32(data, YAFFS_CHECKPOINT_VERSION);
+    appendU32(data, head ? 1 : 0);
+}
+
+void YaffsCheckpoint::appendDevice(QByteArray& data) const {
+    int numErasedBlocks = 0;
+    for (int i = 0; i < mBlocks.size(); ++i) {
+        if (mBlocks.at(i).state == YAFFS_BLOCK_STATE_EMPTY) {
+            numErasedBlocks++;
+        }
+    }
+
+    int numFreeChunks = numErasedBlocks * mPagesPerBlock;
+    if (mAllocBlock >= 0) {
+        numFreeChunks += mPagesPerBlock - mAllocPage;
+    }
+
+    appendU32(data, DEVICE_SIZE);
+    appendU32(data, numErasedBlocks);
+    appendU32(data, mAllocBlock >= 0 ? mAllocBlock + INTERNAL_BLOCK_OFFSET : -1);
+    appendU32(data, mAllocPage);
+    appendU32(data, numFreeChunks);
+    appendU32(data, 0);         //deleted files
+    appendU32(data, 0);         //unlinked files
+    appendU32(data, 0);         //background deletions
+    appendU32(data, mSeqNumber);
+
+    //block info, bit fields packed as gcc lays them out
+    for (int i = 0; i < mBlocks.size(); ++i) {
+        const YaffsCheckpointBlock& block = mBlocks.at(i);
+        u32 bits = ((block.pagesInUse & 0x3ff) << 10) | ((block.state & 0xf) << 20) | (block.hasSummary ? (1u << 30) : 0);
+        appendU32(data, bits);
+        appendU32(data, block.seqNumber);
+    }
+
+    //chunk in use bitmap, pages are always used from the start of a block
+    int stride = (mPagesPerBlock + 7) / 8;
+    QByteArray bitmap(stride, 0);
+    for (int i = 0; i < mBlocks.size(); ++i) {
+        bitmap.fill(0);
+        int pagesInUse = mBlocks.at(i).pagesInUse;
+        for (int page = 0; page < pagesInUse; ++page) {
+            bitmap[page / 8] = static_cast<char>(bitmap.at(page / 8) | (1 << (page % 8)));
+        }
+        data.append(bitmap);
+    }
+}
+
+void YaffsCheckpoint::appendObject(QByteArray& data, const YaffsCheckpointObject& object) const {
+    u32 bits = (object.type & 0x7);
+    if (object.fake) {
+        bits |= (1 << 6);
+    } else {
+        bits |= (1 << 7) | (1 << 8);    //rename and unlink allowed
+    }
+
+    appendU32(data, OBJECT_SIZE);
+    appendU32(data, object.objectId);
+    appendU32(data, object.parentId);
+    appendU32(data, object.headerPage >= 0 ? pageToChunk(object.headerPage) : 0);
+    appendU32(data, bits);              //serial in the third byte is always 0
+    appendU32(data, object.numDataChunks);
+    appendU32(data, object.type == YAFFS_OBJECT_TYPE_FILE ? object.fileSize : 0);
+    appendU32(data, 0);
+}
+
+void YaffsCheckpoint::appendTnodes(QByteArray& data, const YaffsCheckpointObject& object) const {
+    //data chunks are numbered from 1, the level 0 tnode entry 0 of the first tnode is unused
+    int numTnodes = (object.numDataChunks > 0 ? (object.numDataChunks >> YAFFS_TNODES_LEVEL0_BITS) + 1 : 0);
+    int numWords = mTnodeSize / 4;
+    QVector<u32> map(numWords);
+    u32 mask = (mTnodeWidth < 32 ? (1u << mTnodeWidth) - 1 : 0xffffffff);
+
+    for (int tnode = 0; tnode < numTnodes; ++tnode) {
+        u32 baseChunk = tnode << YAFFS_TNODES_LEVEL0_BITS;
+        map.fill(0);
+
+        for (int pos = 0; pos < YAFFS_NTNODES_LEVEL0; ++pos) {
+            int chunkId = baseChunk + pos;
+            if (chunkId >= 1 && chunkId <= object.numDataChunks) {
+                u32 value = pageToChunk(mDataPages.at(object.firstDataChunk + chunkId - 1));
+                int bit = pos * mTnodeWidth;
+                int word = bit / 32;
+                int bitInWord = bit % 32;
+                map[word] |= (value & mask) << bitInWord;
+                if (mTnodeWidth > 32 - bitInWord) {
+                    map[word + 1] |= (value & mask) >> (32 - bitInWord);
+                }
+            }
+        }
+
+        appendU32(data, baseChunk);
+        for (int i = 0; i < numWords; ++i) {
+            appendU32(data, map.at(i));
+        }
+    }
+    appendU32(data, END_MARKER);
+}
+
+bool YaffsCheckpoint::parseValidity(const char*& pos, const char* end, bool head) {
+    bool result = false;
+    if (pos + VALIDITY_SIZE <= end) {
+        result = (readU32(pos) == static_cast<u32>(VALIDITY_SIZE) &&
+                  readU32(pos + 4) == YAFFS_MAGIC &&
+                  readU32(pos + 8) == YAFFS_CHECKPOINT_VERSION &&
+                  readU32(pos + 12) == (head ? 1u : 0u));
+        pos += VALIDITY_SIZE;
+    }
+    return result;
+}
+
+bool YaffsCheckpoint::parseDevice(const char*& pos, const char* end) {
+    int numBlocks = mBlocks.size();
+    int stride = (mPagesPerBlock + 7) / 8;
+    int length = DEVICE_SIZE + (numBlocks * BLOCK_INFO_SIZE) + (numBlocks * stride);
+
+    if (pos + length > end || readU32(pos) != static_cast<u32>(DEVICE_SIZE)) {
+        return false;
+    }
+
+    int allocBlock = static_cast<int>(readU32(pos + 8));
+    mAllocBlock = (allocBlock >= INTERNAL_BLOCK_OFFSET ? allocBlock - INTERNAL_BLOCK_OFFSET : -1);
+    mAllocPage = readU32(pos + 12);
+    mSeqNumber = readU32(pos + 32);
+    pos += DEVICE_SIZE;
+
+    for (int i = 0; i < numBlocks; ++i) {
+        u32 bits = readU32(pos);
+        YaffsCheckpointBlock& block = mBlocks[i];
+        block.pagesInUse = (bits >> 10) & 0x3ff;
+        block.state = (bits >> 20) & 0xf;
+        block.hasSummary = (bits & (1u << 30));
+        block.seqNumber = readU32(pos + 4);
+        pos += BLOCK_INFO_SIZE;
+    }
+
+    //skip the chunk bitmap
+    pos += numBlocks * stride;
+    return true;
+}
+
+bool YaffsCheckpoint::parseObjects(const char*& pos, const char* end) {
+    forever {
+        if (pos + OBJECT_SIZE > end || readU32(pos) != static_cast<u32>(OBJECT_SIZE)) {
+            return false;
+        }
+
+        YaffsCheckpointObject object;
+        object.objectId = readU32(pos + 4);
+        if (object.objectId == END_MARKER) {
+            pos += OBJECT_SIZE;
+            break;
+        }
+
+        u32 bits = readU32(pos + 16);
+        int headerChunk = static_cast<int>(readU32(pos + 12));
+        object.parentId = readU32(pos + 8);
+        object.type = (bits & 0x7);
+        object.fake = (bits & (1 << 6));
+        object.headerPage = (headerChunk > 0 ? chunkToPage(headerChunk) : -1);
+        object.numDataChunks = static_cast<int>(readU32(pos + 20));
+        object.fileSize = readU32(pos + 24);
+        object.firstDataChunk = mDataPages.size();
+        pos += OBJECT_SIZE;
+
+        if (object.type == YAFFS_OBJECT_TYPE_FILE) {
+            if (!parseTnodes(pos, end, object)) {
+                return false;
+            }
+        }
+        mObjects.append(object);
+    }
+    return true;
+}
+
+bool YaffsCheckpoint::parseTnodes(const char*& pos, const char* end, YaffsCheckpointObject& object) {
+    int numDataChunks = object.numDataChunks;
+    if (numDataChunks < 0) {
+        return false;
+    }
+
+    //chunks not mapped by any tnode are left as -1
+    mDataPages.insert(mDataPages.size(), numDataChunks, -1);
+    int* dataPages = mDataPages.data() + object.firstDataChunk;
+    u32 mask = (mTnodeWidth < 32 ? (1u << mTnodeWidth) - 1 : 0xffffffff);
+
+    forever {
+        if (pos + 4 > end) {
+            return false;
+        }
+
+        u32 baseChunk = readU32(pos);
+        pos += 4;
+        if (baseChunk == END_MARKER) {
+            break;
+        }
+
+        if (pos + mTnodeSize > end) {
+            return false;
+        }
+
+        for (int entry = 0; entry < YAFFS_NTNODES_LEVEL0; ++entry) {
+            u32 chunkId = baseChunk + entry;
+            if (chunkId >= 1 && chunkId <= static_cast<u32>(numDataChunks)) {
+                int bit = entry * mTnodeWidth;
+                int word = bit / 32;
+                int bitInWord = bit % 32;
+                u32 value = readU32(pos + word * 4) >> bitInWord;
+                if (mTnodeWidth > 32 - bitInWord) {
+                    value |= readU32(pos + (word + 1) * 4) << (32 - bitInWord);
+                }
+                value &= mask;
+                if (value > 0) {
+                    dataPages[chunkId - 1] = chunkToPage(value);
+                }
+            }
+        }
+        pos += mTnodeSize;
+    }
+    return true;
+}
+
+int YaffsCheckpoint::pageToChunk(int page) const {
+    return page + (INTERNAL_BLOCK_OFFSET * mPagesPerBlock);
+}
+
+int YaffsCheckpoint::chunkToPage(int chunk) const {
+    return chunk - (INTERNAL_BLOCK_OFFSET * mPagesPerBlock);
+}
+
+void YaffsCheckpoint::appendU32(QByteArray& data, u32 value) {
+    char bytes[4];
+    bytes[0] = static_cast<char>(value & 0xff);
+    bytes[1] = static_cast<char>((value >> 8) & 0xff);
+    bytes[2] = static_cast<char>((value >> 16) & 0xff);
+    bytes[3] = static_cast<char>((value >> 24) & 0xff);
+    data.append(bytes, 4);
+}
+
+u32 YaffsCheckpoint::readU32(const char* pos) {
+    const u8* bytes = reinterpret_cast<const u8*>(pos);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<u32>(bytes[3]) << 24);
+}
+
+//same as the kernel, a running byte sum shifted up with a running xor in the bottom byte
+u32 YaffsCheckpoint::checksum(const char* data, int length) {
+    const u8* bytes = reinterpret_cast<const u8*>(data);
+    u32 sum = 0;
+    u32 xorSum = 0;
+    for (int i = 0; i < length; ++i) {
+        sum += bytes[i];
+        xorSum ^= bytes[i];
+    }
+    return (sum << 8) | (xorSum & 0xff);
+}
+
+YaffsChunkMap::YaffsChunkMap(const YaffsCheckpoint& checkpoint) {
+    const QVector<YaffsCheckpointObject>& objects = checkpoint.getObjects();
+    for (int i = 0; i < objects.size(); ++i) {
+        const YaffsCheckpointObject& object = objects.at(i);
+        if (object.type == YAFFS_OBJECT_TYPE_FILE && object.headerPage >= 0) {
+            mFiles.insert(static_cast<long>(object.headerPage) * PAGE_SIZE, object);
+        }
+    }
+    mDataPages = checkpoint.getDataPages();
+}
+
+bool YaffsChunkMap::findFile(long headerPos, YaffsCheckpointObject& file) const {
+    QHash<long, YaffsCheckpointObject>::const_iterator it = mFiles.constFind(headerPos);
+    if (it != mFiles.constEnd()) {
+        file = it.value();
+        return true;
+    }
+    return false;
+}
+
+//the page holding the chunk, counting from 0, or -1 for a hole in the file
+int YaffsChunkMap::getDataPage(const YaffsCheckpointObject& file, int chunk) const {
+    int index = file.firstDataChunk + chunk;
+    if (chunk < file.numDataChunks && index < mDataPages.size()) {
+        return mDataPages.at(index);
+    }
+    return -1;
+}
@@ -0,0 +1,111 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSCHECKPOINT_H
+#define YAFFSCHECKPOINT_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QHash>
+
+#include "Yaffs2.h"
+
+//checkpoint version and structure layouts must match the kernel on the device,
+//the layouts are those of the kernel structures built for 32 bit ARM
+#define YAFFS_CHECKPOINT_VERSION        7
+
+struct YaffsCheckpointObject {
+    u32 objectId;
+    u32 parentId;
+    int type;
+    int headerPage;                 //page in the image holding the object header, -1 if none
+    bool fake;
+    u32 fileSize;
+    int firstDataChunk;             //index into the data page list
+    int numDataChunks;
+};
+
+struct YaffsCheckpointBlock {
+    int state;
+    int pagesInUse;
+    u32 seqNumber;
+    bool hasSummary;
+};
+
+class YaffsCheckpoint {
+public:
+    YaffsCheckpoint(int pagesPerBlock, int numBlocks);
+
+    void setBlock(int block, const YaffsCheckpointBlock& blockInfo) { mBlocks[block] = blockInfo; }
+    void setAllocation(int allocBlock, int allocPage, u32 seqNumber);
+    void setObjects(const QVector<YaffsCheckpointObject>& objects, const QVector<int>& dataPages);
+    QByteArray build() const;
+    bool parse(const QByteArray& data);
+
+    int getNumBlocks() const { return mBlocks.size(); }
+    const YaffsCheckpointBlock& getBlock(int block) const { return mBlocks.at(block); }
+    const QVector<YaffsCheckpointObject>& getObjects() const { return mObjects; }
+    const QVector<int>& getDataPages() const { return mDataPages; }
+    u32 getSeqNumber() const { return mSeqNumber; }
+
+private:
+    void appendValidity(QByteArray& data, bool head) const;
+    void appendDevice(QByteArray& data) const;
+    void appendObject(QByteArray& data, const YaffsCheckpointObject& object) const;
+    void appendTnodes(QByteArray& data, const YaffsCheckpointObject& object) const;
+    bool parseValidity(const char*& pos, const char* end, bool head);
+    bool parseDevice(const char*& pos, const char* end);
+    bool parseObjects(const char*& pos, const char* end);
+    bool parseTnodes(const char*& pos, const char* end, YaffsCheckpointObject& object);
+    int pageToChunk(int page) const;
+    int chunkToPage(int chunk) const;
+
+    static void appendU32(QByteArray& data, u32 value);
+    static u32 readU32(const char* pos);
+    static u32 checksum(const char* data, int length);
+
+private:
+    int mPagesPerBlock;
+    int mTnodeWidth;
+    int mTnodeSize;
+    int mAllocBlock;
+    int mAllocPage;
+    u32 mSeqNumber;
+    QVector<YaffsCheckpointBlock> mBlocks;
+    QVector<YaffsCheckpointObject> mObjects;
+    QVector<int> mDataPages;
+};
+
+//the data pages of each file in a checkpoint, looked up by the position of the file's header.
+//an image can hold older copies of a file's chunks after its header, a scan can't tell them
+//apart but the checkpoint knows which pages are current
+class YaffsChunkMap {
+public:
+    YaffsChunkMap() {}
+    YaffsChunkMap(const YaffsCheckpoint& checkpoint);
+
+    bool isEmpty() const { return mFiles.isEmpty(); }
+    bool findFile(long headerPos, YaffsCheckpointObject& file) const;
+    int getDataPage(const YaffsCheckpointObject& file, int chunk) const;
+
+private:
+    QHash<long, YaffsCheckpointObject> mFiles;
+    QVector<int> mDataPages;
+};
+
+#endif  //YAFFSCHECKPOINT_H
@@ -0,0 +1,539 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+
+#include <string.h>
+
+#include "YaffsCli.h"
+#include "YaffsOverlay.h"
+#include "YaffsRecipes.h"
+#include "YaffsFsConfig.h"
+#include "YaffsArchive.h"
+#include "Utils.h"
+
+static const QString DEFAULT_FS_CONFIG_MOUNT_POINT = "system";
+
+static const char* USAGE =
+    "usage: yaffey-cli <command> [<args>]\n"
+    "\n"
+    "  ls IMAGE [PATH] [-r]\n"
+    "      one line per item: type mode uid gid size mtime path alias\n"
+    "      type is d, f, l or ?, mode is octal, size is the total below a directory\n"
+    "  stat IMAGE PATH\n"
+    "  extract IMAGE PATH DEST\n"
+    "      PATH and everything below it is written into the local directory DEST\n"
+    "  build-from-dir IMAGE DIR [DIR...] [--fs-config FILE] [--mount-point PATH]\n"
+    "                 [--pages-per-block N] [--partition-blocks N] [--checkpoint] [--summary]\n"
+    "      more than one DIR are overlay layers, later ones win and .wh. files are whiteouts\n"
+    "  verify IMAGE\n"
+    "      reads every object and file, exits with 1 if anything is wrong\n"
+    "  apply-recipe IMAGE RECIPE_XML NAME OUT_IMAGE\n"
+    "      adds the files and symlinks of a menuitem in the xml and saves to OUT_IMAGE\n"
+    "  import-archive IMAGE ARCHIVE PATH OUT_IMAGE\n"
+    "      adds a tar or newc cpio archive, gzipped or not, below the directory PATH and saves\n"
+    "      to OUT_IMAGE, ARCHIVE can be - to read it from stdin\n";
+
+YaffsCli::YaffsCli(const QStringList& args) : mOut(stdout, QIODevice::WriteOnly), mErr(stderr, QIODevice::WriteOnly) {
+    mArgs = args;
+    if (mArgs.size() > 0) {
+        mCommand = mArgs.takeFirst();
+    }
+}
+
+YaffsCli::~YaffsCli() {
+    mOut.flush();
+    mErr.flush();
+}
+
+int YaffsCli::run() {
+    int result;
+    if (mCommand == "ls") {
+        result = list();
+    } else if (mCommand == "stat") {
+        result = stat();
+    } else if (mCommand == "extract") {
+        result = extract();
+    } else if (mCommand == "build-from-dir") {
+        result = buildFromDir();
+    } else if (mCommand == "verify") {
+        result = verify();
+    } else if (mCommand == "apply-recipe") {
+        result = applyRecipe();
+    } else if (mCommand == "import-archive") {
+        result = importArchive();
+    } else {
+        result = usage();
+    }
+    return result;
+}
+
+int YaffsCli::list() {
+    bool recursive = takeOption("-r");
+    if (mArgs.size() < 1 || mArgs.size() > 2) {
+        return usage();
+    }
+
+    YaffsModel yaffsModel;
+    if (!openImage(yaffsModel, mArgs.at(0))) {
+        return EXIT_FAILED;
+    }
+
+    QString path = (mArgs.size() > 1 ? mArgs.at(1) : "/");
+    const YaffsItem* item = yaffsModel.itemAtPath(path);
+    if (item == NULL) {
+        error("No such path in image: " + path);
+        return EXIT_FAILED;
+    }
+
+    if (item->isDir()) {
+        QString dirPath = item->getFullPath();
+        for (int i = 0; i < item->childCount(); ++i) {
+            const YaffsItem* childItem = item->child(i);
+            listItem(childItem, childPath(dirPath, childItem), recursive);
+        }
+    } else {
+        listItem(item, item->getFullPath(), false);
+    }
+    return EXIT_OK;
+}
+
+void YaffsCli::listItem(const YaffsItem* item, const QString& path, bool recursive) {
+    mOut << typeChar(item) << '\t'
+         << QString("%1").arg(item->getPermissions() & 07777, 4, 8, QChar('0')) << '\t'
+         << item->getUserId() << '\t'
+         << item->getGroupId() << '\t'
+         << item->getTotalSize() << '\t'
+         << item->getModificationTime() << '\t'
+         << escape(path) << '\t'
+         << escape(item->getAlias()) << '\n';
+
+    if (recursive && item->isDir()) {
+        for (int i = 0; i < item->childCount(); ++i) {
+            const YaffsItem* childItem = item->child(i);
+            listItem(childItem, childPath(path, childItem), true);
+        }
+    }
+}
+
+int YaffsCli::stat() {
+    if (mArgs.size() != 2) {
+        return usage();
+    }
+
+    YaffsModel yaffsModel;
+    if (!openImage(yaffsModel, mArgs.at(0))) {
+        return EXIT_FAILED;
+    }
+
+    const YaffsItem* item = yaffsModel.itemAtPath(mArgs.at(1));
+    if (item == NULL) {
+        error("No such path in image: " + mArgs.at(1));
+        return EXIT_FAILED;
+    }
+
+    printValue("path", escape(item->getFullPath()));
+    printValue("type", QString(QChar(typeChar(item))));
+    printValue("object_id", item->getObjectId());
+    printValue("parent_id", item->getParentObjectId());
+    printValue("header_pos", item->getHeaderPosition());
+    printValue("mode", QString("%1").arg(item->getPermissions() & 07777, 4, 8, QChar('0')));
+    printValue("uid", item->getUserId());
+    printValue("gid", item->getGroupId());
+    printValue("size", static_cast<qint64>(item->getFileSize()));
+    printValue("atime", item->getAccessTime());
+    printValue("mtime", item->getModificationTime());
+    printValue("ctime", item->getCreationTime());
+    if (item->isSymLink()) {
+        printValue("alias", escape(item->getAlias()));
+    } else if (item->isDir()) {
+        printValue("total_size", static_cast<qint64>(item->getTotalSize()));
+        printValue("total_count", item->getTotalCount());
+    }
+    return EXIT_OK;
+}
+
+//the image is opened once for the whole extract rather than once per file
+int YaffsCli::extract() {
+    if (mArgs.size() != 3) {
+        return usage();
+    }
+
+    QString imageFilename = mArgs.at(0);
+    YaffsModel yaffsModel;
+    if (!openImage(yaffsModel, imageFilename)) {
+        return EXIT_FAILED;
+    }
+
+    const YaffsItem* item = yaffsModel.itemAtPath(mArgs.at(1));
+    if (item == NULL) {
+        error("No such path in image: " + mArgs.at(1));
+        return EXIT_FAILED;
+    }
+
+    QString destPath = mArgs.at(2);
+    if (!QDir().mkpath(destPath)) {
+        error("Couldn't create directory: " + destPath);
+        return EXIT_FAILED;
+    }
+
+    YaffsControl yaffsControl(imageFilename.toStdString().c_str(), NULL);
+    if (!yaffsControl.open(YaffsControl::OPEN_READ)) {
+        error("Couldn't open image: " + imageFilename);
+        return EXIT_FAILED;
+    }
+    yaffsControl.setChunkMap(yaffsModel.getChunkMap());
+
+    YaffsExtractInfo extractInfo;
+    memset(&extractInfo, 0, sizeof(YaffsExtractInfo));
+    extractItem(yaffsControl, item, (item->isRoot() ? destPath : destPath + "/" + item->getName()), extractInfo);
+
+    printValue("files", extractInfo.numFilesExtracted);
+    printValue("dirs", extractInfo.numDirsExtracted);
+    printValue("symlinks", extractInfo.numSymLinksExtracted);
+    printValue("failed", extractInfo.numFailed);
+    return (extractInfo.numFailed == 0 ? EXIT_OK : EXIT_FAILED);
+}
+
+bool YaffsCli::extractItem(YaffsControl& yaffsControl, const YaffsItem* item, const QString& destPath, YaffsExtractInfo& extractInfo) {
+    bool result = false;
+    if (item->isDir()) {
+        result = QDir().mkpath(destPath);
+        if (result) {
+            extractInfo.numDirsExtracted++;
+            for (int i = 0; i < item->childCount(); ++i) {
+                const YaffsItem* childItem = item->child(i);
+                extractItem(yaffsControl, childItem, destPath + "/" + childItem->getName(), extractInfo);
+            }
+        }
+    } else if (item->isFile()) {
+        size_t bytesExtracted = 0;
+        char* data = yaffsControl.extractFile(item->getHeaderPosition(), bytesExtracted);
+        if (bytesExtracted == item->getFileSize()) {
+            result = Utils::saveDataToFile(destPath, data, bytesExtracted);
+        }
+        delete[] data;
+        if (result) {
+            extractInfo.numFilesExtracted++;
+        }
+    } else if (item->isSymLink()) {
+        result = QFile::link(item->getAlias(), destPath);
+        if (result) {
+            extractInfo.numSymLinksExtracted++;
+        }
+    }
+
+    if (!result) {
+        error("Failed to extract " + item->getFullPath());
+        extractInfo.numFailed++;
+    }
+    return result;
+}
+
+//the directories are put on top of each other like overlay layers, a single one is just imported
+int YaffsCli::buildFromDir() {
+    QString value;
+    QString fsConfigFilename;
+    QString mountPoint = DEFAULT_FS_CONFIG_MOUNT_POINT;
+    bool useFsConfig = takeOption("--fs-config", fsConfigFilename);
+    takeOption("--mount-point", mountPoint);
+
+    bool ok = true;
+    YaffsWriteOptions writeOptions = YaffsControl::getDefaultWriteOptions();
+    if (takeOption("--pages-per-block", value)) {
+        writeOptions.pagesPerBlock = value.toInt(&ok);
+        ok = (ok && writeOptions.pagesPerBlock > 0);
+    }
+    if (ok && takeOption("--partition-blocks", value)) {
+        writeOptions.partitionBlocks = value.toInt(&ok);
+        ok = (ok && writeOptions.partitionBlocks >= 0);
+    }
+    writeOptions.writeCheckpoint = takeOption("--checkpoint");
+    writeOptions.writeSummary = takeOption("--summary");
+
+    if (!ok || mArgs.size() < 2) {
+        return usage();
+    }
+    if (writeOptions.writeCheckpoint && writeOptions.partitionBlocks == 0) {
+        error("--checkpoint needs --partition-blocks");
+        return EXIT_USAGE;
+    }
+
+    YaffsFsConfig fsConfig;
+    if (useFsConfig) {
+        if (!fsConfig.load(fsConfigFilename, mountPoint)) {
+            error("Couldn't read " + fsConfigFilename);
+            return EXIT_FAILED;
+        }
+        if (fsConfig.getNumErrors() > 0) {
+            error(QString::number(fsConfig.getNumErrors()) + " lines in " + fsConfigFilename + " couldn't be read and were skipped");
+        }
+    }
+
+    YaffsOverlay overlay;
+    if (!overlay.compose(mArgs.mid(1))) {
+        error(overlay.getError());
+        return EXIT_FAILED;
+    }
+
+    //the new image has no name of its own so that it can be saved to any
+    YaffsModel yaffsModel;
+    yaffsModel.newImage(QString());
+    yaffsModel.setWriteOptions(writeOptions);
+    int itemsImported = yaffsModel.importLayers(yaffsModel.itemAtPath("/"), overlay, (useFsConfig ? &fsConfig : NULL));
+
+    printValue("items", itemsImported);
+    printValue("replaced", overlay.getNumReplaced());
+    printValue("whiteouts", overlay.getNumWhiteouts());
+
+    YaffsSaveInfo saveInfo;
+    bool result = yaffsModel.saveAs(mArgs.at(0), saveInfo);
+    printSaveInfo(saveInfo);
+    if (!result) {
+        error("Failed to write image: " + mArgs.at(0));
+    }
+    return (result ? EXIT_OK : EXIT_FAILED);
+}
+
+//every file's data is read back as well as the headers, which is what an image that only has
+//good headers would fail on
+int YaffsCli::verify() {
+    if (mArgs.size() != 1) {
+        return usage();
+    }
+
+    QString imageFilename = mArgs.at(0);
+    YaffsModel yaffsModel;
+    YaffsReadInfo readInfo = yaffsModel.openImage(imageFilename);
+
+    printValue("read", (readInfo.result ? 1 : 0));
+    printValue("checkpoint", (readInfo.fromCheckpoint ? 1 : 0));
+    printValue("files", readInfo.numFiles);
+    printValue("dirs", readInfo.numDirs);
+    printValue("symlinks", readInfo.numSymLinks);
+    printValue("hardlinks", readInfo.numHardLinks);
+    printValue("specials", readInfo.numSpecials);
+    printValue("unknowns", readInfo.numUnknowns);
+    printValue("errors", readInfo.numErrorousObjects);
+    printValue("incomplete_page", (readInfo.eofHasIncompletePage ? 1 : 0));
+
+    int numChecked = 0;
+    int numBad = 0;
+    const YaffsItem* rootItem = yaffsModel.itemAtPath("/");
+    YaffsControl yaffsControl(imageFilename.toStdString().c_str(), NULL);
+    if (readInfo.result && rootItem && yaffsControl.open(YaffsControl::OPEN_READ)) {
+        yaffsControl.setChunkMap(yaffsModel.getChunkMap());
+        numBad = verifyFiles(yaffsControl, rootItem, numChecked);
+    }
+    printValue("files_checked", numChecked);
+    printValue("files_bad", numBad);
+
+    bool result = (readInfo.result && !readInfo.eofHasIncompletePage && readInfo.numErrorousObjects == 0 && numBad == 0);
+    printValue("ok", (result ? 1 : 0));
+    return (result ? EXIT_OK : EXIT_FAILED);
+}
+
+int YaffsCli::verifyFiles(YaffsControl& yaffsControl, const YaffsItem* dirItem, int& numChecked) {
+    int numBad = 0;
+    for (int i = 0; i < dirItem->childCount(); ++i) {
+        const YaffsItem* item = dirItem->child(i);
+        if (item->isDir()) {
+            numBad += verifyFiles(yaffsControl, item, numChecked);
+        } else if (item->isFile()) {
+            size_t bytesExtracted = 0;
+            char* data = yaffsControl.extractFile(item->getHeaderPosition(), bytesExtracted);
+            delete[] data;
+            if (bytesExtracted != item->getFileSize()) {
+                error("Bad file: " + item->getFullPath() + ", read " + QString::number(bytesExtracted) + " of " + QString::number(item->getFileSize()) + " bytes");
+                numBad++;
+            }
+            numChecked++;
+        }
+    }
+    return numBad;
+}
+
+//nothing is saved if any of the recipe couldn't be done
+int YaffsCli::applyRecipe() {
+    if (mArgs.size() != 4) {
+        return usage();
+    }
+
+    QString imageFilename = mArgs.at(0);
+    QString xmlFilename = mArgs.at(1);
+    QString name = mArgs.at(2);
+    QString outFilename = mArgs.at(3);
+    if (QFileInfo(imageFilename).absoluteFilePath() == QFileInfo(outFilename).absoluteFilePath()) {
+        error("The image can't be saved over itself");
+        return EXIT_USAGE;
+    }
+
+    YaffsRecipes recipes;
+    if (!recipes.load(xmlFilename)) {
+        error("Couldn't read recipes: " + xmlFilename);
+        return EXIT_FAILED;
+    }
+
+    YaffsModel yaffsModel;
+    if (!openImage(yaffsModel, imageFilename)) {
+        return EXIT_FAILED;
+    }
+
+    YaffsRecipeInfo recipeInfo;
+    if (!recipes.apply(&yaffsModel, name, recipeInfo)) {
+        error("No recipe named " + name + " in " + xmlFilename);
+        return EXIT_FAILED;
+    }
+    printValue("added", recipeInfo.numItemsAdded);
+    printValue("failed", recipeInfo.numItemsFailed);
+    printValue("xml_errors", recipeInfo.numXmlErrors);
+    if (recipeInfo.numItemsFailed + recipeInfo.numXmlErrors > 0) {
+        error("Recipe " + name + " couldn't be applied, nothing was saved");
+        return EXIT_FAILED;
+    }
+
+    YaffsSaveInfo saveInfo;
+    bool result = yaffsModel.saveAs(outFilename, saveInfo);
+    printSaveInfo(saveInfo);
+    if (!result) {
+        error("Failed to write image: " + outFilename);
+    }
+    return (result ? EXIT_OK : EXIT_FAILED);
+}
+
+int YaffsCli::importArchive() {
+    if (mArgs.size() != 4) {
+        return usage();
+    }
+
+    QString imageFilename = mArgs.at(0);
+    QString archiveFilename = mArgs.at(1);
+    QString path = mArgs.at(2);
+    QString outFilename = mArgs.at(3);
+    if (QFileInfo(imageFilename).absoluteFilePath() == QFileInfo(outFilename).absoluteFilePath()) {
+        error("The image can't be saved over itself");
+        return EXIT_USAGE;
+    }
+
+    YaffsModel yaffsModel;
+    if (!openImage(yaffsModel, imageFilename)) {
+        return EXIT_FAILED;
+    }
+
+    YaffsItem* dirItem = yaffsModel.itemAtPath(path);
+    if (dirItem == NULL || !dirItem->isDir()) {
+        error("No such directory in image: " + path);
+        return EXIT_FAILED;
+    }
+
+    YaffsArchive archive;
+    if (!archive.open(archiveFilename)) {
+        error("Couldn't read archive: " + archive.getError());
+        return EXIT_FAILED;
+    }
+
+    int itemsImported = yaffsModel.importArchive(dirItem, archive);
+    printValue("imported", itemsImported);
+    printValue("skipped", archive.getNumSkipped() + archive.getEntries().size() - itemsImported);
+
+    YaffsSaveInfo saveInfo;
+    bool result = yaffsModel.saveAs(outFilename, saveInfo);
+    printSaveInfo(saveInfo);
+    if (!result) {
+        error("Failed to write image: " + outFilename);
+    }
+    return (result ? EXIT_OK : EXIT_FAILED);
+}
+
+int YaffsCli::usage() {
+    mErr << USAGE;
+    return EXIT_USAGE;
+}
+
+bool YaffsCli::openImage(YaffsModel& yaffsModel, const QString& imageFilename) {
+    YaffsReadInfo readInfo = yaffsModel.openImage(imageFilename);
+    if (!readInfo.result) {
+        error("Couldn't read image: " + imageFilename);
+    }
+    return readInfo.result;
+}
+
+bool YaffsCli::takeOption(const QString& name) {
+    return (mArgs.removeAll(name) > 0);
+}
+
+//an option missing its value is left where it is, the arguments then don't add up
+bool YaffsCli::takeOption(const QString& name, QString& value) {
+    int index = mArgs.indexOf(name);
+    if (index >= 0 && index + 1 < mArgs.size()) {
+        value = mArgs.at(index + 1);
+        mArgs.removeAt(index + 1);
+        mArgs.removeAt(index);
+        return true;
+    }
+    return false;
+}
+
+void YaffsCli::printSaveInfo(const YaffsSaveInfo& saveInfo) {
+    printValue("files_saved", saveInfo.numFilesSaved);
+    printValue("files_failed", saveInfo.numFilesFailed);
+    printValue("dirs_saved", saveInfo.numDirsSaved);
+    printValue("dirs_failed", saveInfo.numDirsFailed);
+    printValue("symlinks_saved", saveInfo.numSymLinksSaved);
+    printValue("symlinks_failed", saveInfo.numSymLinksFailed);
+    printValue("files_missing", saveInfo.numFilesMissing);
+    printValue("checkpoint_written", (saveInfo.checkpointWritten ? 1 : 0));
+}
+
+void YaffsCli::printValue(const QString& key, const QString& value) {
+    mOut << key << '=' << value << '\n';
+}
+
+void YaffsCli::printValue(const QString& key, qint64 value) {
+    mOut << key << '=' << value << '\n';
+}
+
+void YaffsCli::error(const QString& message) {
+    mErr << "yaffey-cli: " << message << '\n';
+}
+
+QString YaffsCli::escape(const QString& text) {
+    QString escaped = text;
+    escaped.replace('\\', "\\\\");
+    escaped.replace('\t', "\\t");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+QString YaffsCli::childPath(const QString& dirPath, const YaffsItem* item) {
+    return (dirPath == "/" ? "" : dirPath) + "/" + item->getName();
+}
+
+char YaffsCli::typeChar(const YaffsItem* item) {
+    char type = '?';
+    if (item->isDir()) {
+        type = 'd';
+    } else if (item->isFile()) {
+        type = 'f';
+    } else if (item->isSymLink()) {
+        type = 'l';
+    }
+    return type;
+}
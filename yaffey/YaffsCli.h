@@ -0,0 +1,82 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSCLI_H
+#define YAFFSCLI_H
+
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+#include "YaffsModel.h"
+
+struct YaffsExtractInfo {
+    int numFilesExtracted;
+    int numDirsExtracted;
+    int numSymLinksExtracted;
+    int numFailed;
+};
+
+//the commands of yaffey-cli. nothing here needs the gui or an event loop, so a command is done
+//as soon as the image has been read. output is meant for scripts: ls gives one tab separated
+//line per item, everything else gives key=value lines. tabs, newlines and backslashes in names
+//are escaped as \t, \n and \\
+class YaffsCli {
+public:
+    enum ExitCode {
+        EXIT_OK = 0,
+        EXIT_FAILED = 1,
+        EXIT_USAGE = 2
+    };
+
+    YaffsCli(const QStringList& args);
+    ~YaffsCli();
+
+    int run();
+
+private:
+    int list();
+    int stat();
+    int extract();
+    int buildFromDir();
+    int verify();
+    int applyRecipe();
+    int importArchive();
+    int usage();
+    bool openImage(YaffsModel& yaffsModel, const QString& imageFilename);
+    bool takeOption(const QString& name);
+    bool takeOption(const QString& name, QString& value);
+    void listItem(const YaffsItem* item, const QString& path, bool recursive);
+    bool extractItem(YaffsControl& yaffsControl, const YaffsItem* item, const QString& destPath, YaffsExtractInfo& extractInfo);
+    int verifyFiles(YaffsControl& yaffsControl, const YaffsItem* dirItem, int& numChecked);
+    void printSaveInfo(const YaffsSaveInfo& saveInfo);
+    void printValue(const QString& key, const QString& value);
+    void printValue(const QString& key, qint64 value);
+    void error(const QString& message);
+    static QString escape(const QString& text);
+    static QString childPath(const QString& dirPath, const YaffsItem* item);
+    static char typeChar(const YaffsItem* item);
+
+private:
+    QString mCommand;
+    QStringList mArgs;                  //after the command, options are taken out as they're used
+    QTextStream mOut;
+    QTextStream mErr;
+};
+
+#endif  //YAFFSCLI_H
@@ -0,0 +1,341 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QByteArrayMatcher>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+#include <regex>
+#include <string.h>
+
+#include "YaffsContentSearch.h"
+#include "YaffsItem.h"
+
+//holes in files read from a checkpoint are searched as zeros
+static const char ZERO_CHUNK[CHUNK_SIZE] = { 0 };
+
+//walks the data chunks of one file in the mapped image, the chunks are handed out in place
+struct FileChunks {
+    FileChunks(const uchar* image, qint64 imageSize, const YaffsChunkMap* chunkMap, const YaffsItem* item);
+    bool next(const char*& data, int& size);
+    bool nextMapped(const char*& data, int& size);
+    bool atEnd() const { return (mBytesRemaining == 0); }
+
+    const uchar* mImage;
+    qint64 mImageSize;
+    const YaffsChunkMap* mChunkMap;
+    YaffsCheckpointObject mMappedFile;
+    bool mMapped;
+    int mChunk;
+    qint64 mPos;
+    u32 mObjectId;
+    qint64 mBytesRemaining;
+};
+
+//one file's worth of work for the thread pool, shared by all the threads
+struct SearchFile {
+    typedef YaffsContentMatch result_type;
+
+    const uchar* image;
+    qint64 imageSize;
+    const YaffsChunkMap* chunkMap;
+    bool regex;
+    QByteArrayMatcher matcher;
+    std::regex regExp;
+
+    YaffsContentMatch operator()(YaffsItem* item) const;
+    void findString(FileChunks& chunks, YaffsContentMatch& match) const;
+    void findRegex(FileChunks& chunks, YaffsContentMatch& match) const;
+    static void unpackTags(const uchar* page, yaffs_ext_tags& tags);
+    static void addOffset(YaffsContentMatch& match, qint64 offset);
+};
+
+//the same walk as YaffsControl::extractFile, but over the mapped image
+FileChunks::FileChunks(const uchar* image, qint64 imageSize, const YaffsChunkMap* chunkMap, const YaffsItem* item) {
+    mImage = image;
+    mImageSize = imageSize;
+    mChunkMap = chunkMap;
+    mChunk = 0;
+    mPos = item->getHeaderPosition();
+    mObjectId = 0;
+    mBytesRemaining = 0;
+
+    //the checkpoint has the current size and pages, the header and the pages after it may be stale
+    mMapped = mChunkMap->findFile(static_cast<long>(mPos), mMappedFile);
+    if (mMapped) {
+        mObjectId = mMappedFile.objectId;
+        mBytesRemaining = mMappedFile.fileSize;
+    } else if (mPos >= 0 && mPos + PAGE_SIZE <= mImageSize) {
+        yaffs_ext_tags tags;
+        SearchFile::unpackTags(mImage + mPos, tags);
+        const yaffs_obj_hdr* objectHeader = reinterpret_cast<const yaffs_obj_hdr*>(mImage + mPos);
+
+        //a size bigger than the image is a corrupt header
+        if (tags.chunk_used && tags.obj_id != 0 && tags.chunk_id == 0 && objectHeader->file_size_low <= mImageSize) {
+            mObjectId = tags.obj_id;
+            mBytesRemaining = objectHeader->file_size_low;
+        }
+    }
+}
+
+//false at the end of the file or if the image ends before it does
+bool FileChunks::next(const char*& data, int& size) {
+    if (mMapped) {
+        return nextMapped(data, size);
+    }
+
+    while (mBytesRemaining > 0) {
+        mPos += PAGE_SIZE;
+        if (mPos + PAGE_SIZE > mImageSize) {
+            mBytesRemaining = 0;
+            break;
+        }
+
+        //step over summary chunks and erased pages between the data chunks
+        yaffs_ext_tags tags;
+        SearchFile::unpackTags(mImage + mPos, tags);
+        if (tags.obj_id != mObjectId || tags.chunk_id == 0) {
+            continue;
+        }
+        if (tags.n_bytes > CHUNK_SIZE) {
+            mBytesRemaining = 0;
+            break;
+        }
+
+        data = reinterpret_cast<const char*>(mImage + mPos);
+        size = static_cast<int>(qMin<qint64>(mBytesRemaining, tags.n_bytes));
+        mBytesRemaining -= size;
+        return true;
+    }
+    return false;
+}
+
+//false at the end of the file or if a page isn't the chunk the checkpoint says it is
+bool FileChunks::nextMapped(const char*& data, int& size) {
+    if (mBytesRemaining == 0) {
+        return false;
+    }
+
+    size = static_cast<int>(qMin<qint64>(mBytesRemaining, CHUNK_SIZE));
+    int page = mChunkMap->getDataPage(mMappedFile, mChunk);
+    if (page < 0) {
+        data = ZERO_CHUNK;
+    } else {
+        qint64 pos = static_cast<qint64>(page) * PAGE_SIZE;
+        yaffs_ext_tags tags;
+        if (pos + PAGE_SIZE > mImageSize) {
+            mBytesRemaining = 0;
+            return false;
+        }
+        SearchFile::unpackTags(mImage + pos, tags);
+        if (tags.obj_id != mObjectId || tags.chunk_id != static_cast<u32>(mChunk + 1)) {
+            mBytesRemaining = 0;
+            return false;
+        }
+        data = reinterpret_cast<const char*>(mImage + pos);
+    }
+
+    mChunk++;
+    mBytesRemaining -= size;
+    return true;
+}
+
+YaffsContentMatch SearchFile::operator()(YaffsItem* item) const {
+    YaffsContentMatch match;
+    match.item = item;
+    match.numMatches = 0;
+
+    FileChunks chunks(image, imageSize, chunkMap, item);
+    if (regex) {
+        findRegex(chunks, match);
+    } else {
+        findString(chunks, match);
+    }
+    return match;
+}
+
+//each chunk is searched in place, a match that straddles two chunks is found by searching
+//the last patternLength - 1 bytes seen joined to the start of the next chunk
+void SearchFile::findString(FileChunks& chunks, YaffsContentMatch& match) const {
+    int patternLength = matcher.pattern().length();
+    int overlap = patternLength - 1;
+    QByteArray tail;
+    qint64 chunkOffset = 0;
+    qint64 nextOffset = 0;
+    const char* data;
+    int size;
+
+    while (chunks.next(data, size)) {
+        if (tail.size() > 0) {
+            QByteArray joined = tail;
+            joined.append(data, qMin(size, overlap));
+            qint64 joinedOffset = chunkOffset - tail.size();
+            int offset = qMax<qint64>(nextOffset - joinedOffset, 0);
+            while ((offset = matcher.indexIn(joined.constData(), joined.size(), offset)) != -1 && joinedOffset + offset < chunkOffset) {
+                addOffset(match, joinedOffset + offset);
+                nextOffset = joinedOffset + offset + patternLength;
+                offset += patternLength;
+            }
+        }
+
+        int offset = static_cast<int>(qMax<qint64>(nextOffset - chunkOffset, 0));
+        while (offset < size && (offset = matcher.indexIn(data, size, offset)) != -1) {
+            addOffset(match, chunkOffset + offset);
+            nextOffset = chunkOffset + offset + patternLength;
+            offset += patternLength;
+        }
+
+        if (overlap > 0) {
+            tail.append(data, size);
+            if (tail.size() > overlap) {
+                tail.remove(0, tail.size() - overlap);
+            }
+        }
+        chunkOffset += size;
+    }
+}
+
+//the regex runs over a window of the chunk with the end of the data before it. matches starting in the
+//last MAX_REGEX_MATCH_LENGTH bytes of the window are left for the next one, which sees more data after them
+void SearchFile::findRegex(FileChunks& chunks, YaffsContentMatch& match) const {
+    const int overlap = YaffsContentSearch::MAX_REGEX_MATCH_LENGTH;
+    QByteArray window;
+    window.reserve(overlap + CHUNK_SIZE);
+    qint64 windowOffset = 0;
+    qint64 nextOffset = 0;
+    const char* data;
+    int size;
+
+    while (chunks.next(data, size)) {
+        window.append(data, size);
+        bool last = chunks.atEnd();
+        int limit = (last ? window.size() : window.size() - overlap);
+
+        const char* begin = window.constData();
+        const char* end = begin + window.size();
+        int offset = static_cast<int>(qMax<qint64>(nextOffset - windowOffset, 0));
+        std::cmatch regMatch;
+        while (offset <= window.size()) {
+            std::regex_constants::match_flag_type flags = std::regex_constants::match_default;
+            if (windowOffset + offset > 0) {
+                flags |= std::regex_constants::match_prev_avail;
+            }
+            if (!last) {
+                flags |= std::regex_constants::match_not_eol;
+            }
+            if (!std::regex_search(begin + offset, end, regMatch, regExp, flags)) {
+                break;
+            }
+
+            int start = offset + static_cast<int>(regMatch.position(0));
+            if (!last && start >= limit) {
+                break;
+            }
+            addOffset(match, windowOffset + start);
+            offset = start + qMax(static_cast<int>(regMatch.length(0)), 1);
+            nextOffset = windowOffset + offset;
+        }
+
+        if (window.size() > overlap) {
+            windowOffset += window.size() - overlap;
+            window.remove(0, window.size() - overlap);
+        }
+    }
+}
+
+//the unpack wants a writable copy of the spare area
+void SearchFile::unpackTags(const uchar* page, yaffs_ext_tags& tags) {
+    yaffs_packed_tags2_tags_only packedTags;
+    memcpy(&packedTags, page + CHUNK_SIZE, sizeof(packedTags));
+    yaffs_unpack_tags2_tags_only(&tags, &packedTags);
+}
+
+void SearchFile::addOffset(YaffsContentMatch& match, qint64 offset) {
+    if (match.numMatches < YaffsContentSearch::MAX_CONTENT_OFFSETS) {
+        match.offsets.append(offset);
+    }
+    match.numMatches++;
+}
+
+YaffsContentSearch::YaffsContentSearch(const QString& imageFilename, const YaffsChunkMap& chunkMap) : mImageFile(imageFilename), mChunkMap(chunkMap) {
+    mImage = NULL;
+    mImageSize = 0;
+}
+
+YaffsContentSearch::~YaffsContentSearch() {
+    if (mImage) {
+        mImageFile.unmap(const_cast<uchar*>(mImage));
+    }
+}
+
+bool YaffsContentSearch::open() {
+    if (!mImage && mImageFile.open(QIODevice::ReadOnly)) {
+        mImageSize = mImageFile.size();
+        mImage = mImageFile.map(0, mImageSize);
+        if (!mImage) {
+            qDebug() << "Failed to map " << mImageFile.fileName();
+        }
+    }
+    return (mImage != NULL);
+}
+
+//returns the files with at least one match, in the order they appear in the tree
+QList<YaffsContentMatch> YaffsContentSearch::search(YaffsItem* root, const QString& pattern, bool regex) {
+    QList<YaffsContentMatch> result;
+    if (mImage && root && pattern.length() > 0) {
+        SearchFile searchFile;
+        searchFile.image = mImage;
+        searchFile.imageSize = mImageSize;
+        searchFile.chunkMap = &mChunkMap;
+        searchFile.regex = regex;
+        searchFile.matcher.setPattern(pattern.toUtf8());
+        if (regex) {
+            try {
+                searchFile.regExp.assign(pattern.toUtf8().constData(), std::regex::ECMAScript | std::regex::optimize);
+            } catch (const std::regex_error&) {
+                qDebug() << "Invalid content search regex: " << pattern;
+                return result;
+            }
+        }
+
+        QList<YaffsItem*> files;
+        collectFiles(root, files);
+
+        QList<YaffsContentMatch> fileMatches = QtConcurrent::blockingMapped<QList<YaffsContentMatch> >(files, searchFile);
+        foreach (const YaffsContentMatch& match, fileMatches) {
+            if (match.numMatches > 0) {
+                result.append(match);
+            }
+        }
+    }
+    return result;
+}
+
+//new files only exist outside the image until it's saved, so they're left out
+void YaffsContentSearch::collectFiles(YaffsItem* item, QList<YaffsItem*>& files) {
+    if (item->isFile()) {
+        if (item->getCondition() != YaffsItem::NEW) {
+            files.append(item);
+        }
+    } else if (item->isDir()) {
+        int childCount = item->childCount();
+        for (int i = 0; i < childCount; ++i) {
+            collectFiles(item->child(i), files);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSCONTENTSEARCH_H
+#define YAFFSCONTENTSEARCH_H
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include "YaffsCheckpoint.h"
+
+class YaffsItem;
+
+struct YaffsContentMatch {
+    YaffsItem* item;
+    int numMatches;
+    QList<qint64> offsets;          //the first MAX_CONTENT_OFFSETS of them
+};
+
+//searches the data of the files in an image for a string or regex. the image is mapped
+//and each file's chunks are searched straight out of it, with the files spread over a thread
+//pool. nothing is written to disk. regexes use the ECMAScript syntax of std::regex and
+//only find matches up to MAX_REGEX_MATCH_LENGTH bytes long
+class YaffsContentSearch {
+public:
+    static const int MAX_CONTENT_OFFSETS = 100;
+    static const int MAX_REGEX_MATCH_LENGTH = 4096;
+
+    YaffsContentSearch(const QString& imageFilename, const YaffsChunkMap& chunkMap);
+    ~YaffsContentSearch();
+
+    bool open();
+    QList<YaffsContentMatch> search(YaffsItem* root, const QString& pattern, bool regex);
+
+private:
+    static void collectFiles(YaffsItem* item, QList<YaffsItem*>& files);
+
+private:
+    QFile mImageFile;
+    YaffsChunkMap mChunkMap;
+    const uchar* mImage;
+    qint64 mImageSize;
+};
+
+#endif  //YAFFSCONTENTSEARCH_H
@@ -40,6 +40,13 @@ YaffsControl::YaffsControl(const char* imageFileName, YaffsControlObserver* obse
     }
 
     mImageFile = NULL;
+    mWriteOptions = getDefaultWriteOptions();
+    mObjectId = 0;
+    mNumPages = 0;
+    mNumBlocks = 0;
+    mPagesInBlock = 0;
+    mSeqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER;
+    mCheckpointWritten = false;
 }
 
 YaffsControl::~YaffsControl() {
@@ -58,19 +65,221 @@ bool YaffsControl::open(OpenType openType) {
         mImageFile = fopen(mImageFilename, "rb+");
         break;
     case OPEN_NEW:
-        mImageFile = fopen(mImageFilename, "wb");
+        //opened for update too so a written checkpoint can be read back
+        mImageFile = fopen(mImageFilename, "wb+");
         mObjectId = YAFFS_NOBJECT_BUCKETS + 1;
         mNumPages = 0;
+        mNumBlocks = 0;
+        mPagesInBlock = 0;
+        mSeqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER - 1;
+        mObjects.clear();
+        mDataPages.clear();
+        mCheckpointWritten = false;
         break;
     }
 
     return (mImageFile != NULL);
 }
 
+YaffsWriteOptions YaffsControl::getDefaultWriteOptions() {
+    YaffsWriteOptions writeOptions;
+    writeOptions.pagesPerBlock = DEFAULT_PAGES_PER_BLOCK;
+    writeOptions.partitionBlocks = 0;
+    writeOptions.writeCheckpoint = false;
+    writeOptions.writeSummary = false;
+    return writeOptions;
+}
+
+//pad the last block with erased pages and, if asked, write a checkpoint and pad the image
+//with erased blocks up to the partition size
+bool YaffsControl::finishImage() {
+    bool result = (mImageFile != NULL);
+    int dataBlocks = mNumBlocks;
+    int pagesInLastBlock = mPagesInBlock;
+    if (result && mNumBlocks > 0) {
+        while (result && mPagesInBlock < mWriteOptions.pagesPerBlock) {
+            result = writeErasedPage();
+            mPagesInBlock++;
+        }
+    }
+
+    //the checkpoint describes the whole partition so it can only be written when the size is known
+    if (result && mWriteOptions.writeCheckpoint && mWriteOptions.partitionBlocks > 0) {
+        YaffsCheckpoint checkpoint(mWriteOptions.pagesPerBlock, mWriteOptions.partitionBlocks);
+        bool lastBlockFull = (pagesInLastBlock == mWriteOptions.pagesPerBlock);
+        for (int i = 0; i < dataBlocks; ++i) {
+            YaffsCheckpointBlock block;
+            bool lastBlock = (i == dataBlocks - 1);
+            block.hasSummary = (mWriteOptions.writeSummary && (!lastBlock || lastBlockFull));
+            block.state = (lastBlock && !lastBlockFull && !mWriteOptions.writeSummary ? YAFFS_BLOCK_STATE_ALLOCATING : YAFFS_BLOCK_STATE_FULL);
+            if (block.hasSummary) {
+                block.pagesInUse = getChunksPerSummary();
+            } else {
+                block.pagesInUse = (lastBlock ? pagesInLastBlock : mWriteOptions.pagesPerBlock);
+            }
+            block.seqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER + i;
+            checkpoint.setBlock(i, block);
+        }
+
+        //the kernel would write the summary of a partly used block without the tags it already
+        //has in it, so when writing summaries that block is left full rather than allocating from
+        if (dataBlocks > 0 && !lastBlockFull && !mWriteOptions.writeSummary) {
+            checkpoint.setAllocation(dataBlocks - 1, pagesInLastBlock, mSeqNumber);
+        } else {
+            checkpoint.setAllocation(-1, 0, mSeqNumber);
+        }
+
+        //the kernel creates these directories itself, they have no headers in the image
+        QVector<YaffsCheckpointObject> objects = mObjects;
+        int fakeDirs[] = { YAFFS_OBJECTID_LOSTNFOUND, YAFFS_OBJECTID_UNLINKED, YAFFS_OBJECTID_DELETED };
+        for (int i = 0; i < 3; ++i) {
+            YaffsCheckpointObject object;
+            memset(&object, 0, sizeof(YaffsCheckpointObject));
+            object.objectId = fakeDirs[i];
+            object.parentId = (fakeDirs[i] == YAFFS_OBJECTID_LOSTNFOUND ? YAFFS_OBJECTID_ROOT : 0);
+            object.type = YAFFS_OBJECT_TYPE_DIRECTORY;
+            object.headerPage = -1;
+            object.fake = true;
+            objects.append(object);
+        }
+        checkpoint.setObjects(objects, mDataPages);
+
+        result = writeCheckpoint(checkpoint.build());
+    }
+
+    if (result && mWriteOptions.partitionBlocks > 0) {
+        if (mNumBlocks > mWriteOptions.partitionBlocks) {
+            qDebug() << "Image needs " << mNumBlocks << " blocks but partition only has " << mWriteOptions.partitionBlocks;
+            result = false;
+        }
+
+        while (result && mNumBlocks < mWriteOptions.partitionBlocks) {
+            for (int i = 0; result && i < mWriteOptions.pagesPerBlock; ++i) {
+                result = writeErasedPage();
+            }
+            mNumBlocks++;
+        }
+    }
+
+    if (result) {
+        result = (fflush(mImageFile) == 0);
+    }
+
+    //make sure what was written parses back to the same objects
+    if (result && mCheckpointWritten) {
+        YaffsCheckpoint checkpoint(mWriteOptions.pagesPerBlock, 0);
+        if (readCheckpoint(checkpoint)) {
+            result = (checkpoint.getObjects().size() == mObjects.size() + 3 &&
+                      checkpoint.getDataPages() == mDataPages);
+        } else {
+            result = false;
+        }
+
+        if (!result) {
+            qDebug() << "Checkpoint failed to verify";
+        }
+        fseek(mImageFile, 0, SEEK_END);
+    }
+    return result;
+}
+
+//write the checkpoint data into the erased blocks following the data blocks
+bool YaffsControl::writeCheckpoint(const QByteArray& data) {
+    int blockBytes = mWriteOptions.pagesPerBlock * CHUNK_SIZE;
+    int numBlocks = (data.size() + blockBytes - 1) / blockBytes;
+    if (mNumBlocks + numBlocks > mWriteOptions.partitionBlocks) {
+        qDebug() << "No room for a checkpoint of " << numBlocks << " blocks, image written without one";
+        return true;
+    }
+
+    static yaffs_ext_tags t;
+    memset(&t, 0, sizeof(yaffs_ext_tags));
+    t.chunk_used = 1;
+    t.n_bytes = CHUNK_SIZE;
+    t.seq_number = YAFFS_SEQUENCE_CHECKPOINT_DATA;
+
+    bool result = true;
+    int pageSeq = 0;
+    int offset = 0;
+    for (int block = 0; result && block < numBlocks; ++block) {
+        mNumBlocks++;
+
+        //the object id is the kernel's hint of where to look for the next checkpoint block
+        t.obj_id = mNumBlocks + 1;
+        for (int page = 0; result && page < mWriteOptions.pagesPerBlock; ++page) {
+            if (offset < data.size()) {
+                int size = qMin(CHUNK_SIZE, data.size() - offset);
+                memset(mChunkData, 0, CHUNK_SIZE);
+                memcpy(mChunkData, data.constData() + offset, size);
+                offset += size;
+
+                t.chunk_id = ++pageSeq;
+                result = writeTags(t);
+            } else {
+                result = writeErasedPage();
+            }
+        }
+    }
+
+    mCheckpointWritten = result;
+    return result;
+}
+
+//gather the checkpoint chunks from the image and parse them
+bool YaffsControl::readCheckpoint(YaffsCheckpoint& checkpoint) {
+    bool result = false;
+    if (mImageFile && fseek(mImageFile, 0, SEEK_END) == 0) {
+        int ppb = mWriteOptions.pagesPerBlock;
+        long blockSize = static_cast<long>(ppb) * PAGE_SIZE;
+        int numBlocks = static_cast<int>(ftell(mImageFile) / blockSize);
+
+        QByteArray data;
+        int pageSeq = 0;
+        for (int block = 0; block < numBlocks; ++block) {
+            if (fseek(mImageFile, block * blockSize, SEEK_SET) != 0) {
+                break;
+            }
+
+            for (int page = 0; page < ppb && readPage() == 0; ++page) {
+                yaffs_ext_tags tags;
+                unpackTags(tags);
+                if (tags.seq_number != YAFFS_SEQUENCE_CHECKPOINT_DATA || tags.chunk_id != static_cast<u32>(pageSeq + 1)) {
+                    break;
+                }
+                data.append(reinterpret_cast<const char*>(mChunkData), CHUNK_SIZE);
+                pageSeq++;
+            }
+        }
+
+        if (data.size() > 0) {
+            checkpoint = YaffsCheckpoint(ppb, numBlocks);
+            result = checkpoint.parse(data);
+        }
+    }
+    return result;
+}
+
 bool YaffsControl::readImage() {
     int result = 0;
     memset(&mReadInfo, 0, sizeof(YaffsReadInfo));
+
+    //a valid checkpoint saves scanning every page of the image
+    if (readCheckpointObjects()) {
+        mReadInfo.result = true;
+        mReadInfo.fromCheckpoint = true;
+        mObserver->readComplete();
+        return true;
+    }
+
+    //block summaries save reading the tags of every page
+    if (readSummaryObjects()) {
+        mReadInfo.result = true;
+        mObserver->readComplete();
+        return true;
+    }
+
     if (mImageFile) {
+        fseek(mImageFile, 0, SEEK_SET);
         while (result == 0) {
             result = readPage();
             if (result == -1) {
@@ -88,10 +297,191 @@ bool YaffsControl::readImage() {
     return mReadInfo.result;
 }
 
+//read only the object headers the checkpoint points at, nothing is passed
+//to the observer unless every header is found where the checkpoint says
+bool YaffsControl::readCheckpointObjects() {
+    YaffsCheckpoint checkpoint(mWriteOptions.pagesPerBlock, 0);
+    if (!readCheckpoint(checkpoint)) {
+        return false;
+    }
+
+    const QVector<YaffsCheckpointObject>& objects = checkpoint.getObjects();
+    QVector<yaffs_obj_hdr> headers;
+    QVector<int> headerObjects;
+    headers.reserve(objects.size());
+    headerObjects.reserve(objects.size());
+
+    for (int i = 0; i < objects.size(); ++i) {
+        const YaffsCheckpointObject& object = objects.at(i);
+
+        //fake directories have no header, objects in the unlinked and deleted directories aren't in the tree
+        if (object.headerPage < 0 || object.parentId == YAFFS_OBJECTID_UNLINKED || object.parentId == YAFFS_OBJECTID_DELETED) {
+            continue;
+        }
+
+        if (fseek(mImageFile, static_cast<long>(object.headerPage) * PAGE_SIZE, SEEK_SET) != 0 || readPage() != 0) {
+            qDebug() << "Checkpoint header for object " << object.objectId << " is outside the image";
+            return false;
+        }
+
+        yaffs_ext_tags tags;
+        unpackTags(tags);
+        if (!isHeader(tags) || tags.obj_id != object.objectId) {
+            qDebug() << "Checkpoint header for object " << object.objectId << " doesn't match the image";
+            return false;
+        }
+
+        //the checkpoint has the current parent and size, the header may be older than a move or a write
+        headers.append(*reinterpret_cast<yaffs_obj_hdr*>(mChunkData));
+        if (object.objectId != YAFFS_OBJECTID_ROOT) {
+            headers.last().parent_obj_id = object.parentId;
+        }
+        if (object.type == YAFFS_OBJECT_TYPE_FILE) {
+            headers.last().file_size_low = object.fileSize;
+        }
+        headerObjects.append(i);
+    }
+
+    //file data is read through the checkpoint's pages from now on
+    mChunkMap = YaffsChunkMap(checkpoint);
+
+    for (int i = 0; i < headers.size(); ++i) {
+        const yaffs_obj_hdr* objectHeader = &headers.at(i);
+        const YaffsCheckpointObject& object = objects.at(headerObjects.at(i));
+        processHeader(object.objectId, objectHeader, static_cast<long>(object.headerPage) * PAGE_SIZE);
+    }
+
+    if (fseek(mImageFile, 0, SEEK_END) == 0) {
+        mReadInfo.eofHasIncompletePage = (ftell(mImageFile) % PAGE_SIZE != 0);
+    }
+    return true;
+}
+
+//read only the header pages listed in the block summaries, blocks without a
+//summary (such as a partly used last block) have their pages scanned instead
+bool YaffsControl::readSummaryObjects() {
+    u32 seqNumber = 0;
+    if (!mImageFile || !readSummary(0, seqNumber)) {
+        return false;
+    }
+
+    int ppb = mWriteOptions.pagesPerBlock;
+    int chunksPerSummary = getChunksPerSummary();
+    fseek(mImageFile, 0, SEEK_END);
+    long imageSize = ftell(mImageFile);
+    int numBlocks = static_cast<int>(imageSize / (static_cast<long>(ppb) * PAGE_SIZE));
+    mReadInfo.eofHasIncompletePage = (imageSize % PAGE_SIZE != 0);
+
+    for (int block = 0; block < numBlocks; ++block) {
+        int firstPage = block * ppb;
+        yaffs_ext_tags tags;
+
+        if (readSummary(block, seqNumber)) {
+            for (int i = 0; i < chunksPerSummary; ++i) {
+                yaffs_summary_fetch(&tags, &mSummaryTags.at(i), seqNumber);
+                if (isHeader(tags) && readHeaderAt(firstPage + i)) {
+                    processHeader(tags.obj_id, reinterpret_cast<yaffs_obj_hdr*>(mChunkData), static_cast<long>(firstPage + i) * PAGE_SIZE);
+                }
+            }
+        } else if (fseek(mImageFile, static_cast<long>(firstPage) * PAGE_SIZE, SEEK_SET) == 0) {
+            for (int i = 0; i < ppb && readPage() == 0; ++i) {
+                unpackTags(tags);
+                if (tags.seq_number == YAFFS_SEQUENCE_CHECKPOINT_DATA) {
+                    break;
+                }
+                if (isHeader(tags)) {
+                    processHeader(tags.obj_id, reinterpret_cast<yaffs_obj_hdr*>(mChunkData), static_cast<long>(firstPage + i) * PAGE_SIZE);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+//read the summary chunks of a block into mSummaryTags
+bool YaffsControl::readSummary(int block, u32& seqNumber) {
+    int chunksPerSummary = getChunksPerSummary();
+    long summaryPos = (static_cast<long>(block) * mWriteOptions.pagesPerBlock + chunksPerSummary) * PAGE_SIZE;
+    if (fseek(mImageFile, summaryPos, SEEK_SET) != 0) {
+        return false;
+    }
+
+    yaffs_summary_tags emptyTags;
+    memset(&emptyTags, 0, sizeof(yaffs_summary_tags));
+    mSummaryTags.fill(emptyTags, chunksPerSummary);
+
+    yaffs_summary_header header;
+    u8* sumBuffer = reinterpret_cast<u8*>(mSummaryTags.data());
+    int bytesRemaining = sizeof(yaffs_summary_tags) * chunksPerSummary;
+    int bytesPerChunk = CHUNK_SIZE - sizeof(yaffs_summary_header);
+    u32 chunkId = 1;
+    u32 sum = 0;
+
+    while (bytesRemaining > 0) {
+        yaffs_ext_tags tags;
+        if (readPage() != 0) {
+            return false;
+        }
+
+        unpackTags(tags);
+        memcpy(&header, mChunkData, sizeof(yaffs_summary_header));
+        if (tags.obj_id != YAFFS_OBJECTID_SUMMARY || tags.chunk_id != chunkId ||
+                header.version != YAFFS_SUMMARY_VERSION ||
+                header.block != static_cast<u32>(block + INTERNAL_BLOCK_OFFSET) ||
+                header.seq != tags.seq_number) {
+            return false;
+        }
+
+        if (chunkId == 1) {
+            seqNumber = header.seq;
+            sum = header.sum;
+        }
+
+        int size = qMin(bytesRemaining, bytesPerChunk);
+        memcpy(sumBuffer, mChunkData + sizeof(yaffs_summary_header), size);
+        sumBuffer += size;
+        bytesRemaining -= size;
+        chunkId++;
+    }
+
+    return (yaffs_summary_sum(mSummaryTags.constData(), chunksPerSummary) == sum);
+}
+
+//read the page and check it really is an object header
+bool YaffsControl::readHeaderAt(int page) {
+    bool result = false;
+    if (fseek(mImageFile, static_cast<long>(page) * PAGE_SIZE, SEEK_SET) == 0 && readPage() == 0) {
+        yaffs_ext_tags tags;
+        unpackTags(tags);
+        result = isHeader(tags);
+    }
+    return result;
+}
+
+//read a chunk of a file, counting from 0, into mChunkData from the page the chunk map has for it.
+//holes in the file read as zeros
+bool YaffsControl::readMappedChunk(const YaffsCheckpointObject& file, int chunk) {
+    int page = mChunkMap.getDataPage(file, chunk);
+    if (page < 0) {
+        memset(mChunkData, 0, CHUNK_SIZE);
+        return true;
+    }
+
+    bool result = false;
+    if (fseek(mImageFile, static_cast<long>(page) * PAGE_SIZE, SEEK_SET) == 0 && readPage() == 0) {
+        yaffs_ext_tags tags;
+        unpackTags(tags);
+        result = (tags.obj_id == file.objectId && tags.chunk_id == static_cast<u32>(chunk + 1));
+    }
+    return result;
+}
+
 int YaffsControl::addRoot(const yaffs_obj_hdr& objectHeader, int& headerPos) {
     headerPos = ftell(mImageFile);
     int objectId = YAFFS_OBJECTID_ROOT;
-    if (!writeHeader(objectHeader, objectId)) {
+    if (writeHeader(objectHeader, objectId)) {
+        addObject(objectId, objectHeader, headerPos, mDataPages.size());
+    } else {
         objectId = -1;
     }
     return objectId;
@@ -100,7 +490,9 @@ int YaffsControl::addRoot(const yaffs_obj_hdr& objectHeader, int& headerPos) {
 int YaffsControl::addDirectory(const yaffs_obj_hdr& objectHeader, int& headerPos) {
     headerPos = ftell(mImageFile);
     int objectId = mObjectId++;
-    if (!writeHeader(objectHeader, objectId)) {
+    if (writeHeader(objectHeader, objectId)) {
+        addObject(objectId, objectHeader, headerPos, mDataPages.size());
+    } else {
         objectId = -1;
     }
     return objectId;
@@ -117,11 +509,13 @@ int YaffsControl::addFile(const yaffs_obj_hdr& objectHeader, int& headerPos, con
 
     if (writeHeader(objectHeader, objectId)) {
         wroteHeader = true;
+        addObject(objectId, objectHeader, headerPos, mDataPages.size());
         int chunkId = 0;
 
         const char* dataPtr = data;
         for (int i = 0; i < chunks; ++i) {
             memcpy(mChunkData, dataPtr, CHUNK_SIZE);
+            mDataPages.append(mNumPages);
             if (writePage(objectId, ++chunkId, CHUNK_SIZE)) {
                 pagesWritten++;
             }
@@ -131,6 +525,7 @@ int YaffsControl::addFile(const yaffs_obj_hdr& objectHeader, int& headerPos, con
         if (remainder > 0) {
             memset(mChunkData + remainder, 0xff, CHUNK_SIZE - remainder);
             memcpy(mChunkData, dataPtr, remainder);
+            mDataPages.append(mNumPages);
             if (writePage(objectId, ++chunkId, remainder)) {
                 pagesWritten++;
             }
@@ -144,26 +539,106 @@ int YaffsControl::addFile(const yaffs_obj_hdr& objectHeader, int& headerPos, con
     return objectId;
 }
 
+//copies the data chunks of a file in another image page by page, retagged with the new object id.
+//each page is read into the same buffer it's written from so the data is never held as a whole
+int YaffsControl::copyFile(const yaffs_obj_hdr& objectHeader, int& headerPos, YaffsControl& source, int sourceHeaderPos) {
+    headerPos = ftell(mImageFile);
+    YaffsCheckpointObject mappedFile;
+    bool mapped = source.mChunkMap.findFile(sourceHeaderPos, mappedFile);
+    u32 sourceObjectId = 0;
+    if (source.mImageFile && fseek(source.mImageFile, sourceHeaderPos, SEEK_SET) == 0 && source.readPage() == 0) {
+        yaffs_ext_tags tags;
+        unpackTags(tags);
+        if (isHeader(tags)) {
+            sourceObjectId = tags.obj_id;
+        }
+    }
+    if (sourceObjectId == 0) {
+        return -1;
+    }
+
+    int objectId = mObjectId++;
+    if (writeHeader(objectHeader, objectId)) {
+        addObject(objectId, objectHeader, headerPos, mDataPages.size());
+        size_t bytesRemaining = static_cast<size_t>(objectHeader.file_size_low);
+        u32 chunkId = 0;
+        while (bytesRemaining > 0) {
+            u32 size;
+            if (mapped) {
+                if (!source.readMappedChunk(mappedFile, static_cast<int>(chunkId))) {
+                    objectId = -1;
+                    break;
+                }
+                size = (bytesRemaining < CHUNK_SIZE ? static_cast<u32>(bytesRemaining) : CHUNK_SIZE);
+            } else {
+                if (source.readPage() != 0) {
+                    objectId = -1;
+                    break;
+                }
+
+                //step over summary chunks and erased pages between the data chunks
+                yaffs_ext_tags tags;
+                unpackTags(tags);
+                if (tags.obj_id != sourceObjectId || tags.chunk_id == 0) {
+                    continue;
+                }
+                if (tags.n_bytes > CHUNK_SIZE) {
+                    objectId = -1;
+                    break;
+                }
+                size = (bytesRemaining < tags.n_bytes ? static_cast<u32>(bytesRemaining) : tags.n_bytes);
+            }
+
+            memset(mChunkData + size, 0xff, CHUNK_SIZE - size);
+            mDataPages.append(mNumPages);
+            if (!writePage(objectId, ++chunkId, size)) {
+                objectId = -1;
+                break;
+            }
+            bytesRemaining -= size;
+        }
+    } else {
+        objectId = -1;
+    }
+
+    return objectId;
+}
+
 int YaffsControl::addSymLink(const yaffs_obj_hdr& objectHeader, int& headerPos) {
     headerPos = ftell(mImageFile);
     int objectId = mObjectId++;
-    if (!writeHeader(objectHeader, objectId)) {
+    if (writeHeader(objectHeader, objectId)) {
+        addObject(objectId, objectHeader, headerPos, mDataPages.size());
+    } else {
         objectId = -1;
     }
     return objectId;
 }
 
+void YaffsControl::addObject(u32 objectId, const yaffs_obj_hdr& objectHeader, int headerPos, int firstDataChunk) {
+    YaffsCheckpointObject object;
+    object.objectId = objectId;
+    object.parentId = (objectId == YAFFS_OBJECTID_ROOT ? 0 : objectHeader.parent_obj_id);
+    object.type = objectHeader.type;
+    object.headerPage = headerPos / PAGE_SIZE;
+    object.fake = (objectId == YAFFS_OBJECTID_ROOT);
+    object.fileSize = objectHeader.file_size_low;
+    object.firstDataChunk = firstDataChunk;
+    object.numDataChunks = (objectHeader.type == YAFFS_OBJECT_TYPE_FILE ? (objectHeader.file_size_low + CHUNK_SIZE - 1) / CHUNK_SIZE : 0);
+    mObjects.append(object);
+}
+
 bool YaffsControl::writeHeader(const yaffs_obj_hdr& objectHeader, u32 objectId) {
     bool result = false;
     if (mImageFile) {
         memset(mChunkData, 0xff, CHUNK_SIZE);
         memcpy(mChunkData, &objectHeader, sizeof(yaffs_obj_hdr));
-        result = writePage(objectId, 0, 0xffff);
+        result = writePage(objectId, 0, 0xffff, &objectHeader);
     }
     return result;
 }
 
-bool YaffsControl::writePage(u32 objectId, u32 chunkId, u32 numBytes) {
+bool YaffsControl::writePage(u32 objectId, u32 chunkId, u32 numBytes, const yaffs_obj_hdr* objectHeader) {
     bool result = false;
 
     static yaffs_ext_tags t;
@@ -173,28 +648,131 @@ bool YaffsControl::writePage(u32 objectId, u32 chunkId, u32 numBytes) {
     t.chunk_id = chunkId;
     t.n_bytes = numBytes;
     t.serial_number = 1;
-    t.seq_number = YAFFS_LOWEST_SEQUENCE_NUMBER;
 
+    //start a new erase block with the next sequence number once the current one is full
+    if (mNumBlocks == 0 || mPagesInBlock >= mWriteOptions.pagesPerBlock) {
+        mSeqNumber++;
+        mNumBlocks++;
+        mPagesInBlock = 0;
+    }
+    t.seq_number = mSeqNumber;
+
+    //pack the extra header info into the tags so a scan can build the tree from the spare area alone
+    if (objectHeader) {
+        t.extra_available = 1;
+        t.extra_parent_id = objectHeader->parent_obj_id;
+        t.extra_obj_type = objectHeader->type;
+        t.extra_file_size = objectHeader->file_size_low;
+        t.extra_equiv_id = objectHeader->equiv_id;
+    }
+
+    if (writeTags(t)) {
+        result = true;
+
+        //once the data pages of a block are used up the summary fills the rest of it
+        if (mWriteOptions.writeSummary) {
+            int chunksPerSummary = getChunksPerSummary();
+            if (mPagesInBlock == 0) {
+                yaffs_summary_tags emptyTags;
+                memset(&emptyTags, 0, sizeof(yaffs_summary_tags));
+                mSummaryTags.fill(emptyTags, chunksPerSummary);
+            }
+
+            yaffs_summary_add(&mSummaryTags[mPagesInBlock], &t);
+            if (mPagesInBlock + 1 == chunksPerSummary) {
+                result = writeSummary(mNumBlocks - 1, mSeqNumber);
+                mPagesInBlock = mWriteOptions.pagesPerBlock - 1;
+            }
+        }
+        mPagesInBlock++;
+    }
+
+    return result;
+}
+
+//write the summary chunks for the block, padding the block out with erased pages
+bool YaffsControl::writeSummary(int block, u32 seqNumber) {
+    int chunksPerSummary = getChunksPerSummary();
+    yaffs_summary_header header;
+    header.version = YAFFS_SUMMARY_VERSION;
+    header.block = block + INTERNAL_BLOCK_OFFSET;
+    header.seq = seqNumber;
+    header.sum = yaffs_summary_sum(mSummaryTags.constData(), chunksPerSummary);
+
+    static yaffs_ext_tags t;
+    memset(&t, 0, sizeof(yaffs_ext_tags));
+    t.chunk_used = 1;
+    t.obj_id = YAFFS_OBJECTID_SUMMARY;
+    t.chunk_id = 1;
+    t.seq_number = seqNumber;
+
+    const u8* sumBuffer = reinterpret_cast<const u8*>(mSummaryTags.constData());
+    int bytesRemaining = sizeof(yaffs_summary_tags) * chunksPerSummary;
+    int bytesPerChunk = CHUNK_SIZE - sizeof(yaffs_summary_header);
+    int pagesWritten = chunksPerSummary;
+    bool result = true;
+
+    while (result && bytesRemaining > 0) {
+        int size = qMin(bytesRemaining, bytesPerChunk);
+        memset(mChunkData, 0xff, CHUNK_SIZE);
+        memcpy(mChunkData, &header, sizeof(yaffs_summary_header));
+        memcpy(mChunkData + sizeof(yaffs_summary_header), sumBuffer, size);
+        t.n_bytes = size + sizeof(yaffs_summary_header);
+        result = writeTags(t);
+
+        sumBuffer += size;
+        bytesRemaining -= size;
+        pagesWritten++;
+        t.chunk_id++;
+    }
+
+    while (result && pagesWritten < mWriteOptions.pagesPerBlock) {
+        result = writeErasedPage();
+        pagesWritten++;
+    }
+    return result;
+}
+
+int YaffsControl::getChunksPerSummary() const {
+    return mWriteOptions.pagesPerBlock - yaffs_summary_chunks(mWriteOptions.pagesPerBlock, CHUNK_SIZE);
+}
+
+//pack the tags into the spare area and write out the page
+bool YaffsControl::writeTags(const yaffs_ext_tags& tags) {
     memset(mSpareData, 0xff, SPARE_SIZE);
     yaffs_packed_tags2* pt = reinterpret_cast<yaffs_packed_tags2*>(mSpareData);
-    yaffs_pack_tags2(pt, &t, 1);
+    yaffs_pack_tags2(pt, &tags, 1);
 
-    if (fwrite(mPageData, PAGE_SIZE, 1, mImageFile) == 1) {
-        result = true;
+    bool result = (fwrite(mPageData, PAGE_SIZE, 1, mImageFile) == 1);
+    if (result) {
         mNumPages++;
     }
+    return result;
+}
 
+bool YaffsControl::writeErasedPage() {
+    memset(mPageData, 0xff, PAGE_SIZE);
+    bool result = (fwrite(mPageData, PAGE_SIZE, 1, mImageFile) == 1);
+    if (result) {
+        mNumPages++;
+    }
     return result;
 }
 
 char* YaffsControl::extractFile(int objectHeaderPos, size_t& bytesExtracted) {
+    YaffsCheckpointObject mappedFile;
+    if (mImageFile && mChunkMap.findFile(objectHeaderPos, mappedFile)) {
+        return extractMappedFile(mappedFile, bytesExtracted);
+    }
+
     char* data = NULL;
     char* dataPtr;
     if (mImageFile) {
         if (fseek(mImageFile, objectHeaderPos, SEEK_SET) == 0) {
             if (readPage() == 0) {
-                yaffs_packed_tags2* pt = (yaffs_packed_tags2*)mSpareData;
-                if (pt->t.n_bytes == 0xffff) {
+                yaffs_ext_tags tags;
+                unpackTags(tags);
+                if (isHeader(tags)) {
                     yaffs_obj_hdr* objectHeader = reinterpret_cast<yaffs_obj_hdr*>(mChunkData);
                     if (objectHeader->file_size_low > 0) {
                         data = new char[objectHeader->file_size_low];
@@ -205,10 +783,18 @@ char* YaffsControl::extractFile(int objectHeaderPos, size_t& bytesExtracted) {
 
                         bool success = true;
                         int readResult;
+                        u32 objectId = tags.obj_id;
                         while (bytesRemaining > 0) {
                             readResult = readPage();
                             if (readResult == 0) {
-                                size = (bytesRemaining < pt->t.n_bytes) ? bytesRemaining : pt->t.n_bytes;
+                                unpackTags(tags);
+
+                                //step over summary chunks and erased pages between the data chunks
+                                if (tags.obj_id != objectId || tags.chunk_id == 0) {
+                                    continue;
+                                }
+
+                                size = (bytesRemaining < tags.n_bytes) ? bytesRemaining : tags.n_bytes;
                                 void* dest = memcpy(dataPtr, mChunkData, size);
                                 if (dest != dataPtr) {
                                     success = false;
@@ -216,7 +802,7 @@ char* YaffsControl::extractFile(int objectHeaderPos, size_t& bytesExtracted) {
                                 }
                                 dataPtr += size;
                                 bytesExtracted += size;
-                            } else if (readResult == -1) {
+                            } else {
                                 success = false;
                                 break;
                             }
@@ -225,7 +811,7 @@ char* YaffsControl::extractFile(int objectHeaderPos, size_t& bytesExtracted) {
                         }
 
                         if (!success) {
-                            delete data;
+                            delete[] data;
                             data = NULL;
                         }
                     }
@@ -237,9 +823,41 @@ char* YaffsControl::extractFile(int objectHeaderPos, size_t& bytesExtracted) {
     return data;
 }
 
+//the checkpoint has the current size and pages of the file, the header may be older
+char* YaffsControl::extractMappedFile(const YaffsCheckpointObject& file, size_t& bytesExtracted) {
+    char* data = NULL;
+    bytesExtracted = 0;
+    if (file.fileSize > 0) {
+        data = new char[file.fileSize];
+        size_t bytesRemaining = file.fileSize;
+        for (int chunk = 0; bytesRemaining > 0; ++chunk) {
+            if (!readMappedChunk(file, chunk)) {
+                delete[] data;
+                data = NULL;
+                break;
+            }
+
+            size_t size = (bytesRemaining < CHUNK_SIZE ? bytesRemaining : CHUNK_SIZE);
+            memcpy(data + bytesExtracted, mChunkData, size);
+            bytesExtracted += size;
+            bytesRemaining -= size;
+        }
+    }
+    return data;
+}
+
 bool YaffsControl::updateHeader(int objectHeaderPos, const yaffs_obj_hdr& objectHeader, int objectId) {
     bool result = false;
     if (mImageFile) {
+        //rewrite the header in place, keeping the sequence number of the block it's in
+        if (fseek(mImageFile, objectHeaderPos, SEEK_SET) == 0 && readPage() == 0) {
+            yaffs_ext_tags tags;
+            unpackTags(tags);
+            mSeqNumber = tags.seq_number;
+            mNumBlocks = 1;
+            mPagesInBlock = 0;
+        }
+
         if (fseek(mImageFile, objectHeaderPos, SEEK_SET) == 0) {
             result = writeHeader(objectHeader, objectId);
             if (result) {
@@ -248,6 +866,25 @@ bool YaffsControl::updateHeader(int objectHeaderPos, const yaffs_obj_hdr& object
                 qDebug() << "Failed to write header";
             }
         }
+
+        //keep the summary of the block in step with the new tags
+        if (result) {
+            yaffs_packed_tags2_tags_only packedTags = reinterpret_cast<yaffs_packed_tags2*>(mSpareData)->t;
+            int page = objectHeaderPos / PAGE_SIZE;
+            int block = page / mWriteOptions.pagesPerBlock;
+            int pageInBlock = page % mWriteOptions.pagesPerBlock;
+            u32 seqNumber;
+
+            if (pageInBlock < getChunksPerSummary() && readSummary(block, seqNumber)) {
+                yaffs_summary_tags& summaryTags = mSummaryTags[pageInBlock];
+                summaryTags.obj_id = packedTags.obj_id;
+                summaryTags.chunk_id = packedTags.chunk_id;
+                summaryTags.n_bytes = packedTags.n_bytes;
+
+                long summaryPos = (static_cast<long>(block) * mWriteOptions.pagesPerBlock + getChunksPerSummary()) * PAGE_SIZE;
+                result = (fseek(mImageFile, summaryPos, SEEK_SET) == 0 && writeSummary(block, seqNumber));
+            }
+        }
     }
     return result;
 }
@@ -266,52 +903,65 @@ int YaffsControl::readPage() {
     return result;
 }
 
+void YaffsControl::unpackTags(yaffs_ext_tags& tags) {
+    yaffs_packed_tags2* pt = reinterpret_cast<yaffs_packed_tags2*>(mSpareData);
+    yaffs_unpack_tags2_tags_only(&tags, &pt->t);
+}
+
+bool YaffsControl::isHeader(const yaffs_ext_tags& tags) {
+    //header chunks are written either with n_bytes of 0xffff (mkyaffs2image) or with
+    //the extra header info packed in, both of which unpack to a chunk id of 0
+    return (tags.chunk_used && tags.obj_id > 0 && tags.chunk_id == 0);
+}
+
 void YaffsControl::processPage() {
-    yaffs_packed_tags2* pt = (yaffs_packed_tags2*)mSpareData;
+    yaffs_ext_tags tags;
+    unpackTags(tags);
 
-    if (pt->t.n_bytes == 0xffff) {       //a new object
+    if (isHeader(tags)) {                //a new object
         yaffs_obj_hdr* objectHeader = reinterpret_cast<yaffs_obj_hdr*>(mChunkData);
 
-        switch (objectHeader->type) {
-            case YAFFS_OBJECT_TYPE_FILE:
-                mReadInfo.numFiles++;
-                break;
-            case YAFFS_OBJECT_TYPE_SYMLINK:
-                mReadInfo.numSymLinks++;
-                break;
-            case YAFFS_OBJECT_TYPE_DIRECTORY:
-                mReadInfo.numDirs++;
-                break;
-            case YAFFS_OBJECT_TYPE_HARDLINK:
-                mReadInfo.numHardLinks++;
-                break;
-            case YAFFS_OBJECT_TYPE_UNKNOWN:
-                mReadInfo.numUnknowns++;
-                break;
-            case YAFFS_OBJECT_TYPE_SPECIAL:
-                mReadInfo.numSpecials++;
-                break;
-            default:
-                mReadInfo.numErrorousObjects++;
-                break;
-        }
-
-        if (objectHeader->type == YAFFS_OBJECT_TYPE_FILE ||
-                objectHeader->type == YAFFS_OBJECT_TYPE_DIRECTORY ||
-                objectHeader->type == YAFFS_OBJECT_TYPE_SYMLINK) {
+        //calculate header position to pass to observer
+        long headerPos = ftell(mImageFile) - PAGE_SIZE;
+        processHeader(tags.obj_id, objectHeader, headerPos);
 
-            //calculate header position to pass to observer
-            long headerPos = ftell(mImageFile) - PAGE_SIZE;
+        //skip over the chunks for the file data
+        if (objectHeader->type == YAFFS_OBJECT_TYPE_FILE) {
+            int pagePadding = PAGE_SIZE - (objectHeader->file_size_low % PAGE_SIZE);
+            fseek(mImageFile, objectHeader->file_size_low + pagePadding, SEEK_CUR);
+        }
+    }
+}
 
-            //skip over the chunks for the file data
-            if (objectHeader->type == YAFFS_OBJECT_TYPE_FILE) {
-                int pagePadding = PAGE_SIZE - (objectHeader->file_size_low % PAGE_SIZE);
-                fseek(mImageFile, objectHeader->file_size_low + pagePadding, SEEK_CUR);
-            }
+//count the object and pass it on to the observer if it's a type the model shows
+void YaffsControl::processHeader(u32 objectId, const yaffs_obj_hdr* objectHeader, long headerPos) {
+    switch (objectHeader->type) {
+        case YAFFS_OBJECT_TYPE_FILE:
+            mReadInfo.numFiles++;
+            break;
+        case YAFFS_OBJECT_TYPE_SYMLINK:
+            mReadInfo.numSymLinks++;
+            break;
+        case YAFFS_OBJECT_TYPE_DIRECTORY:
+            mReadInfo.numDirs++;
+            break;
+        case YAFFS_OBJECT_TYPE_HARDLINK:
+            mReadInfo.numHardLinks++;
+            break;
+        case YAFFS_OBJECT_TYPE_UNKNOWN:
+            mReadInfo.numUnknowns++;
+            break;
+        case YAFFS_OBJECT_TYPE_SPECIAL:
+            mReadInfo.numSpecials++;
+            break;
+        default:
+            mReadInfo.numErrorousObjects++;
+            break;
+    }
 
-            if (mObserver) {
-                mObserver->newItem(pt->t.obj_id, objectHeader, headerPos);
-            }
-        }
+    if (mObserver && (objectHeader->type == YAFFS_OBJECT_TYPE_FILE ||
+                      objectHeader->type == YAFFS_OBJECT_TYPE_DIRECTORY ||
+                      objectHeader->type == YAFFS_OBJECT_TYPE_SYMLINK)) {
+        mObserver->newItem(objectId, objectHeader, headerPos);
     }
 }
@@ -20,6 +20,7 @@
 #define YAFFSREADER_H
 
 #include "Yaffs2.h"
+#include "YaffsCheckpoint.h"
 
 class YaffsControlObserver {
 public:
@@ -37,6 +38,14 @@ struct YaffsReadInfo {
     int numUnknowns;
     int numSpecials;
     int numErrorousObjects;
+    bool fromCheckpoint;            //tree was built from the checkpoint rather than a full scan
+};
+
+struct YaffsWriteOptions {
+    int pagesPerBlock;
+    int partitionBlocks;            //pad the image with erased blocks up to this size, 0 for no padding
+    bool writeCheckpoint;           //write a checkpoint after the data blocks, needs partitionBlocks
+    bool writeSummary;              //end each full block with a summary of its tags
 };
 
 class YaffsControl {
@@ -51,6 +60,12 @@ public:
     ~YaffsControl();
 
     bool open(OpenType openType);
+    void setWriteOptions(const YaffsWriteOptions& writeOptions) { mWriteOptions = writeOptions; }
+    bool finishImage();
+    bool hasCheckpoint() const { return mCheckpointWritten; }
+    bool readCheckpoint(YaffsCheckpoint& checkpoint);
+    void setChunkMap(const YaffsChunkMap& chunkMap) { mChunkMap = chunkMap; }
+    const YaffsChunkMap& getChunkMap() const { return mChunkMap; }
     bool readImage();
     YaffsReadInfo getReadInfo() { return mReadInfo; }
     char* extractFile(int objectHeaderPos, size_t& bytesExtracted);
@@ -59,13 +74,31 @@ public:
     int addRoot(const yaffs_obj_hdr& objectHeader, int& headerPos);
     int addDirectory(const yaffs_obj_hdr& objectHeader, int& headerPos);
     int addFile(const yaffs_obj_hdr& objectHeader, int& headerPos, const char* data, int fileSize);
+    int copyFile(const yaffs_obj_hdr& objectHeader, int& headerPos, YaffsControl& source, int sourceHeaderPos);
     int addSymLink(const yaffs_obj_hdr& objectHeader, int& headerPos);
 
+    static YaffsWriteOptions getDefaultWriteOptions();
+
 private:
     int readPage();
     void processPage();
-    bool writePage(u32 objectId, u32 chunkId, u32 numBytes);
+    bool readCheckpointObjects();
+    bool readSummaryObjects();
+    bool readSummary(int block, u32& seqNumber);
+    bool readHeaderAt(int page);
+    bool readMappedChunk(const YaffsCheckpointObject& file, int chunk);
+    char* extractMappedFile(const YaffsCheckpointObject& file, size_t& bytesExtracted);
+    void processHeader(u32 objectId, const yaffs_obj_hdr* objectHeader, long headerPos);
+    void unpackTags(yaffs_ext_tags& tags);
+    static bool isHeader(const yaffs_ext_tags& tags);
+    bool writePage(u32 objectId, u32 chunkId, u32 numBytes, const yaffs_obj_hdr* objectHeader = NULL);
     bool writeHeader(const yaffs_obj_hdr& objectHeader, u32 objectId);
+    bool writeErasedPage();
+    bool writeTags(const yaffs_ext_tags& tags);
+    bool writeCheckpoint(const QByteArray& data);
+    bool writeSummary(int block, u32 seqNumber);
+    int getChunksPerSummary() const;
+    void addObject(u32 objectId, const yaffs_obj_hdr& objectHeader, int headerPos, int firstDataChunk);
 
 private:
     YaffsControlObserver* mObserver;
@@ -77,8 +110,17 @@ private:
     static u8* mChunkData;
     static u8* mSpareData;
 
+    YaffsWriteOptions mWriteOptions;
     int mObjectId;
     int mNumPages;
+    int mNumBlocks;
+    int mPagesInBlock;
+    u32 mSeqNumber;
+    QVector<YaffsCheckpointObject> mObjects;
+    QVector<int> mDataPages;
+    QVector<yaffs_summary_tags> mSummaryTags;
+    bool mCheckpointWritten;
+    YaffsChunkMap mChunkMap;                //data pages from the checkpoint the tree was read from
 };
 
 #endif  //YAFFSREADER_H
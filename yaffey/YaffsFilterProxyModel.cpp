@@ -0,0 +1,167 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QStringList>
+#include <QColor>
+#include <QFont>
+
+#include "YaffsFilterProxyModel.h"
+
+YaffsFilterProxyModel::YaffsFilterProxyModel(QObject* parent) : QSortFilterProxyModel(parent) {
+    mFiltering = false;
+}
+
+//returns the number of items that matched, an empty pattern shows everything again
+int YaffsFilterProxyModel::setSearch(const QString& pattern, YaffsNameIndex::MatchMode mode) {
+    YaffsModel* yaffsModel = static_cast<YaffsModel*>(sourceModel());
+    int numMatches = 0;
+
+    mAccepted.clear();
+    mContentMatches.clear();
+    mFiltering = (yaffsModel && pattern.length() > 0);
+    if (mFiltering) {
+        QList<YaffsItem*> matches = yaffsModel->findItems(pattern, mode);
+        numMatches = matches.size();
+        foreach (YaffsItem* item, matches) {
+            accept(item);
+        }
+    }
+
+    invalidateFilter();
+    return numMatches;
+}
+
+//shows the files whose data contains the pattern, returns the total number of matches
+int YaffsFilterProxyModel::setContentSearch(const QString& pattern, bool regex) {
+    YaffsModel* yaffsModel = static_cast<YaffsModel*>(sourceModel());
+    int numMatches = 0;
+
+    mAccepted.clear();
+    mContentMatches.clear();
+    mFiltering = (yaffsModel && pattern.length() > 0);
+    if (mFiltering) {
+        QList<YaffsContentMatch> matches = yaffsModel->findContent(pattern, regex);
+        foreach (const YaffsContentMatch& match, matches) {
+            numMatches += match.numMatches;
+            mContentMatches.insert(match.item, match);
+            accept(match.item);
+        }
+    }
+
+    invalidateFilter();
+    return numMatches;
+}
+
+//drops the matches at or below rows that are about to be deleted, so a content search doesn't
+//have to read every file again. the directories that only led to them are hidden as well
+void YaffsFilterProxyModel::removeContentMatches(const QModelIndexList& sourceRows) {
+    QSet<const YaffsItem*> removedItems;
+    foreach (const QModelIndex& index, sourceRows) {
+        removedItems.insert(static_cast<const YaffsItem*>(index.internalPointer()));
+    }
+
+    QHash<const YaffsItem*, YaffsContentMatch>::iterator it = mContentMatches.begin();
+    while (it != mContentMatches.end()) {
+        const YaffsItem* item = it.key();
+        while (item != NULL && !removedItems.contains(item)) {
+            item = item->parent();
+        }
+        if (item != NULL) {
+            it = mContentMatches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    mAccepted.clear();
+    foreach (const YaffsContentMatch& match, mContentMatches) {
+        accept(match.item);
+    }
+    invalidateFilter();
+}
+
+//the rows have to be in the model before they can pass the filter
+void YaffsFilterProxyModel::accept(YaffsItem* item) {
+    static_cast<YaffsModel*>(sourceModel())->fetchItem(item);
+    for (const YaffsItem* accept = item; accept != NULL && !mAccepted.contains(accept); accept = accept->parent()) {
+        mAccepted.insert(accept);
+    }
+}
+
+//files found by a content search list where the matches are as path:offset
+QVariant YaffsFilterProxyModel::data(const QModelIndex& index, int role) const {
+    if (role == Qt::ToolTipRole && index.column() == 0 && !mContentMatches.isEmpty()) {
+        const YaffsItem* item = static_cast<const YaffsItem*>(mapToSource(index).internalPointer());
+        QHash<const YaffsItem*, YaffsContentMatch>::const_iterator it = mContentMatches.constFind(item);
+        if (it != mContentMatches.constEnd()) {
+            QString path = item->getFullPath();
+            QStringList lines;
+            foreach (qint64 offset, it->offsets) {
+                lines.append(path + ":" + QString::number(offset));
+            }
+            if (it->numMatches > it->offsets.size()) {
+                lines.append("(" + QString::number(it->numMatches - it->offsets.size()) + " more)");
+            }
+            return lines.join("\n");
+        }
+    }
+    if (role == Qt::ForegroundRole || role == Qt::FontRole) {
+        return style(mapToSource(index), role);
+    }
+    return QSortFilterProxyModel::data(index, role);
+}
+
+//how the items look is decided here so the model itself doesn't need the gui
+QVariant YaffsFilterProxyModel::style(const QModelIndex& sourceIndex, int role) const {
+    QVariant result = QVariant();
+    const YaffsItem* item = static_cast<const YaffsItem*>(sourceIndex.internalPointer());
+    if (sourceIndex.isValid() && item) {
+        if (role == Qt::ForegroundRole) {
+            if (sourceIndex.column() == YaffsItem::NAME) {
+                if (static_cast<YaffsModel*>(sourceModel())->isImportPlaceholder(item)) {
+                    result = QVariant(QColor(Qt::gray));
+                } else if (item->isDir()) {
+                    result = QVariant(QColor(Qt::blue));
+                } else if (item->isFile()) {
+                    result = QVariant(QColor(Qt::black));
+                } else if (item->isSymLink()) {
+                    result = QVariant(QColor(Qt::darkGreen));
+                }
+            }
+        } else if (role == Qt::FontRole) {
+            if (sourceIndex.column() == YaffsItem::PERMISSIONS) {
+                result = QFont("Courier");
+            }
+        }
+    }
+    return result;
+}
+
+void YaffsFilterProxyModel::sort(int column, Qt::SortOrder order) {
+    if (sourceModel()) {
+        sourceModel()->sort(column, order);
+    }
+}
+
+bool YaffsFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const {
+    if (!mFiltering) {
+        return true;
+    }
+    QModelIndex sourceIndex = sourceModel()->index(sourceRow, 0, sourceParent);
+    return mAccepted.contains(static_cast<const YaffsItem*>(sourceIndex.internalPointer()));
+}
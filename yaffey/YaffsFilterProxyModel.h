@@ -0,0 +1,58 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSFILTERPROXYMODEL_H
+#define YAFFSFILTERPROXYMODEL_H
+
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <QHash>
+
+#include "YaffsModel.h"
+
+//filters the tree down to the items matching a search and the directories leading to them,
+//sorting is left to the YaffsModel underneath
+class YaffsFilterProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+
+public:
+    YaffsFilterProxyModel(QObject* parent = 0);
+
+    int setSearch(const QString& pattern, YaffsNameIndex::MatchMode mode);
+    int setContentSearch(const QString& pattern, bool regex);
+    void removeContentMatches(const QModelIndexList& sourceRows);
+    bool isFiltering() const { return mFiltering; }
+
+    //from QSortFilterProxyModel
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const;
+
+private:
+    QVariant style(const QModelIndex& sourceIndex, int role) const;
+    void accept(YaffsItem* item);
+
+private:
+    QSet<const YaffsItem*> mAccepted;
+    QHash<const YaffsItem*, YaffsContentMatch> mContentMatches;     //tooltips for the files a content search found
+    bool mFiltering;
+};
+
+#endif  //YAFFSFILTERPROXYMODEL_H
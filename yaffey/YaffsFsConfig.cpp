@@ -0,0 +1,139 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <QDebug>
+
+#include "YaffsFsConfig.h"
+#include "YaffsItem.h"
+#include "AndroidIDs.h"
+
+YaffsFsConfig::YaffsFsConfig() {
+    mNumErrors = 0;
+}
+
+//the mount point is the path of the image root in the list, so with system an image
+//path of /bin/sh is looked up as system/bin/sh
+bool YaffsFsConfig::load(const QString& filename, const QString& mountPoint) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    mPaths.clear();
+    mPrefixes.clear();
+    mNumErrors = 0;
+    mMountPoint = mountPoint;
+    while (mMountPoint.startsWith('/')) {
+        mMountPoint.remove(0, 1);
+    }
+    while (mMountPoint.endsWith('/')) {
+        mMountPoint.chop(1);
+    }
+
+    QRegExp whitespace("\\s+");
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        QString line = stream.readLine().trimmed();
+        if (line.length() == 0 || line.startsWith('#')) {
+            continue;
+        }
+
+        //anything after the mode, like capabilities, isn't something yaffs can store
+        QStringList fields = line.split(whitespace);
+        Entry entry;
+        bool modeOk = false;
+        if (fields.size() >= 4) {
+            entry.mode = fields.at(3).toUInt(&modeOk, 8);
+        }
+        if (!modeOk || !parseId(fields.at(1), entry.uid) || !parseId(fields.at(2), entry.gid)) {
+            qDebug() << "Bad fs_config line: " << line;
+            mNumErrors++;
+            continue;
+        }
+
+        QString path = fields.at(0);
+        while (path.startsWith('/')) {
+            path.remove(0, 1);
+        }
+        if (path.endsWith('*')) {
+            path.chop(1);
+            mPrefixes.insert(path, entry);
+        } else {
+            while (path.endsWith('/')) {
+                path.chop(1);
+            }
+            mPaths.insert(path, entry);
+        }
+    }
+    return true;
+}
+
+//ids can be numbers or the android names for them
+bool YaffsFsConfig::parseId(const QString& text, uint& id) {
+    bool ok;
+    id = text.toUInt(&ok);
+    if (!ok) {
+        QMap<int, QString>::const_iterator i;
+        for (i = ANDROID_IDS.begin(); i != ANDROID_IDS.end(); ++i) {
+            if (i.value() == text) {
+                id = i.key();
+                return true;
+            }
+        }
+    }
+    return ok;
+}
+
+//sets the item's owner and permission bits from the entry for its path in the image, the type
+//bits are left alone. returns false if nothing in the list covers the path
+bool YaffsFsConfig::apply(YaffsItem* item, const QString& path) const {
+    QString key = mMountPoint + path;
+    while (key.startsWith('/')) {
+        key.remove(0, 1);
+    }
+    while (key.endsWith('/')) {
+        key.chop(1);
+    }
+
+    const Entry* entry = NULL;
+    QHash<QString, Entry>::const_iterator it = mPaths.constFind(key);
+    if (it != mPaths.constEnd()) {
+        entry = &it.value();
+    } else {
+        //longest prefix first, down to a bare * for everything
+        int end = key.length();
+        while (entry == NULL && end >= 0) {
+            it = mPrefixes.constFind(key.left(end));
+            if (it != mPrefixes.constEnd()) {
+                entry = &it.value();
+            }
+            end = (end > 1 ? key.lastIndexOf('/', end - 2) + 1 : end - 1);
+        }
+    }
+
+    if (entry) {
+        item->setUserId(entry->uid);
+        item->setGroupId(entry->gid);
+        item->setPermissions((item->getPermissions() & ~07777) | (entry->mode & 07777));
+    }
+    return (entry != NULL);
+}
@@ -0,0 +1,54 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSFSCONFIG_H
+#define YAFFSFSCONFIG_H
+
+#include <QHash>
+#include <QString>
+
+class YaffsItem;
+
+//ownership and permissions from an android fs_config style list, one "path uid gid mode"
+//entry per line. a path ending in * covers everything below it unless a longer one does
+class YaffsFsConfig {
+public:
+    YaffsFsConfig();
+
+    bool load(const QString& filename, const QString& mountPoint);
+    int getNumEntries() const { return mPaths.size() + mPrefixes.size(); }
+    int getNumErrors() const { return mNumErrors; }
+    bool apply(YaffsItem* item, const QString& path) const;
+
+private:
+    struct Entry {
+        uint uid;
+        uint gid;
+        uint mode;
+    };
+
+    static bool parseId(const QString& text, uint& id);
+
+private:
+    QHash<QString, Entry> mPaths;
+    QHash<QString, Entry> mPrefixes;    //keyed on the path up to the *
+    QString mMountPoint;                //where the image root is in the list, e.g. system
+    int mNumErrors;
+};
+
+#endif  //YAFFSFSCONFIG_H
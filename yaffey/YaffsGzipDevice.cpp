@@ -0,0 +1,122 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "YaffsGzipDevice.h"
+
+YaffsGzipDevice::YaffsGzipDevice(QIODevice* source) {
+    mSource = source;
+    mInitialised = false;
+    mStreamEnd = false;
+    mNumMembers = 0;
+    memset(&mStream, 0, sizeof(z_stream));
+}
+
+YaffsGzipDevice::~YaffsGzipDevice() {
+    close();
+}
+
+bool YaffsGzipDevice::open(OpenMode mode) {
+    if (mode != QIODevice::ReadOnly || mSource == NULL || !mSource->isReadable()) {
+        setErrorString("Only reading is supported");
+        return false;
+    }
+
+    //15 window bits plus 32 accepts a gzip or zlib header
+    memset(&mStream, 0, sizeof(z_stream));
+    if (inflateInit2(&mStream, 15 + 32) != Z_OK) {
+        setErrorString("Couldn't start inflating");
+        return false;
+    }
+    mInitialised = true;
+    mStreamEnd = false;
+    mNumMembers = 0;
+    return QIODevice::open(mode);
+}
+
+void YaffsGzipDevice::close() {
+    if (mInitialised) {
+        inflateEnd(&mStream);
+        mInitialised = false;
+    }
+    QIODevice::close();
+}
+
+bool YaffsGzipDevice::atEnd() const {
+    return (mStreamEnd && QIODevice::atEnd());
+}
+
+bool YaffsGzipDevice::isGzip(const QByteArray& magic) {
+    return (magic.size() >= 2 && static_cast<uchar>(magic.at(0)) == 0x1f && static_cast<uchar>(magic.at(1)) == 0x8b);
+}
+
+//gzip files can be several members one after the other, they're inflated as one stream
+qint64 YaffsGzipDevice::readData(char* data, qint64 maxSize) {
+    mStream.next_out = reinterpret_cast<Bytef*>(data);
+    mStream.avail_out = static_cast<uInt>(qMin<qint64>(maxSize, INT_MAX));
+    uInt outputSize = mStream.avail_out;
+
+    while (!mStreamEnd && mStream.avail_out > 0) {
+        if (mStream.avail_in == 0) {
+            qint64 bytesRead = mSource->read(mInput, INPUT_SIZE);
+            if (bytesRead < 0) {
+                setErrorString("Couldn't read the compressed data");
+                return -1;
+            } else if (bytesRead == 0) {
+                if (mStream.total_in > 0 && !isTrailingJunk()) {
+                    setErrorString("Unexpected end of compressed data");
+                    return -1;
+                }
+                mStreamEnd = true;
+                break;
+            }
+            mStream.next_in = reinterpret_cast<Bytef*>(mInput);
+            mStream.avail_in = static_cast<uInt>(bytesRead);
+        }
+
+        int result = inflate(&mStream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            inflateReset(&mStream);
+            mNumMembers++;
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            if (isTrailingJunk()) {
+                mStreamEnd = true;
+                break;
+            }
+            setErrorString(mStream.msg ? QString::fromLatin1(mStream.msg) : QString("Bad compressed data"));
+            return -1;
+        }
+
+        //whatever has been inflated is handed back rather than waiting on a pipe for more
+        if (mStream.avail_out < outputSize && mStream.avail_in == 0) {
+            break;
+        }
+    }
+    return outputSize - mStream.avail_out;
+}
+
+//like gzip, anything after the last member that doesn't inflate is ignored
+bool YaffsGzipDevice::isTrailingJunk() const {
+    return (mNumMembers > 0 && mStream.total_out == 0);
+}
+
+qint64 YaffsGzipDevice::writeData(const char* /*data*/, qint64 /*maxSize*/) {
+    return -1;
+}
@@ -0,0 +1,58 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSGZIPDEVICE_H
+#define YAFFSGZIPDEVICE_H
+
+#include <QIODevice>
+
+#include <zlib.h>
+
+//inflates a gzip stream read from another device as it's read, nothing is held but the
+//input buffer. it's sequential, going back means opening it again on a rewound source
+class YaffsGzipDevice : public QIODevice {
+public:
+    YaffsGzipDevice(QIODevice* source);
+    ~YaffsGzipDevice();
+
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const { return true; }
+    bool atEnd() const;
+
+    static bool isGzip(const QByteArray& magic);
+
+protected:
+    qint64 readData(char* data, qint64 maxSize);
+    qint64 writeData(const char* data, qint64 maxSize);
+
+private:
+    bool isTrailingJunk() const;
+
+private:
+    static const int INPUT_SIZE = 65536;
+
+    QIODevice* mSource;                 //not owned
+    z_stream mStream;
+    bool mInitialised;
+    bool mStreamEnd;                    //the last member has been inflated
+    int mNumMembers;                    //inflated so far
+    char mInput[INPUT_SIZE];
+};
+
+#endif  //YAFFSGZIPDEVICE_H
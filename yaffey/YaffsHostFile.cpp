@@ -0,0 +1,89 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif  //_WIN32
+
+#include "YaffsHostFile.h"
+
+#ifndef _WIN32
+static void fromStat(YaffsHostFile& hostFile, const struct stat& fileStat) {
+    hostFile.size = fileStat.st_size;
+    hostFile.mtime = static_cast<qint64>(fileStat.st_mtime) * 1000;
+    hostFile.inode = fileStat.st_ino;
+}
+#endif  //_WIN32
+
+//a single stat for everything, QFileInfo doesn't give the inode. false if it isn't a file any more
+bool YaffsHostFile::read(const QString& filename) {
+#ifndef _WIN32
+    struct stat fileStat;
+    if (stat(QFile::encodeName(filename).constData(), &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
+        fromStat(*this, fileStat);
+        return true;
+    }
+#else
+    QFileInfo fileInfo(filename);
+    if (fileInfo.isFile()) {
+        size = fileInfo.size();
+        mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+        inode = 0;
+        return true;
+    }
+#endif  //_WIN32
+
+    size = -1;
+    mtime = 0;
+    inode = 0;
+    return false;
+}
+
+//what a directory entry is from a single lstat, files are read at the same time. links aren't
+//followed to directories, they can loop back on themselves, but links to files are read as files
+YaffsHostFile::EntryType YaffsHostFile::readEntry(const QString& filename) {
+#ifndef _WIN32
+    struct stat fileStat;
+    if (lstat(QFile::encodeName(filename).constData(), &fileStat) == 0) {
+        if (S_ISREG(fileStat.st_mode)) {
+            fromStat(*this, fileStat);
+            return ENTRY_FILE;
+        } else if (S_ISDIR(fileStat.st_mode)) {
+            return ENTRY_DIR;
+        } else if (S_ISLNK(fileStat.st_mode) && read(filename)) {
+            return ENTRY_FILE;
+        }
+    }
+#else
+    QFileInfo fileInfo(filename);
+    if (fileInfo.isDir() && !fileInfo.isSymLink()) {
+        return ENTRY_DIR;
+    } else if (read(filename)) {
+        return ENTRY_FILE;
+    }
+#endif  //_WIN32
+
+    size = -1;
+    mtime = 0;
+    inode = 0;
+    return ENTRY_OTHER;
+}
@@ -0,0 +1,45 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSHOSTFILE_H
+#define YAFFSHOSTFILE_H
+
+#include <QString>
+
+//what was seen of a local file when it was imported, it's looked at again before saving
+//so a file that has changed since is written as it is now
+struct YaffsHostFile {
+    enum EntryType {
+        ENTRY_FILE,
+        ENTRY_DIR,
+        ENTRY_OTHER                     //gone, a special file or a link that isn't to a file
+    };
+
+    qint64 size;                        //-1 if the file has gone
+    qint64 mtime;                       //msecs since the epoch
+    quint64 inode;                      //0 where the file system doesn't have them
+
+    YaffsHostFile() : size(-1), mtime(0), inode(0) {}
+    bool read(const QString& filename);
+    EntryType readEntry(const QString& filename);
+    bool isMissing() const { return (size < 0); }
+    bool operator==(const YaffsHostFile& other) const { return (size == other.size && mtime == other.mtime && inode == other.inode); }
+    bool operator!=(const YaffsHostFile& other) const { return !(*this == other); }
+};
+
+#endif  //YAFFSHOSTFILE_H
@@ -0,0 +1,56 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+
+#include "YaffsImportJob.h"
+#include "YaffsModel.h"
+
+static const int IMPORT_POLL_INTERVAL = 100;
+
+YaffsImportJob::YaffsImportJob(YaffsModel* yaffsModel, YaffsItem* parentItem, const QString& dirNameWithPath, QObject* parent) :
+    QObject(parent),
+    mYaffsModel(yaffsModel),
+    mImportId(-1),
+    mWalker(dirNameWithPath) {
+    mImportId = yaffsModel->beginImport(parentItem, mWalker.getRoot()->name);
+    connect(&mTimer, SIGNAL(timeout()), SLOT(on_timer_timeout()));
+}
+
+void YaffsImportJob::start() {
+    qDebug() << "YaffsImportJob::start()";
+
+    mWalker.start();
+    mTimer.start(IMPORT_POLL_INTERVAL);
+}
+
+//the walker is canceled and waited for by its destructor if the placeholder was deleted or the
+//model closed before the walk finished
+void YaffsImportJob::on_timer_timeout() {
+    if (mYaffsModel.isNull() || !mYaffsModel->isImportPending(mImportId)) {
+        mTimer.stop();
+        mWalker.cancel();
+        deleteLater();
+    } else if (mWalker.waitForFinished(0)) {
+        mTimer.stop();
+        mYaffsModel->finishImport(mImportId, mWalker.getRoot());
+        deleteLater();
+    } else {
+        mYaffsModel->setImportProgress(mImportId, mWalker.getNumEntries());
+    }
+}
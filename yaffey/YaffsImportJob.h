@@ -0,0 +1,52 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSIMPORTJOB_H
+#define YAFFSIMPORTJOB_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+#include "YaffsImportWalker.h"
+
+class YaffsModel;
+class YaffsItem;
+
+//imports a dropped directory without holding up the window. the model shows a placeholder for it
+//straight away while the walk runs on the thread pool, then fills the placeholder in one go once
+//the walk has finished. the job deletes itself when it's done or the model goes away
+class YaffsImportJob : public QObject {
+    Q_OBJECT
+
+public:
+    YaffsImportJob(YaffsModel* yaffsModel, YaffsItem* parentItem, const QString& dirNameWithPath, QObject* parent = 0);
+
+    void start();
+
+private slots:
+    void on_timer_timeout();
+
+private:
+    QPointer<YaffsModel> mYaffsModel;   //not owned
+    int mImportId;                      //the model's id for the import, the placeholder can be deleted
+    YaffsImportWalker mWalker;
+    QTimer mTimer;
+};
+
+#endif  //YAFFSIMPORTJOB_H
@@ -0,0 +1,107 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutexLocker>
+
+#include <limits.h>
+
+#include "YaffsImportWalker.h"
+
+class YaffsImportTask : public QRunnable {
+public:
+    YaffsImportTask(YaffsImportWalker* walker, YaffsImportEntry* dirEntry) : mWalker(walker), mDirEntry(dirEntry) {}
+    void run() { mWalker->walkDirectory(mDirEntry); }
+
+private:
+    YaffsImportWalker* mWalker;
+    YaffsImportEntry* mDirEntry;
+};
+
+YaffsImportWalker::YaffsImportWalker(const QString& dirNameWithPath) {
+    int slashPos = dirNameWithPath.lastIndexOf('/');
+    mRoot = new YaffsImportEntry();
+    mRoot->name = dirNameWithPath.mid(slashPos + 1);
+    mRoot->path = QFileInfo(dirNameWithPath).absoluteFilePath();
+    mRoot->isDir = true;
+}
+
+//a walk that's still going is cancelled, the tasks have to finish before the tree can go
+YaffsImportWalker::~YaffsImportWalker() {
+    cancel();
+    waitForFinished();
+    delete mRoot;
+}
+
+void YaffsImportWalker::start() {
+    startDirectory(mRoot);
+}
+
+//returns false if the walk was still going when the time ran out
+bool YaffsImportWalker::waitForFinished(int msecs) {
+    QMutexLocker locker(&mMutex);
+    while (mPending.loadAcquire() != 0) {
+        if (!mFinished.wait(&mMutex, (msecs < 0 ? ULONG_MAX : static_cast<unsigned long>(msecs)))) {
+            return (mPending.loadAcquire() == 0);
+        }
+    }
+    return true;
+}
+
+void YaffsImportWalker::startDirectory(YaffsImportEntry* dirEntry) {
+    mPending.ref();
+    QThreadPool::globalInstance()->start(new YaffsImportTask(this, dirEntry));
+}
+
+//runs on the pool, only this task adds to the directory's children
+void YaffsImportWalker::walkDirectory(YaffsImportEntry* dirEntry) {
+    QDirIterator dirs(dirEntry->path, QDirIterator::NoIteratorFlags);
+    while (!isCanceled() && dirs.hasNext()) {
+        QString path = dirs.next();
+        QString fileName = dirs.fileName();
+        if (fileName == "." || fileName == "..") {
+            continue;
+        }
+
+        //each entry gets one lstat here, for files it's what they're checked against when the image is saved
+        YaffsHostFile hostFile;
+        YaffsHostFile::EntryType entryType = hostFile.readEntry(path);
+        bool isDir = (entryType == YaffsHostFile::ENTRY_DIR);
+        if (entryType != YaffsHostFile::ENTRY_OTHER) {
+            YaffsImportEntry* entry = new YaffsImportEntry();
+            entry->name = fileName;
+            entry->path = path;
+            entry->hostFile = hostFile;
+            entry->isDir = isDir;
+            dirEntry->children.append(entry);
+            mNumEntries.ref();
+
+            if (isDir) {
+                startDirectory(entry);
+            }
+        }
+    }
+
+    if (!mPending.deref()) {
+        QMutexLocker locker(&mMutex);
+        mFinished.wakeAll();
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSIMPORTWALKER_H
+#define YAFFSIMPORTWALKER_H
+
+#include <QString>
+#include <QList>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "YaffsHostFile.h"
+
+//a file or directory found by the walk, directories own their children
+struct YaffsImportEntry {
+    QString name;
+    QString path;
+    YaffsHostFile hostFile;             //files
+    bool isDir;
+    QList<YaffsImportEntry*> children;
+
+    ~YaffsImportEntry() { qDeleteAll(children); }
+};
+
+//walks a directory tree on the thread pool with one task per directory, so the entries are
+//stat'ed concurrently. the result is a plain tree that the model turns into items on its own
+//thread, the arena the items live in isn't thread safe
+class YaffsImportWalker {
+public:
+    YaffsImportWalker(const QString& dirNameWithPath);
+    ~YaffsImportWalker();
+
+    void start();
+    void cancel() { mCanceled.fetchAndStoreOrdered(1); }
+    bool isCanceled() const { return (mCanceled.loadAcquire() != 0); }
+    bool waitForFinished(int msecs = -1);
+    int getNumEntries() const { return mNumEntries.loadAcquire(); }
+    const YaffsImportEntry* getRoot() const { return mRoot; }
+
+private:
+    friend class YaffsImportTask;
+    void startDirectory(YaffsImportEntry* dirEntry);
+    void walkDirectory(YaffsImportEntry* dirEntry);
+
+private:
+    YaffsImportEntry* mRoot;            //owned
+    QAtomicInt mPending;                //directories queued or being walked
+    QAtomicInt mNumEntries;
+    QAtomicInt mCanceled;
+    QMutex mMutex;
+    QWaitCondition mFinished;
+};
+
+#endif  //YAFFSIMPORTWALKER_H
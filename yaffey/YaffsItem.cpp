@@ -22,143 +22,364 @@
 #include <QDateTime>
 #include <QMap>
 
+#include <new>
+#include <string.h>
+
 #include "YaffsItem.h"
 #include "AndroidIDs.h"
-
-YaffsItem::YaffsItem(YaffsItem* parent, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId) {
-    mParentItem = parent;
-    if (yaffsObjectHeader != NULL) {
-        memcpy(&mYaffsObjectHeader, yaffsObjectHeader, sizeof(yaffs_obj_hdr));
+#include "Utils.h"
+
+static const int MIN_CHILD_CAPACITY = 4;
+static const int NAME_INDEX_THRESHOLD = 32;
+
+YaffsItem::YaffsItem(YaffsArena* arena, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId) {
+    mArena = arena;
+    mParentItem = NULL;
+    mRow = -1;
+    mName = arena->intern(yaffsObjectHeader->name, strnlen(yaffsObjectHeader->name, YAFFS_MAX_NAME_LENGTH + 1));
+    mChildren = NULL;
+    if (yaffsObjectHeader->type == YAFFS_OBJECT_TYPE_SYMLINK) {
+        mAlias = arena->intern(yaffsObjectHeader->alias, strnlen(yaffsObjectHeader->alias, YAFFS_MAX_ALIAS_LENGTH + 1));
     }
     mHeaderPosition = headerPosition;
     mYaffsObjectId = yaffsObjectId;
+    mParentObjectId = yaffsObjectHeader->parent_obj_id;
+    mDisplayVersion = 0;
+    mMode = yaffsObjectHeader->yst_mode;
+    mUid = yaffsObjectHeader->yst_uid;
+    mGid = yaffsObjectHeader->yst_gid;
+    mAtime = yaffsObjectHeader->yst_atime;
+    mMtime = yaffsObjectHeader->yst_mtime;
+    mCtime = yaffsObjectHeader->yst_ctime;
+    mFileSize = yaffsObjectHeader->file_size_low;
+    mType = yaffsObjectHeader->type;
     mCondition = CLEAN;
     mMarkedForDelete = false;
     mHasChildMarkedForDelete = false;
+    mSource = SOURCE_FILE;
 }
 
-YaffsItem::YaffsItem(YaffsItem* parent, const QString& name, yaffs_obj_type type) {
+YaffsItem::YaffsItem(YaffsArena* arena, YaffsItem* parent, const QString& name, yaffs_obj_type type) {
+    mArena = arena;
     mParentItem = parent;
-
-    memset(&mYaffsObjectHeader, 0xff, sizeof(yaffs_obj_hdr));
+    mRow = -1;
+    mName = arena->intern("");
+    mChildren = NULL;
+    mDisplayVersion = 0;
+    mType = type;
+    mCondition = NEW;
     setName(name);
-    mYaffsObjectHeader.type = type;
-    mYaffsObjectHeader.yst_ctime = QDateTime::currentDateTime().toTime_t();
-    mYaffsObjectHeader.yst_atime = mYaffsObjectHeader.yst_ctime;
-    mYaffsObjectHeader.yst_mtime = mYaffsObjectHeader.yst_ctime;
+
+    //fields that aren't set here are left as they would be in an erased header
+    mParentObjectId = -1;
+    mMode = 0xffffffff;
+    mUid = 0xffffffff;
+    mGid = 0xffffffff;
+    mCtime = QDateTime::currentDateTime().toTime_t();
+    mAtime = mCtime;
+    mMtime = mCtime;
+    mFileSize = 0xffffffff;
 
     mHeaderPosition = -1;
     mYaffsObjectId = -1;
 
-    mCondition = NEW;
     mMarkedForDelete = false;
     mHasChildMarkedForDelete = false;
+    mSource = SOURCE_FILE;
 }
 
-YaffsItem::~YaffsItem() {
-    qDeleteAll(mChildItems);
+void* YaffsItem::allocate(YaffsArena* arena) {
+    return arena->allocate(sizeof(YaffsItem));
 }
 
-YaffsItem* YaffsItem::createRoot() {
-    YaffsItem* item = new YaffsItem(NULL, "", YAFFS_OBJECT_TYPE_DIRECTORY);
+YaffsItem* YaffsItem::create(YaffsArena* arena, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId) {
+    return new (allocate(arena)) YaffsItem(arena, yaffsObjectHeader, headerPosition, yaffsObjectId);
+}
+
+YaffsItem* YaffsItem::createRoot(YaffsArena* arena) {
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, NULL, "", YAFFS_OBJECT_TYPE_DIRECTORY);
 
     item->mYaffsObjectId = YAFFS_OBJECTID_ROOT;
-    item->mYaffsObjectHeader.parent_obj_id = item->mYaffsObjectId;
-    item->mYaffsObjectHeader.yst_mode = 0771 | 0x4000;
-    item->mYaffsObjectHeader.yst_uid = 0;
-    item->mYaffsObjectHeader.yst_gid = 0;
+    item->mParentObjectId = item->mYaffsObjectId;
+    item->mMode = 0771 | 0x4000;
+    item->mUid = 0;
+    item->mGid = 0;
     item->setName("/");
 
     return item;
 }
 
-YaffsItem* YaffsItem::createFile(YaffsItem* parentItem, const QString& filenameWithPath, int filesize) {
+YaffsItem* YaffsItem::createFile(YaffsItem* parentItem, const QString& filenameWithPath, const YaffsHostFile& hostFile) {
     int slashPos = filenameWithPath.lastIndexOf('/');
     QString filename = filenameWithPath.mid(slashPos + 1);
 
-    YaffsItem* item = new YaffsItem(parentItem, filename, YAFFS_OBJECT_TYPE_FILE);
-    const yaffs_obj_hdr& parentHeader = parentItem->getHeader();
-    item->mExternalFilename = filenameWithPath;
-    item->mYaffsObjectHeader.parent_obj_id = parentItem->mYaffsObjectId;
-    item->mYaffsObjectHeader.yst_mode = parentHeader.yst_mode;
-    item->mYaffsObjectHeader.yst_uid = parentHeader.yst_uid;
-    item->mYaffsObjectHeader.yst_gid = parentHeader.yst_gid;
-    item->mYaffsObjectHeader.file_size_low = filesize;
+    YaffsArena* arena = parentItem->mArena;
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, parentItem, filename, YAFFS_OBJECT_TYPE_FILE);
+    item->setSourceData(SOURCE_FILE, filenameWithPath.toUtf8().constData(), 0);
+    item->mSourceData->mtime = hostFile.mtime;
+    item->mSourceData->inode = hostFile.inode;
+    item->mParentObjectId = parentItem->mYaffsObjectId;
+    item->mMode = parentItem->mMode;
+    item->mUid = parentItem->mUid;
+    item->mGid = parentItem->mGid;
+    item->mFileSize = static_cast<u32>(hostFile.size);
+
+    return item;
+}
+
+//the data is read straight out of the archive when saving, see YaffsArchive
+YaffsItem* YaffsItem::createArchiveFile(YaffsItem* parentItem, const QString& filename, const QString& archiveFilename, qint64 archiveOffset, int filesize) {
+    YaffsArena* arena = parentItem->mArena;
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, parentItem, filename, YAFFS_OBJECT_TYPE_FILE);
+    item->setSourceData(SOURCE_ARCHIVE, archiveFilename.toUtf8().constData(), archiveOffset);
+    item->mParentObjectId = parentItem->mYaffsObjectId;
+    item->mMode = parentItem->mMode;
+    item->mUid = parentItem->mUid;
+    item->mGid = parentItem->mGid;
+    item->mFileSize = filesize;
+
+    return item;
+}
+
+//a new item with everything the source item has, a file copied from an image that has been saved
+//keeps pointing at its data in there and one that hasn't yet shares the source item's data
+YaffsItem* YaffsItem::createCopy(YaffsItem* parentItem, const YaffsItem* sourceItem, const QString& sourceImageFilename) {
+    YaffsArena* arena = parentItem->mArena;
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, parentItem, sourceItem->getName(), static_cast<yaffs_obj_type>(sourceItem->mType));
+    if (sourceItem->isSymLink()) {
+        item->setAlias(sourceItem->getAlias());
+    } else if (sourceItem->isFile()) {
+        if (sourceItem->getCondition() != NEW) {
+            item->setSourceData(SOURCE_IMAGE, sourceImageFilename.toUtf8().constData(), sourceItem->mHeaderPosition);
+        } else if (sourceItem->mSourceData) {
+            const SourceData* sourceData = sourceItem->mSourceData;
+            item->setSourceData(sourceItem->getSource(), sourceData->filename, sourceData->offset);
+            item->mSourceData->mtime = sourceData->mtime;
+            item->mSourceData->inode = sourceData->inode;
+        }
+        item->mFileSize = sourceItem->mFileSize;
+    }
+    item->mParentObjectId = parentItem->mYaffsObjectId;
+    item->mMode = sourceItem->mMode;
+    item->mUid = sourceItem->mUid;
+    item->mGid = sourceItem->mGid;
+    item->mAtime = sourceItem->mAtime;
+    item->mMtime = sourceItem->mMtime;
+    item->mCtime = sourceItem->mCtime;
 
     return item;
 }
 
 YaffsItem* YaffsItem::createDirectory(YaffsItem* parentItem, const QString& dirName) {
-    YaffsItem* item = new YaffsItem(parentItem, dirName, YAFFS_OBJECT_TYPE_DIRECTORY);
+    YaffsArena* arena = parentItem->mArena;
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, parentItem, dirName, YAFFS_OBJECT_TYPE_DIRECTORY);
 
-    const yaffs_obj_hdr& parentHeader = parentItem->getHeader();
-    item->mYaffsObjectHeader.parent_obj_id = parentItem->mYaffsObjectId;
-    item->mYaffsObjectHeader.yst_mode = parentHeader.yst_mode;
-    item->mYaffsObjectHeader.yst_uid = parentHeader.yst_uid;
-    item->mYaffsObjectHeader.yst_gid = parentHeader.yst_gid;
+    item->mParentObjectId = parentItem->mYaffsObjectId;
+    item->mMode = parentItem->mMode;
+    item->mUid = parentItem->mUid;
+    item->mGid = parentItem->mGid;
 
     return item;
 }
 
 YaffsItem* YaffsItem::createSymLink(YaffsItem* parentItem, const QString& filename, const QString& alias, uint uid, uint gid, uint permissions) {
-    YaffsItem* item = new YaffsItem(parentItem, filename, YAFFS_OBJECT_TYPE_SYMLINK);
+    YaffsArena* arena = parentItem->mArena;
+    YaffsItem* item = new (allocate(arena)) YaffsItem(arena, parentItem, filename, YAFFS_OBJECT_TYPE_SYMLINK);
     item->setAlias(alias);
-    item->mYaffsObjectHeader.parent_obj_id = parentItem->mYaffsObjectId;
-    item->mYaffsObjectHeader.yst_mode = permissions;
-    item->mYaffsObjectHeader.yst_uid = uid;
-    item->mYaffsObjectHeader.yst_gid = gid;
+    item->mParentObjectId = parentItem->mYaffsObjectId;
+    item->mMode = permissions;
+    item->mUid = uid;
+    item->mGid = gid;
 
     return item;
 }
 
-void YaffsItem::removeChild(int row) {
-    YaffsItem* item = mChildItems.at(row);
-    delete item;
-    mChildItems.removeAt(row);
+//rebuild the full object header for writing out
+yaffs_obj_hdr YaffsItem::getHeader() const {
+    yaffs_obj_hdr header;
+    memset(&header, 0xff, sizeof(yaffs_obj_hdr));
+
+    //only directories, files and symlinks are written. the fields yaffs reads for them are
+    //zeroed the way the kernel writes them, an erased is_shrink would read as true and mark
+    //the block as holding shrink headers. the windows times and the reserved word stay erased
+    header.yst_rdev = 0;
+    header.file_size_high = 0;
+    header.inband_shadowed_obj_id = 0;
+    header.inband_is_shrink = 0;
+    header.shadows_obj = 0;
+    header.is_shrink = 0;
+
+    header.type = static_cast<yaffs_obj_type>(mType);
+    header.parent_obj_id = mParentObjectId;
+    memset(header.name, 0, sizeof(header.name));
+    strncpy(header.name, mName, YAFFS_MAX_NAME_LENGTH);
+    header.yst_mode = mMode;
+    header.yst_uid = mUid;
+    header.yst_gid = mGid;
+    header.yst_atime = mAtime;
+    header.yst_mtime = mMtime;
+    header.yst_ctime = mCtime;
+    header.file_size_low = mFileSize;
+    if (isSymLink()) {
+        memset(header.alias, 0, sizeof(header.alias));
+        if (mAlias) {
+            strncpy(header.alias, mAlias, YAFFS_MAX_ALIAS_LENGTH);
+        }
+    }
+    return header;
+}
+
+//mChildren shares its space with the alias and source data, so only a directory can have children
+bool YaffsItem::appendChild(YaffsItem* child) {
+    if (!isDir()) {
+        qDebug() << "appendChild(), not a directory: " << getName();
+        return false;
+    }
+
+    if (mChildren == NULL) {
+        mChildren = static_cast<Children*>(mArena->allocate(sizeof(Children)));
+        mChildren->items = NULL;
+        mChildren->count = 0;
+        mChildren->capacity = 0;
+        mChildren->fetched = 0;
+        mChildren->nameIndex = NULL;
+        mChildren->nameIndexSize = 0;
+        mChildren->totalSize = 0;
+        mChildren->totalCount = 0;
+    }
+
+    //small old arrays go back to the arena, bigger ones stay there until the model is closed
+    if (mChildren->count == mChildren->capacity) {
+        int capacity = (mChildren->capacity > 0 ? mChildren->capacity * 2 : MIN_CHILD_CAPACITY);
+        YaffsItem** items = static_cast<YaffsItem**>(mArena->allocate(capacity * sizeof(YaffsItem*)));
+        if (mChildren->count > 0) {
+            memcpy(items, mChildren->items, mChildren->count * sizeof(YaffsItem*));
+        }
+        mArena->release(mChildren->items, mChildren->capacity * sizeof(YaffsItem*));
+        mChildren->items = items;
+        mChildren->capacity = capacity;
+    }
+
+    child->mRow = mChildren->count;
+    mChildren->items[mChildren->count++] = child;
+    child->mParentItem = this;
+    if (mChildren->nameIndex) {
+        addToNameIndex(child);
+    }
+    return true;
+}
+
+//removes a run of children with a single move of the ones after it
+void YaffsItem::removeChildren(int row, int count) {
+    if (row >= 0 && count > 0 && row + count <= childCount()) {
+        YaffsItem** items = mChildren->items;
+        for (int i = row; i < row + count; ++i) {
+            if (mChildren->nameIndex) {
+                removeFromNameIndex(items[i]);
+            }
+            items[i]->mRow = -1;
+        }
+        if (row < mChildren->fetched) {
+            mChildren->fetched -= qMin(count, mChildren->fetched - row);
+        }
+        memmove(items + row, items + row + count, (mChildren->count - row - count) * sizeof(YaffsItem*));
+        mChildren->count -= count;
+        for (int i = row; i < mChildren->count; ++i) {
+            items[i]->mRow = i;
+        }
+    }
+}
+
+//one post-order pass to fill in the totals of every directory below this one, used once a
+//whole tree has been read. after that addToTotals() keeps them up to date
+void YaffsItem::computeTotals() {
+    if (isDir() && mChildren) {
+        quint64 totalSize = 0;
+        int totalCount = 0;
+        for (int i = 0; i < mChildren->count; ++i) {
+            YaffsItem* child = mChildren->items[i];
+            child->computeTotals();
+            totalSize += child->getTotalSize();
+            totalCount += 1 + child->getTotalCount();
+        }
+        mChildren->totalSize = totalSize;
+        mChildren->totalCount = totalCount;
+    }
+}
+
+//adds to the totals of this directory and every one above it, for when a subtree is added or removed
+void YaffsItem::addToTotals(qint64 size, int count) {
+    for (YaffsItem* item = this; item != NULL; item = item->mParentItem) {
+        if (item->isDir() && item->mChildren) {
+            item->mChildren->totalSize += size;
+            item->mChildren->totalCount += count;
+            item->mDisplayVersion++;
+        }
+    }
+}
+
+//puts the children in the given order, items must be the same children as before
+void YaffsItem::reorderChildren(YaffsItem* const* items) {
+    int count = childCount();
+    for (int i = 0; i < count; ++i) {
+        mChildren->items[i] = items[i];
+        items[i]->mRow = i;
+    }
+}
+
+//gives a removed item and everything below it back to the arena, names are
+//shared between items so they stay where they are
+void YaffsItem::release(YaffsItem* item) {
+    YaffsArena* arena = item->mArena;
+    if (item->isDir() && item->mChildren) {
+        Children* children = item->mChildren;
+        for (int i = 0; i < children->count; ++i) {
+            release(children->items[i]);
+        }
+        arena->release(children->items, children->capacity * sizeof(YaffsItem*));
+        arena->release(children->nameIndex, children->nameIndexSize * sizeof(YaffsItem*));
+        arena->release(children, sizeof(Children));
+    } else if (item->isFile() && item->mSourceData) {
+        arena->release(item->mSourceData, sizeof(SourceData));
+    }
+    item->~YaffsItem();
+    arena->release(item, sizeof(YaffsItem));
 }
 
 QVariant YaffsItem::data(int column) const {
     if (column == NAME) {
-        return mYaffsObjectHeader.name;
+        return getName();
     } else if (column == SIZE) {
-        int fileSize = mYaffsObjectHeader.file_size_low;
-        if (fileSize != -1) {
-            if (fileSize >= 1048576) {
-                return QString::number(fileSize / 1048576.0f, 'f', 2) + " MB";
-            } else if (fileSize >= 1024) {
-                return QString::number(fileSize / 1024.0f, 'f', 2) + " KB";
-            } else {
-                return QString::number(fileSize) + " b";
-            }
+        if (isDir()) {
+            return Utils::formatSize(getTotalSize());
+        } else if (mFileSize != 0xffffffff) {
+            return Utils::formatSize(mFileSize);
         }
     } else if (column == PERMISSIONS) {
-        return parseMode(mYaffsObjectHeader.yst_mode);
+        return parseMode(mMode);
     } else if (column == ALIAS) {
         if (isSymLink()) {
-            return mYaffsObjectHeader.alias;
+            return getAlias();
         }
     } else if (column == DATE_ACCESSED) {
-        QDateTime atime = QDateTime::fromTime_t(mYaffsObjectHeader.yst_atime);
-        return atime.toString("dd/MM/yyyy hh:mm:ss");
+        return Utils::formatDateTime(mAtime);
     } else if (column == DATE_CREATED) {
-        QDateTime ctime = QDateTime::fromTime_t(mYaffsObjectHeader.yst_ctime);
-        return ctime.toString("dd/MM/yyyy hh:mm:ss");
+        return Utils::formatDateTime(mCtime);
     } else if (column == DATE_MODIFIED) {
-        QDateTime mtime = QDateTime::fromTime_t(mYaffsObjectHeader.yst_mtime);
-        return mtime.toString("dd/MM/yyyy hh:mm:ss");
+        return Utils::formatDateTime(mMtime);
     } else if (column == USER) {
-        QString uid = ANDROID_IDS.value(mYaffsObjectHeader.yst_uid);
+        QString uid = ANDROID_IDS.value(mUid);
         if (uid.length() > 0) {
             return uid;
         } else {
-            return mYaffsObjectHeader.yst_uid;
+            return mUid;
         }
     } else if (column == GROUP) {
-        QString gid = ANDROID_IDS.value(mYaffsObjectHeader.yst_gid);
+        QString gid = ANDROID_IDS.value(mGid);
         if (gid.length() > 0) {
             return gid;
         } else {
-            return mYaffsObjectHeader.yst_gid;
+            return mGid;
         }
     }
 #ifdef QT_DEBUG
@@ -177,14 +398,6 @@ QVariant YaffsItem::data(int column) const {
     return QVariant();
 }
 
-int YaffsItem::row() const {
-    int row = 0;
-    if (mParentItem) {
-        row = mParentItem->mChildItems.indexOf(const_cast<YaffsItem*>(this));
-    }
-    return row;
-}
-
 QString YaffsItem::getFullPath() const {
     QString fullPath;
     if (isRoot()) {
@@ -204,26 +417,31 @@ QString YaffsItem::getFullPath() const {
 }
 
 void YaffsItem::setName(const QString& name) {
+    //the parent's name index is keyed on the name so take the item out while it changes
+    bool indexed = (mParentItem && mParentItem->removeFromNameIndex(this));
+
     if (name.length() > 0) {
-        QString newName = name;
+        QByteArray newName = name.toUtf8();
         if (newName.length() > YAFFS_MAX_NAME_LENGTH) {
             newName.truncate(YAFFS_MAX_NAME_LENGTH);
         }
-        size_t len = static_cast<size_t>(newName.length());
-        QString currentName(mYaffsObjectHeader.name);
-        if (newName != currentName) {
-            memset(mYaffsObjectHeader.name, 0, YAFFS_MAX_NAME_LENGTH);
-            memcpy(mYaffsObjectHeader.name, newName.toStdString().c_str(), len);
+        if (strcmp(newName.constData(), mName) != 0) {
+            mName = mArena->intern(newName.constData(), newName.length());
             makeDirty();
         }
     } else {
-        memset(mYaffsObjectHeader.name, 0, YAFFS_MAX_NAME_LENGTH);
+        mName = mArena->intern("");
+        mDisplayVersion++;
+    }
+
+    if (indexed) {
+        mParentItem->addToNameIndex(this);
     }
 }
 
 void YaffsItem::setPermissions(uint permissions) {
-    if (permissions != mYaffsObjectHeader.yst_mode) {
-        mYaffsObjectHeader.yst_mode = permissions;
+    if (permissions != mMode) {
+        mMode = permissions;
         makeDirty();
     }
 }
@@ -231,14 +449,12 @@ void YaffsItem::setPermissions(uint permissions) {
 void YaffsItem::setAlias(const QString& alias) {
     if (isSymLink()) {
         if (alias.length() > 0) {
-            QString newAlias = alias;
+            QByteArray newAlias = alias.toUtf8();
             if (newAlias.length() > YAFFS_MAX_ALIAS_LENGTH) {
                 newAlias.truncate(YAFFS_MAX_ALIAS_LENGTH);
             }
-            QString currentAlias(mYaffsObjectHeader.alias);
-            if (newAlias != currentAlias) {
-                memset(mYaffsObjectHeader.alias, 0, YAFFS_MAX_ALIAS_LENGTH);
-                strcpy(mYaffsObjectHeader.alias, newAlias.toStdString().c_str());
+            if (mAlias == NULL || strcmp(newAlias.constData(), mAlias) != 0) {
+                mAlias = mArena->intern(newAlias.constData(), newAlias.length());
                 makeDirty();
             }
         }
@@ -246,19 +462,62 @@ void YaffsItem::setAlias(const QString& alias) {
 }
 
 void YaffsItem::setUserId(uint uid) {
-    if (uid != mYaffsObjectHeader.yst_uid) {
-        mYaffsObjectHeader.yst_uid = uid;
+    if (uid != mUid) {
+        mUid = uid;
         makeDirty();
     }
 }
 
 void YaffsItem::setGroupId(uint gid) {
-    if (gid != mYaffsObjectHeader.yst_gid) {
-        mYaffsObjectHeader.yst_gid = gid;
+    if (gid != mGid) {
+        mGid = gid;
         makeDirty();
     }
 }
 
+void YaffsItem::setModificationTime(uint mtime) {
+    if (mtime != mMtime) {
+        mMtime = mtime;
+        makeDirty();
+    }
+}
+
+//for files from an archive or another image this is the archive or image itself
+QString YaffsItem::getExternalFilename() const {
+    return (isFile() && mSourceData ? QString::fromUtf8(mSourceData->filename) : QString());
+}
+
+YaffsHostFile YaffsItem::getHostFile() const {
+    YaffsHostFile hostFile;
+    if (isFile() && getSource() == SOURCE_FILE && mSourceData) {
+        hostFile.size = mFileSize;
+        hostFile.mtime = mSourceData->mtime;
+        hostFile.inode = mSourceData->inode;
+    }
+    return hostFile;
+}
+
+//for a local file that has changed since it was imported, the model keeps the totals in step
+void YaffsItem::setHostFile(const YaffsHostFile& hostFile) {
+    if (isFile() && getSource() == SOURCE_FILE && mSourceData && !hostFile.isMissing()) {
+        mSourceData->mtime = hostFile.mtime;
+        mSourceData->inode = hostFile.inode;
+        if (mFileSize != hostFile.size) {
+            mFileSize = static_cast<u32>(hostFile.size);
+            mDisplayVersion++;
+        }
+    }
+}
+
+void YaffsItem::setSourceData(Source source, const char* filename, qint64 offset) {
+    mSourceData = static_cast<SourceData*>(mArena->allocate(sizeof(SourceData)));
+    mSourceData->filename = mArena->intern(filename);
+    mSourceData->offset = offset;
+    mSourceData->mtime = 0;
+    mSourceData->inode = 0;
+    mSource = source;
+}
+
 void YaffsItem::markForDelete() {
     //mark this item to be deleted
     mMarkedForDelete = true;
@@ -274,16 +533,99 @@ void YaffsItem::markForDelete() {
 }
 
 YaffsItem* YaffsItem::findItemWithName(const QString& itemName) {
-    for (int i = 0; i < mChildItems.count(); ++i) {
-        YaffsItem* childItem = mChildItems.at(i);
-        if (itemName.compare(childItem->getName()) == 0) {
+    int count = childCount();
+    QByteArray name = itemName.toUtf8();
+
+    if (count < NAME_INDEX_THRESHOLD) {
+        for (int i = 0; i < count; ++i) {
+            YaffsItem* childItem = mChildren->items[i];
+            if (strcmp(name.constData(), childItem->mName) == 0) {
+                return childItem;
+            }
+        }
+        return NULL;
+    }
+
+    if (mChildren->nameIndex == NULL) {
+        buildNameIndex(count * 4);
+    }
+
+    int mask = mChildren->nameIndexSize - 1;
+    int slot = YaffsArena::hash(name.constData(), name.size()) & mask;
+    YaffsItem* childItem;
+    while ((childItem = mChildren->nameIndex[slot]) != NULL) {
+        if (strcmp(name.constData(), childItem->mName) == 0) {
             return childItem;
         }
+        slot = (slot + 1) & mask;
     }
     return NULL;
 }
 
+//size is rounded up to a power of two, the old index stays in the arena
+void YaffsItem::buildNameIndex(int size) {
+    int indexSize = 64;
+    while (indexSize < size) {
+        indexSize *= 2;
+    }
+
+    mChildren->nameIndex = static_cast<YaffsItem**>(mArena->allocate(indexSize * sizeof(YaffsItem*)));
+    mChildren->nameIndexSize = indexSize;
+    memset(mChildren->nameIndex, 0, indexSize * sizeof(YaffsItem*));
+    for (int i = 0; i < mChildren->count; ++i) {
+        addToNameIndex(mChildren->items[i]);
+    }
+}
+
+void YaffsItem::addToNameIndex(YaffsItem* child) {
+    //keep the index at most half full
+    if (mChildren->count * 2 > mChildren->nameIndexSize) {
+        buildNameIndex(mChildren->nameIndexSize * 2);
+        return;
+    }
+
+    int mask = mChildren->nameIndexSize - 1;
+    int slot = YaffsArena::hash(child->mName, strlen(child->mName)) & mask;
+    while (mChildren->nameIndex[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    mChildren->nameIndex[slot] = child;
+}
+
+bool YaffsItem::removeFromNameIndex(YaffsItem* child) {
+    if (mChildren == NULL || mChildren->nameIndex == NULL) {
+        return false;
+    }
+
+    YaffsItem** index = mChildren->nameIndex;
+    int mask = mChildren->nameIndexSize - 1;
+    int slot = YaffsArena::hash(child->mName, strlen(child->mName)) & mask;
+    while (index[slot] != child) {
+        if (index[slot] == NULL) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    //shift back any following entries that probed past the emptied slot
+    index[slot] = NULL;
+    int next = (slot + 1) & mask;
+    while (index[next] != NULL) {
+        YaffsItem* entry = index[next];
+        int home = YaffsArena::hash(entry->mName, strlen(entry->mName)) & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            index[slot] = entry;
+            index[next] = NULL;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+    return true;
+}
+
+//every setter comes through here when a value changes, so it's also where cached display text goes stale
 void YaffsItem::makeDirty() {
+    mDisplayVersion++;
     if (mCondition == CLEAN) {
         mCondition = DIRTY;
     }
@@ -292,7 +634,7 @@ void YaffsItem::makeDirty() {
 QString YaffsItem::parseMode(int mode) const {
     char dest[11];
 
-    switch (mYaffsObjectHeader.type) {
+    switch (mType) {
     case YAFFS_OBJECT_TYPE_FILE:
     case YAFFS_OBJECT_TYPE_HARDLINK:
         dest[0] = '-';
@@ -19,11 +19,12 @@
 #ifndef YAFFSITEM_H
 #define YAFFSITEM_H
 
-#include <QList>
 #include <QVariant>
 #include <QModelIndex>
 
 #include "Yaffs2.h"
+#include "YaffsArena.h"
+#include "YaffsHostFile.h"
 
 //linux permissions
 #define SPECIAL_SETUID  0x800
@@ -39,11 +40,10 @@
 #define ALL_WRITE       0x2
 #define ALL_EXECUTE     0x1
 
+//items live in the model's arena and are only given back to it with release(), the
+//header fields the model doesn't show are rebuilt with defaults by getHeader()
 class YaffsItem {
 public:
-    YaffsItem(YaffsItem* parent, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId);
-    ~YaffsItem();
-
     enum Condition {
         CLEAN,
         DIRTY,
@@ -52,6 +52,13 @@ public:
         ERR
     };
 
+    //where the data of a new file comes from when it's saved
+    enum Source {
+        SOURCE_FILE,                        //a file on the local file system
+        SOURCE_ARCHIVE,                     //at an offset in a tar or cpio archive
+        SOURCE_IMAGE                        //the object with its header at an offset in another image
+    };
+
     enum Column {
         NAME,
         SIZE,
@@ -70,29 +77,38 @@ public:
         COLUMN_COUNT
     };
 
-    static YaffsItem* createRoot();
-    static YaffsItem* createFile(YaffsItem* parentItem, const QString& filenameWithPath, int filesize);
+    static YaffsItem* create(YaffsArena* arena, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId);
+    static YaffsItem* createRoot(YaffsArena* arena);
+    static YaffsItem* createFile(YaffsItem* parentItem, const QString& filenameWithPath, const YaffsHostFile& hostFile);
+    static YaffsItem* createArchiveFile(YaffsItem* parentItem, const QString& filename, const QString& archiveFilename, qint64 archiveOffset, int filesize);
+    static YaffsItem* createCopy(YaffsItem* parentItem, const YaffsItem* sourceItem, const QString& sourceImageFilename);
     static YaffsItem* createDirectory(YaffsItem* parentItem, const QString& externalDirNameWithPath);
     static YaffsItem* createSymLink(YaffsItem* parentItem, const QString& filename, const QString& alias, uint uid = 0, uint gid = 0, uint permissions = 0777);
+    static void release(YaffsItem* item);
 
     QVariant data(int column) const;
-    int row() const;
-    void appendChild(YaffsItem* child) { mChildItems.append(child); }
-    void removeChild(int row);
-    void clear() { mChildItems.clear(); }
-    int childCount() const { return mChildItems.count(); }
+    int row() const { return (mParentItem ? mRow : 0); }
+    bool appendChild(YaffsItem* child);
+    void removeChildren(int row, int count);
+    void reorderChildren(YaffsItem* const* items);
+    void clear() { if (isDir() && mChildren) mChildren->count = mChildren->fetched = 0; }
+    int childCount() const { return (isDir() && mChildren ? mChildren->count : 0); }
+    int fetchedCount() const { return (isDir() && mChildren ? mChildren->fetched : 0); }
+    void setFetchedCount(int count) { if (isDir() && mChildren) mChildren->fetched = count; }
     YaffsItem* parent() { return mParentItem; }
     const YaffsItem* parent() const { return mParentItem; }
-    YaffsItem* child(int row) { return mChildItems.value(row); }
-    const YaffsItem* child(int row) const { return mChildItems.value(row); }
+    YaffsItem* child(int row) { return (row >= 0 && row < childCount() ? mChildren->items[row] : NULL); }
+    const YaffsItem* child(int row) const { return (row >= 0 && row < childCount() ? mChildren->items[row] : NULL); }
     void markForDelete();
     bool hasChildMarkedForDelete() { return mHasChildMarkedForDelete; }
     YaffsItem* findItemWithName(const QString& itemName);
+    void computeTotals();
+    void addToTotals(qint64 size, int count);
 
     bool isRoot() const { return (mParentItem == NULL); }
-    bool isDir() const { return mYaffsObjectHeader.type == YAFFS_OBJECT_TYPE_DIRECTORY; }
-    bool isFile() const { return mYaffsObjectHeader.type == YAFFS_OBJECT_TYPE_FILE; }
-    bool isSymLink() const { return mYaffsObjectHeader.type == YAFFS_OBJECT_TYPE_SYMLINK; }
+    bool isDir() const { return mType == YAFFS_OBJECT_TYPE_DIRECTORY; }
+    bool isFile() const { return mType == YAFFS_OBJECT_TYPE_FILE; }
+    bool isSymLink() const { return mType == YAFFS_OBJECT_TYPE_SYMLINK; }
     bool isMarkedForDelete() { return mMarkedForDelete; }
 
     void setName(const QString& name);
@@ -102,38 +118,94 @@ public:
     void setGroupId(uint gid);
     void setCondition(Condition condition) { mCondition = condition; }
     void setObjectId(int objectId) { mYaffsObjectId = objectId; }
-    void setParentObjectId(int parentObjectId) { mYaffsObjectHeader.parent_obj_id = parentObjectId; }
+    void setParentObjectId(int parentObjectId) { mParentObjectId = parentObjectId; }
     void setHeaderPosition(int headerPos) { mHeaderPosition = headerPos; }
     void setHasChildMarkedForDelete(bool mark) { mHasChildMarkedForDelete = mark; }
+    void setModificationTime(uint mtime);
 
     QString getFullPath() const;
-    QString getName() const { return mYaffsObjectHeader.name; }
-    QString getExternalFilename() const { return mExternalFilename; }
-    QString getAlias() const { return mYaffsObjectHeader.alias; }
+    QString getName() const { return QString::fromUtf8(mName); }
+    const char* getNameUtf8() const { return mName; }
+    QString getExternalFilename() const;
+    Source getSource() const { return (isFile() ? static_cast<Source>(mSource) : SOURCE_FILE); }
+    qint64 getSourceOffset() const { return (getSource() != SOURCE_FILE ? mSourceData->offset : -1); }
+    YaffsHostFile getHostFile() const;
+    void setHostFile(const YaffsHostFile& hostFile);
+    QString getAlias() const { return (isSymLink() && mAlias ? QString::fromUtf8(mAlias) : QString()); }
+    const char* getAliasUtf8() const { return (isSymLink() && mAlias ? mAlias : ""); }
     int getHeaderPosition() const { return mHeaderPosition; }
-    const yaffs_obj_hdr& getHeader() const { return mYaffsObjectHeader; }
-    size_t getFileSize() const { return mYaffsObjectHeader.file_size_low; }
-    uint getUserId() const { return mYaffsObjectHeader.yst_uid; }
-    uint getGroupId() const { return mYaffsObjectHeader.yst_gid; }
-    uint getPermissions() const { return mYaffsObjectHeader.yst_mode; }
+    yaffs_obj_hdr getHeader() const;
+    size_t getFileSize() const { return mFileSize; }
+    quint64 getTotalSize() const { return (isDir() ? (mChildren ? mChildren->totalSize : 0) : (isFile() ? mFileSize : 0)); }
+    int getTotalCount() const { return (isDir() && mChildren ? mChildren->totalCount : 0); }
+    uint getUserId() const { return mUid; }
+    uint getGroupId() const { return mGid; }
+    uint getPermissions() const { return mMode; }
+    uint getAccessTime() const { return mAtime; }
+    uint getCreationTime() const { return mCtime; }
+    uint getModificationTime() const { return mMtime; }
     int getObjectId() const { return mYaffsObjectId; }
-    Condition getCondition() const { return mCondition; }
+    int getParentObjectId() const { return mParentObjectId; }
+    Condition getCondition() const { return static_cast<Condition>(mCondition); }
+    uint getDisplayVersion() const { return mDisplayVersion; }
 
 private:
-    YaffsItem(YaffsItem* parent, const QString& name, yaffs_obj_type type);
+    struct Children {
+        YaffsItem** items;
+        int count;
+        int capacity;
+        int fetched;                        //children the model has handed out as rows so far
+        YaffsItem** nameIndex;              //open addressing by name, built once the directory is big enough
+        int nameIndexSize;
+        quint64 totalSize;                  //size of every file below the directory
+        int totalCount;                     //number of objects below the directory
+    };
+
+    struct SourceData {
+        const char* filename;
+        qint64 offset;                      //of the data in an archive or the header in an image
+        qint64 mtime;                       //local files, when they were imported
+        quint64 inode;
+    };
+
+    YaffsItem(YaffsArena* arena, const yaffs_obj_hdr* yaffsObjectHeader, int headerPosition, int yaffsObjectId);
+    YaffsItem(YaffsArena* arena, YaffsItem* parent, const QString& name, yaffs_obj_type type);
+    YaffsItem(const YaffsItem&);
+    YaffsItem& operator=(const YaffsItem&);
+    static void* allocate(YaffsArena* arena);
+    void buildNameIndex(int size);
+    void addToNameIndex(YaffsItem* child);
+    bool removeFromNameIndex(YaffsItem* child);
     QString parseMode(int mode) const;
     void makeDirty();
+    void setSourceData(Source source, const char* filename, qint64 offset);
 
 private:
+    YaffsArena* mArena;
     YaffsItem* mParentItem;
+    const char* mName;
+    union {
+        Children* mChildren;                //directories
+        const char* mAlias;                 //symlinks
+        SourceData* mSourceData;            //files, where the data is - only for new files
+    };
+    int mRow;                           //position in the parent's children, -1 once removed
     int mHeaderPosition;
     int mYaffsObjectId;
-    QList<YaffsItem*> mChildItems;
-    yaffs_obj_hdr mYaffsObjectHeader;
-    Condition mCondition;
-    QString mExternalFilename;      //filename with path - only for new files
-    bool mMarkedForDelete;
-    bool mHasChildMarkedForDelete;
+    int mParentObjectId;
+    u32 mMode;
+    u32 mUid;
+    u32 mGid;
+    u32 mAtime;
+    u32 mMtime;
+    u32 mCtime;
+    u32 mFileSize;
+    u16 mDisplayVersion;                //bumped whenever a shown value changes
+    u8 mType : 4;
+    u8 mCondition : 4;
+    bool mMarkedForDelete : 1;
+    bool mHasChildMarkedForDelete : 1;
+    u8 mSource : 2;
 };
 
 #endif  //YAFFSITEM_H
@@ -42,6 +42,9 @@ YaffsModel* YaffsManager::newModel() {
     mYaffsModel = new YaffsModel();
     connect(mYaffsModel, SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&)), SLOT(on_model_DataChanged(QModelIndex, QModelIndex)));
     connect(mYaffsModel, SIGNAL(layoutChanged()), SLOT(on_model_LayoutChanged()));
+    connect(mYaffsModel, SIGNAL(rowsInserted(const QModelIndex&, int, int)), SLOT(on_model_RowsChanged()));
+    connect(mYaffsModel, SIGNAL(rowsRemoved(const QModelIndex&, int, int)), SLOT(on_model_RowsChanged()));
+    connect(mYaffsModel, SIGNAL(modelReset()), SLOT(on_model_RowsChanged()));
     return mYaffsModel;
 }
 
@@ -66,6 +69,10 @@ void YaffsManager::on_model_LayoutChanged() {
     emit modelChanged();
 }
 
+void YaffsManager::on_model_RowsChanged() {
+    emit modelChanged();
+}
+
 void YaffsManager::exportItem(const YaffsItem* item, const QString& path) {
     if (item) {
         if (item->isFile()) {
@@ -86,6 +93,7 @@ void YaffsManager::exportFile(const YaffsItem* item, const QString& path) {
         QString imageFilename = mYaffsModel->getImageFilename();
         YaffsControl yaffsControl(imageFilename.toStdString().c_str(), NULL);
         if (yaffsControl.open(YaffsControl::OPEN_READ)) {
+            yaffsControl.setChunkMap(mYaffsModel->getChunkMap());
             size_t bytesExtracted = 0;
             char* data = yaffsControl.extractFile(headerPosition, bytesExtracted);
             if (bytesExtracted == filesize) {
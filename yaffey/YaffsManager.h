@@ -48,6 +48,7 @@ signals:
 private slots:
     void on_model_DataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
     void on_model_LayoutChanged();
+    void on_model_RowsChanged();
 
 private:
     YaffsManager();
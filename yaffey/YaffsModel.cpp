@@ -16,31 +16,142 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 
-#include <QtGui>
+#include <QtCore>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <limits.h>
 
 #include "YaffsModel.h"
 #include "Utils.h"
 
+//functor for reading the imported local files on the thread pool
+struct ReadHostFile {
+    typedef YaffsHostFile result_type;
+
+    YaffsHostFile operator()(const YaffsItem* item) const {
+        YaffsHostFile hostFile;
+        hostFile.read(item->getExternalFilename());
+        return hostFile;
+    }
+};
+
+//display text for the visible rows, direct mapped on item and column
+static const int DISPLAY_CACHE_SIZE = 16384;
+
+//rows handed to the view per fetchMore() call
+static const int FETCH_PAGE_SIZE = 2000;
+
+//sort keys are worked out once per item before a directory is sorted, text columns
+//compare the item's own utf8 string and everything else is a number
+struct SortKey {
+    quint64 value;
+    const char* text;
+    YaffsItem* item;
+};
+
+static bool sortKeyLessThan(const SortKey& a, const SortKey& b) {
+    if (a.text) {
+        return (qstricmp(a.text, b.text) < 0);
+    }
+    return (a.value < b.value);
+}
+
+static bool sortKeyGreaterThan(const SortKey& a, const SortKey& b) {
+    return sortKeyLessThan(b, a);
+}
+
+static bool totalSizeGreaterThan(const YaffsItem* a, const YaffsItem* b) {
+    return (a->getTotalSize() > b->getTotalSize());
+}
+
+static void collectDirectories(YaffsItem* item, QVector<YaffsItem*>& dirs) {
+    int childCount = item->childCount();
+    for (int i = 0; i < childCount; ++i) {
+        YaffsItem* childItem = item->child(i);
+        if (childItem->isDir()) {
+            dirs.append(childItem);
+            collectDirectories(childItem, dirs);
+        }
+    }
+}
+
+static void makeSortKey(SortKey& key, YaffsItem* item, int column) {
+    key.value = 0;
+    key.text = NULL;
+    key.item = item;
+
+    switch (column) {
+    case YaffsItem::NAME:
+        key.text = item->getNameUtf8();
+        break;
+    case YaffsItem::SIZE:
+        key.value = item->getTotalSize();
+        break;
+    case YaffsItem::PERMISSIONS:
+        key.value = item->getPermissions();
+        break;
+    case YaffsItem::ALIAS:
+        key.text = item->getAliasUtf8();
+        break;
+    case YaffsItem::DATE_ACCESSED:
+        key.value = item->getAccessTime();
+        break;
+    case YaffsItem::DATE_CREATED:
+        key.value = item->getCreationTime();
+        break;
+    case YaffsItem::DATE_MODIFIED:
+        key.value = item->getModificationTime();
+        break;
+    case YaffsItem::USER:
+        key.value = item->getUserId();
+        break;
+    case YaffsItem::GROUP:
+        key.value = item->getGroupId();
+        break;
+#ifdef QT_DEBUG
+    case YaffsItem::OBJECTID:
+        key.value = static_cast<uint>(item->getObjectId());
+        break;
+    case YaffsItem::PARENTID:
+        key.value = static_cast<uint>(item->getParentObjectId());
+        break;
+    case YaffsItem::HEADERPOS:
+        key.value = static_cast<uint>(item->getHeaderPosition());
+        break;
+#endif  //QT_DEBUG
+    }
+}
+
 YaffsModel::YaffsModel(QObject* parent) : QAbstractItemModel(parent) {
+    mArena = new YaffsArena();
     mYaffsRoot = NULL;
     mYaffsSaveControl = NULL;
     mSaveInfo = NULL;
+    mWriteOptions = YaffsControl::getDefaultWriteOptions();
+    mBatchDepth = 0;
+    mNextImportId = 0;
+
+    DisplayCacheEntry emptyEntry = { NULL, 0, 0, QVariant() };
+    mDisplayCache.fill(emptyEntry, DISPLAY_CACHE_SIZE);
 
     mItemsNew = 0;
     mItemsDirty = 0;
     mItemsDeleted = 0;
 }
 
+//all the items are freed along with the arena
 YaffsModel::~YaffsModel() {
-    delete mYaffsRoot;
+    delete mArena;
 }
 
 void YaffsModel::newImage(const QString& newImageName) {
-    mYaffsRoot = YaffsItem::createRoot();
+    beginResetModel();
+    mNameIndex.clear();
+    mYaffsRoot = YaffsItem::createRoot(mArena);
     mItemsNew++;
     mImageFilename = newImageName;
-
-    emit layoutChanged();
+    endResetModel();
 }
 
 YaffsReadInfo YaffsModel::openImage(const QString& imageFilename) {
@@ -52,43 +163,57 @@ YaffsReadInfo YaffsModel::openImage(const QString& imageFilename) {
     if (mYaffsRoot == NULL) {
         YaffsControl yaffsControl(mImageFilename.toStdString().c_str(), this);
         if (yaffsControl.open(YaffsControl::OPEN_READ)) {
+            //the block geometry is needed to find a checkpoint
+            yaffsControl.setWriteOptions(mWriteOptions);
+            beginResetModel();
+            mNameIndex.clear();
             if (yaffsControl.readImage()) {
                 readInfo = yaffsControl.getReadInfo();
+                mChunkMap = yaffsControl.getChunkMap();
 
                 mItemsNew = 0;
                 mItemsDirty = 0;
                 mItemsDeleted = 0;
-
-                emit layoutChanged();
             }
+            endResetModel();
         }
     }
 
     return readInfo;
 }
 
-//get the YaffsItem at the given internal path or create the path and return a new item.
-//will return null if root doesn't exist
+//get the directory at the given internal path or create the path and return a new item.
+//will return null if root doesn't exist or something on the path isn't a directory, like the
+//symlinks android images often have for /system/vendor
 YaffsItem* YaffsModel::pathToItem(const QString& path) {
     YaffsItem* parentItem = mYaffsRoot;
     if (parentItem != NULL) {
-        QStringList parentDirNames = path.split('/');
+        QStringList parentDirNames = path.split('/', QString::SkipEmptyParts);
+        QString fullPath = "/" + parentDirNames.join("/");
+
+        //whole paths already resolved are remembered until something is renamed or deleted
+        YaffsItem* item = mPathIndex.value(fullPath);
+        if (item != NULL && item->isDir()) {
+            return item;
+        }
+
         for (int i = 0; i < parentDirNames.length(); ++i) {
             QString dirName = parentDirNames[i];
-            if (dirName.length() > 0) {
-                YaffsItem* childItem = parentItem->findItemWithName(dirName);
-                if (childItem != NULL) {
-                    //found item
-                    parentItem = childItem;
-                } else {
-                    //need to create directory
-                    YaffsItem* newDir = YaffsItem::createDirectory(parentItem, dirName);
-                    parentItem->appendChild(newDir);
-                    mItemsNew++;
-                    parentItem = newDir;
+            YaffsItem* childItem = parentItem->findItemWithName(dirName);
+            if (childItem != NULL) {
+                if (!childItem->isDir()) {
+                    qDebug() << "pathToItem(), not a directory: " << childItem->getFullPath();
+                    return NULL;
                 }
+                parentItem = childItem;
+            } else {
+                //need to create directory
+                YaffsItem* newDir = YaffsItem::createDirectory(parentItem, dirName);
+                insertChild(parentItem, newDir);
+                parentItem = newDir;
             }
         }
+        mPathIndex.insert(fullPath, parentItem);
     }
     return parentItem;
 }
@@ -106,17 +231,22 @@ YaffsItem* YaffsModel::importFile(const QString& externalFilenameWithPath, const
         fileName = internalFilenameWithPath.right(len - (slash + 1));
     }
 
+    //batched so the view only sees the file once it has its final name
+    beginBatch();
     YaffsItem* parentItem = pathToItem(path);
     if (parentItem != NULL) {
         //check to make sure an item of the same name doesn't already exist
         if (parentItem->findItemWithName(fileName) == NULL) {
             importedFile = importFile(parentItem, externalFilenameWithPath);
-            importedFile->setName(fileName);
-            importedFile->setUserId(uid);
-            importedFile->setGroupId(gid);
-            importedFile->setPermissions(permissions);
+            if (importedFile != NULL) {
+                importedFile->setName(fileName);
+                importedFile->setUserId(uid);
+                importedFile->setGroupId(gid);
+                importedFile->setPermissions(permissions);
+            }
         }
     }
+    endBatch();
 
     return importedFile;
 }
@@ -126,46 +256,333 @@ YaffsItem* YaffsModel::importFile(YaffsItem* parentItem, const QString& filename
 
     YaffsItem* importedFile = NULL;
     if (parentItem && filenameWithPath.length() > 0) {
-        QFileInfo fileInfo(filenameWithPath);
-        if (fileInfo.exists()) {
-            importedFile = YaffsItem::createFile(parentItem, filenameWithPath, fileInfo.size());
-            parentItem->appendChild(importedFile);
-            mItemsNew++;
-
-            emit layoutChanged();
+        YaffsHostFile hostFile;
+        if (hostFile.read(filenameWithPath)) {
+            importedFile = YaffsItem::createFile(parentItem, filenameWithPath, hostFile);
+            insertChild(parentItem, importedFile);
         }
     }
     return importedFile;
 }
 
+//the directory is walked on the thread pool, see YaffsImportWalker
 void YaffsModel::importDirectory(YaffsItem* parentItem, const QString& externalDirNameWithPath) {
     qDebug() << "importDirectory(), parentItem: " << parentItem << ", externalDirNameWithPath: " << externalDirNameWithPath;
 
     if (parentItem && externalDirNameWithPath.length() > 0) {
-        int slashPos = externalDirNameWithPath.lastIndexOf('/');
-        QString dirName = externalDirNameWithPath.mid(slashPos + 1);
-
-        YaffsItem* newDir = YaffsItem::createDirectory(parentItem, dirName);
-        parentItem->appendChild(newDir);
-        mItemsNew++;
-
-        QDirIterator dirs(externalDirNameWithPath, QDirIterator::NoIteratorFlags);
-        while (dirs.hasNext()) {
-            QFileInfo fileInfo(dirs.next());
-            QString fileName = fileInfo.fileName();
-            QString fileNameWithPath = fileInfo.absoluteFilePath();
-
-            if (fileInfo.isDir()) {
-                if (fileName != "." && fileName != "..") {
-                    importDirectory(newDir, fileNameWithPath);
+        YaffsImportWalker walker(externalDirNameWithPath);
+        walker.start();
+        walker.waitForFinished();
+        importDirectory(parentItem, walker.getRoot());
+    }
+}
+
+//the items for a finished walk are put together on their own and then added to the tree as one
+//row, an fs_config list is applied to them on the way so nothing else has to be told about it
+YaffsItem* YaffsModel::importDirectory(YaffsItem* parentItem, const YaffsImportEntry* dirEntry, const YaffsFsConfig* fsConfig) {
+    YaffsItem* newDir = NULL;
+    if (parentItem && dirEntry) {
+        newDir = YaffsItem::createDirectory(parentItem, dirEntry->name);
+        QString path = (parentItem->isRoot() ? "" : parentItem->getFullPath()) + "/" + dirEntry->name;
+        if (fsConfig) {
+            fsConfig->apply(newDir, path);
+        }
+        mItemsNew += createImportedItems(newDir, dirEntry, path, fsConfig);
+        newDir->computeTotals();
+        insertChild(parentItem, newDir);
+    }
+    return newDir;
+}
+
+//a directory being walked in the background is shown as an empty one until the walk finishes, see
+//YaffsImportJob. it's a real item so it can be deleted in the meantime, which drops the import.
+//the import is known by an id rather than the placeholder, whose address is reused once deleted
+int YaffsModel::beginImport(YaffsItem* parentItem, const QString& dirName) {
+    int importId = -1;
+    if (parentItem && parentItem->isDir()) {
+        YaffsItem* placeholder = YaffsItem::createDirectory(parentItem, dirName);
+        insertChild(parentItem, placeholder);
+
+        importId = mNextImportId++;
+        PendingImport pendingImport = { placeholder, 0 };
+        mPendingImports.insert(importId, pendingImport);
+        mImportPlaceholders.insert(placeholder, importId);
+    }
+    return importId;
+}
+
+void YaffsModel::setImportProgress(int importId, int numEntries) {
+    QHash<int, PendingImport>::iterator it = mPendingImports.find(importId);
+    if (it != mPendingImports.end()) {
+        it.value().numEntries = numEntries;
+        YaffsItem* placeholder = it.value().placeholder;
+        if (isVisible(placeholder)) {
+            QModelIndex nameIndex = createIndex(placeholder->row(), YaffsItem::NAME, placeholder);
+            emit dataChanged(nameIndex, nameIndex);
+        }
+    }
+}
+
+//the walked items go below the placeholder and the view is told about them with one insert
+YaffsItem* YaffsModel::finishImport(int importId, const YaffsImportEntry* dirEntry) {
+    if (!mPendingImports.contains(importId)) {
+        return NULL;
+    }
+
+    YaffsItem* placeholder = mPendingImports.take(importId).placeholder;
+    mImportPlaceholders.remove(placeholder);
+    if (dirEntry == NULL) {
+        return NULL;
+    }
+
+    beginBatch();
+    if (placeholder->fetchedCount() == placeholder->childCount() && isVisible(placeholder)) {
+        mBatchParents.insert(placeholder);
+    }
+    int childCount = placeholder->childCount();
+    mItemsNew += createImportedItems(placeholder, dirEntry, placeholder->getFullPath(), NULL);
+
+    //the walked items are added to the totals of the placeholder and every directory above it
+    qint64 totalSize = 0;
+    int totalCount = 0;
+    for (int i = childCount; i < placeholder->childCount(); ++i) {
+        YaffsItem* childItem = placeholder->child(i);
+        childItem->computeTotals();
+        totalSize += childItem->getTotalSize();
+        totalCount += 1 + childItem->getTotalCount();
+    }
+    placeholder->addToTotals(totalSize, totalCount);
+    totalsChanged(placeholder);
+    mNameIndex.clear();
+    endBatch();
+
+    if (isVisible(placeholder)) {
+        QModelIndex nameIndex = createIndex(placeholder->row(), YaffsItem::NAME, placeholder);
+        emit dataChanged(nameIndex, nameIndex);
+    }
+    return placeholder;
+}
+
+//the merged layers go straight below the parent, each top level entry as one row. names the
+//parent already has are left alone, the layers only decide between themselves
+int YaffsModel::importLayers(YaffsItem* parentItem, const YaffsOverlay& overlay, const YaffsFsConfig* fsConfig) {
+    qDebug() << "importLayers(), parentItem: " << parentItem << ", layers: " << overlay.getLayers();
+
+    int itemsImported = 0;
+    const YaffsImportEntry* rootEntry = overlay.getRoot();
+    if (parentItem && parentItem->isDir() && rootEntry) {
+        QString parentPath = (parentItem->isRoot() ? "" : parentItem->getFullPath());
+        beginBatch();
+        foreach (const YaffsImportEntry* entry, rootEntry->children) {
+            if (parentItem->findItemWithName(entry->name) != NULL) {
+                continue;
+            }
+
+            YaffsItem* item;
+            if (entry->isDir) {
+                item = YaffsItem::createDirectory(parentItem, entry->name);
+            } else {
+                item = YaffsItem::createFile(parentItem, entry->path, entry->hostFile);
+            }
+
+            QString path = parentPath + "/" + entry->name;
+            if (fsConfig) {
+                fsConfig->apply(item, path);
+            }
+            int itemsCreated = 1;
+            if (entry->isDir) {
+                itemsCreated += createImportedItems(item, entry, path, fsConfig);
+                item->computeTotals();
+            }
+            mItemsNew += itemsCreated - 1;
+            insertChild(parentItem, item);
+            itemsImported += itemsCreated;
+        }
+        endBatch();
+    }
+    return itemsImported;
+}
+
+//the entries are added below the parent in the order they're in the archive. directories already
+//there are merged into and keep what they had, anything else with a name that's taken is left alone
+int YaffsModel::importArchive(YaffsItem* parentItem, const YaffsArchive& archive) {
+    qDebug() << "importArchive(), parentItem: " << parentItem << ", archive: " << archive.getFilename();
+
+    int itemsImported = 0;
+    if (parentItem && parentItem->isDir()) {
+        //an archive read from a pipe can't be read again when saving, the data it kept is held on to instead
+        qint64 dataOffset = 0;
+        if (archive.isBuffered()) {
+            QByteArray& data = mArchiveData[archive.getFilename()];
+            if (archive.getData().size() > INT_MAX - data.size()) {
+                qDebug() << "Too much kept from " << archive.getFilename() << " since the last save";
+                return 0;
+            }
+            dataOffset = data.size();
+            data.append(archive.getData());
+        }
+
+        QHash<QString, YaffsItem*> dirs;
+        beginBatch();
+        foreach (const YaffsArchiveEntry& entry, archive.getEntries()) {
+            int slash = entry.path.lastIndexOf('/');
+            QString name = entry.path.mid(slash + 1);
+            YaffsItem* dirItem = (slash >= 0 ? archiveDirectory(parentItem, entry.path.left(slash), dirs) : parentItem);
+            if (dirItem == NULL) {
+                continue;
+            }
+
+            YaffsItem* item = dirItem->findItemWithName(name);
+            uint fileType;
+            if (entry.type == YAFFS_OBJECT_TYPE_DIRECTORY) {
+                fileType = 0040000;
+                if (item == NULL) {
+                    item = YaffsItem::createDirectory(dirItem, name);
+                    insertChild(dirItem, item);
+                } else if (!item->isDir() || item->getCondition() != YaffsItem::NEW) {
+                    continue;
+                }
+                dirs.insert(entry.path, item);
+            } else if (item == NULL) {
+                if (entry.type == YAFFS_OBJECT_TYPE_SYMLINK) {
+                    fileType = 0120000;
+                    item = YaffsItem::createSymLink(dirItem, name, entry.alias);
+                } else {
+                    fileType = 0100000;
+                    item = YaffsItem::createArchiveFile(dirItem, name, archive.getFilename(), dataOffset + entry.offset, static_cast<int>(entry.size));
                 }
-            } else if (fileInfo.isFile()) {
-                importFile(newDir, fileNameWithPath);
+                insertChild(dirItem, item);
+            } else {
+                continue;
             }
+
+            item->setPermissions(fileType | entry.mode);
+            item->setUserId(entry.uid);
+            item->setGroupId(entry.gid);
+            item->setModificationTime(entry.mtime);
+            itemsImported++;
         }
+        endBatch();
+    }
+    return itemsImported;
+}
 
-        emit layoutChanged();
+//directories the archive only has as part of a path are created with the parent's ownership
+YaffsItem* YaffsModel::archiveDirectory(YaffsItem* parentItem, const QString& path, QHash<QString, YaffsItem*>& dirs) {
+    YaffsItem* dirItem = dirs.value(path);
+    if (dirItem == NULL) {
+        int slash = path.lastIndexOf('/');
+        YaffsItem* parentDir = (slash >= 0 ? archiveDirectory(parentItem, path.left(slash), dirs) : parentItem);
+        if (parentDir == NULL) {
+            return NULL;
+        }
+
+        QString name = path.mid(slash + 1);
+        dirItem = parentDir->findItemWithName(name);
+        if (dirItem == NULL) {
+            dirItem = YaffsItem::createDirectory(parentDir, name);
+            insertChild(parentDir, dirItem);
+        } else if (!dirItem->isDir()) {
+            return NULL;
+        }
+        dirs.insert(path, dirItem);
+    }
+    return dirItem;
+}
+
+//copies an item and everything below it from another image that's been opened, the copies keep
+//all of their metadata and their file data is copied chunk by chunk from that image when saving
+int YaffsModel::importFromImage(YaffsItem* parentItem, const YaffsModel& sourceModel, const QString& sourcePath) {
+    qDebug() << "importFromImage(), parentItem: " << parentItem << ", image: " << sourceModel.getImageFilename() << ", path: " << sourcePath;
+
+    int itemsImported = 0;
+    const YaffsItem* sourceItem = sourceModel.itemAtPath(sourcePath);
+    if (parentItem && parentItem->isDir() && sourceItem) {
+        //the copies' data is read from the source image when saving, through its checkpoint if it had one
+        if (!sourceModel.getChunkMap().isEmpty()) {
+            mSourceChunkMaps.insert(sourceModel.getImageFilename(), sourceModel.getChunkMap());
+        }
+
+        beginBatch();
+        if (sourceItem->isRoot()) {
+            int childCount = sourceItem->childCount();
+            for (int i = 0; i < childCount; ++i) {
+                itemsImported += importCopy(parentItem, sourceItem->child(i), sourceModel.getImageFilename());
+            }
+        } else {
+            itemsImported = importCopy(parentItem, sourceItem, sourceModel.getImageFilename());
+        }
+        endBatch();
+    }
+    return itemsImported;
+}
+
+//the copy is put together on its own and added to the tree as one row, like an imported directory
+int YaffsModel::importCopy(YaffsItem* parentItem, const YaffsItem* sourceItem, const QString& sourceImageFilename) {
+    if ((!sourceItem->isDir() && !sourceItem->isFile() && !sourceItem->isSymLink()) ||
+        parentItem->findItemWithName(sourceItem->getName()) != NULL) {
+        return 0;
+    }
+
+    YaffsItem* item = YaffsItem::createCopy(parentItem, sourceItem, sourceImageFilename);
+    int itemsCreated = 1;
+    if (item->isDir()) {
+        itemsCreated += createCopiedItems(item, sourceItem, sourceImageFilename);
+        item->computeTotals();
+    }
+    mItemsNew += itemsCreated - 1;
+    insertChild(parentItem, item);
+    return itemsCreated;
+}
+
+int YaffsModel::createCopiedItems(YaffsItem* dirItem, const YaffsItem* sourceDir, const QString& sourceImageFilename) {
+    int itemsCreated = 0;
+    int childCount = sourceDir->childCount();
+    for (int i = 0; i < childCount; ++i) {
+        const YaffsItem* sourceItem = sourceDir->child(i);
+        if (sourceItem->isDir() || sourceItem->isFile() || sourceItem->isSymLink()) {
+            YaffsItem* item = YaffsItem::createCopy(dirItem, sourceItem, sourceImageFilename);
+            if (item->isDir()) {
+                itemsCreated += createCopiedItems(item, sourceItem, sourceImageFilename);
+            }
+            dirItem->appendChild(item);
+            itemsCreated++;
+        }
+    }
+    return itemsCreated;
+}
+
+//like pathToItem() but nothing is created, null if there's no such item
+YaffsItem* YaffsModel::itemAtPath(const QString& path) const {
+    YaffsItem* item = mYaffsRoot;
+    QStringList names = path.split('/', QString::SkipEmptyParts);
+    for (int i = 0; i < names.length() && item != NULL; ++i) {
+        item = item->findItemWithName(names.at(i));
+    }
+    return item;
+}
+
+int YaffsModel::createImportedItems(YaffsItem* dirItem, const YaffsImportEntry* dirEntry, const QString& dirPath, const YaffsFsConfig* fsConfig) {
+    int itemsCreated = 0;
+    foreach (const YaffsImportEntry* entry, dirEntry->children) {
+        YaffsItem* item;
+        if (entry->isDir) {
+            item = YaffsItem::createDirectory(dirItem, entry->name);
+        } else {
+            item = YaffsItem::createFile(dirItem, entry->path, entry->hostFile);
+        }
+
+        QString path = dirPath + "/" + entry->name;
+        if (fsConfig) {
+            fsConfig->apply(item, path);
+        }
+        if (entry->isDir) {
+            itemsCreated += createImportedItems(item, entry, path, fsConfig);
+        }
+        dirItem->appendChild(item);
+        itemsCreated++;
     }
+    return itemsCreated;
 }
 
 YaffsItem* YaffsModel::createSymLink(const QString& internalFilenameWithPath, const QString& alias, uint uid, uint gid, uint permissions) {
@@ -181,20 +598,116 @@ YaffsItem* YaffsModel::createSymLink(const QString& internalFilenameWithPath, co
         fileName = internalFilenameWithPath.right(len - (slash + 1));
     }
 
+    beginBatch();
     YaffsItem* parentItem = pathToItem(path);
     if (parentItem != NULL) {
         //check to make sure an item of the same name doesn't already exist
         if (parentItem->findItemWithName(fileName) == NULL) {
             newSymLink = YaffsItem::createSymLink(parentItem, fileName, alias, uid, gid, permissions);
-            parentItem->appendChild(newSymLink);
-            mItemsNew++;
-            emit layoutChanged();
+            insertChild(parentItem, newSymLink);
         }
     }
+    endBatch();
 
     return newSymLink;
 }
 
+//while a batch is open new items are added to the tree straight away but the view is only told
+//about them when the outermost batch ends, with one insert per parent it already had every row of
+void YaffsModel::beginBatch() {
+    mBatchDepth++;
+}
+
+void YaffsModel::endBatch() {
+    if (mBatchDepth > 0 && --mBatchDepth == 0) {
+        QList<YaffsItem*> batchParents = mBatchParents.toList();
+        mBatchParents.clear();
+
+        foreach (YaffsItem* parentItem, batchParents) {
+            int first = parentItem->fetchedCount();
+            int last = parentItem->childCount() - 1;
+            if (last >= first) {
+                beginInsertRows(createIndex(parentItem->row(), 0, parentItem), first, last);
+                parentItem->setFetchedCount(last + 1);
+                endInsertRows();
+            }
+        }
+
+        //every directory whose totals went up is told about once
+        QList<YaffsItem*> batchTotals = mBatchTotals.toList();
+        mBatchTotals.clear();
+
+        QSet<YaffsItem*> changedItems;
+        foreach (YaffsItem* item, batchTotals) {
+            for (; item != NULL && !changedItems.contains(item); item = item->parent()) {
+                changedItems.insert(item);
+            }
+        }
+        foreach (YaffsItem* item, changedItems) {
+            if (isVisible(item)) {
+                QModelIndex sizeIndex = createIndex(item->row(), YaffsItem::SIZE, item);
+                emit dataChanged(sizeIndex, sizeIndex);
+            }
+        }
+    }
+}
+
+//rows past a parent's fetched count are left for fetchMore(), so only a parent the view can see
+//with all its rows fetched needs to be told about a new child
+void YaffsModel::insertChild(YaffsItem* parentItem, YaffsItem* childItem) {
+    if (!parentItem->isDir()) {
+        qDebug() << "insertChild(), parent isn't a directory: " << parentItem->getFullPath();
+        return;
+    }
+
+    mNameIndex.clear();
+    bool notify = (parentItem->fetchedCount() == parentItem->childCount() && isVisible(parentItem));
+    if (mBatchDepth > 0) {
+        if (notify) {
+            mBatchParents.insert(parentItem);
+        }
+        parentItem->appendChild(childItem);
+    } else if (notify) {
+        int row = parentItem->childCount();
+        beginInsertRows(createIndex(parentItem->row(), 0, parentItem), row, row);
+        parentItem->appendChild(childItem);
+        parentItem->setFetchedCount(row + 1);
+        endInsertRows();
+    } else {
+        parentItem->appendChild(childItem);
+    }
+    parentItem->addToTotals(childItem->getTotalSize(), 1 + childItem->getTotalCount());
+    totalsChanged(parentItem);
+    mItemsNew++;
+}
+
+//the size column of a directory and the ones above it shows their totals
+void YaffsModel::totalsChanged(YaffsItem* item) {
+    if (mBatchDepth > 0) {
+        mBatchTotals.insert(item);
+        return;
+    }
+
+    while (item != NULL && !isVisible(item)) {
+        item = item->parent();
+    }
+    for (; item != NULL; item = item->parent()) {
+        QModelIndex sizeIndex = createIndex(item->row(), YaffsItem::SIZE, item);
+        emit dataChanged(sizeIndex, sizeIndex);
+    }
+}
+
+//true if the item and all its ancestors are rows the view has been given
+bool YaffsModel::isVisible(const YaffsItem* item) const {
+    for (const YaffsItem* parentItem = item->parent(); parentItem != NULL; parentItem = parentItem->parent()) {
+        if (item->row() >= parentItem->fetchedCount()) {
+            return false;
+        }
+        item = parentItem;
+    }
+    return true;
+}
+
 bool YaffsModel::saveAs(const QString& filename, YaffsSaveInfo& saveInfo) {
     memset(&saveInfo, 0, sizeof(YaffsSaveInfo));
     bool result = false;
@@ -208,8 +721,17 @@ bool YaffsModel::saveAs(const QString& filename, YaffsSaveInfo& saveInfo) {
         if (!tmpFileInfo.exists()) {
             mYaffsSaveControl = new YaffsControl(tmpFilename.toStdString().c_str(), NULL);
             if (mYaffsSaveControl->open(YaffsControl::OPEN_NEW)) {
+                mYaffsSaveControl->setWriteOptions(mWriteOptions);
+                refreshHostFiles();
                 saveDirectory(mYaffsRoot);
+                mMissingHostFiles.clear();
+                qDeleteAll(mArchiveReaders);
+                mArchiveReaders.clear();
                 result = (mSaveInfo->numDirsFailed + mSaveInfo->numFilesFailed + mSaveInfo->numSymLinksFailed == 0);
+                if (result) {
+                    result = mYaffsSaveControl->finishImage();
+                    mSaveInfo->checkpointWritten = mYaffsSaveControl->hasCheckpoint();
+                }
             }
             delete mYaffsSaveControl;
             mYaffsSaveControl = NULL;
@@ -226,10 +748,16 @@ bool YaffsModel::saveAs(const QString& filename, YaffsSaveInfo& saveInfo) {
                     //rename the tmp file to the goal filename
                     result = QFile::rename(tmpFilename, filename);
 
-                    mItemsNew = 0;
+                    //files that had gone are still new, they're tried again on the next save
+                    mItemsNew = saveInfo.numFilesMissing;
                     mItemsDirty = 0;
                     mItemsDeleted = 0;
                     mImageFilename = filename;
+
+                    //every file's data now follows its header in the saved image
+                    mChunkMap = YaffsChunkMap();
+                    mSourceChunkMaps.clear();
+                    mArchiveData.clear();
                 }
             }
 
@@ -241,6 +769,44 @@ bool YaffsModel::saveAs(const QString& filename, YaffsSaveInfo& saveInfo) {
     return result;
 }
 
+//imported local files are only looked at again now, all at once on the thread pool. ones that
+//have changed are saved as they are now, ones that have gone are counted and left out of the image
+void YaffsModel::refreshHostFiles() {
+    QList<YaffsItem*> items;
+    collectHostFiles(mYaffsRoot, items);
+    QList<YaffsHostFile> hostFiles = QtConcurrent::blockingMapped<QList<YaffsHostFile> >(items, ReadHostFile());
+
+    beginBatch();
+    for (int i = 0; i < items.size(); ++i) {
+        YaffsItem* item = items.at(i);
+        const YaffsHostFile& hostFile = hostFiles.at(i);
+        if (hostFile.isMissing()) {
+            qDebug() << "Missing: " << item->getExternalFilename();
+            mMissingHostFiles.insert(item);
+            mSaveInfo->numFilesMissing++;
+        } else if (hostFile != item->getHostFile()) {
+            qint64 sizeChange = hostFile.size - static_cast<qint64>(item->getFileSize());
+            item->setHostFile(hostFile);
+            item->parent()->addToTotals(sizeChange, 0);
+            totalsChanged(item);
+            mSaveInfo->numFilesRefreshed++;
+        }
+    }
+    endBatch();
+}
+
+void YaffsModel::collectHostFiles(YaffsItem* dirItem, QList<YaffsItem*>& items) {
+    int childCount = dirItem->childCount();
+    for (int i = 0; i < childCount; ++i) {
+        YaffsItem* item = dirItem->child(i);
+        if (item->isDir()) {
+            collectHostFiles(item, items);
+        } else if (item->getCondition() == YaffsItem::NEW && item->getSource() == YaffsItem::SOURCE_FILE) {
+            items.append(item);
+        }
+    }
+}
+
 void YaffsModel::saveDirectory(YaffsItem* dirItem) {
     if (dirItem) {
         YaffsItem* parentItem = dirItem->parent();
@@ -271,7 +837,9 @@ void YaffsModel::saveDirectory(YaffsItem* dirItem) {
                 if (childItem->isDir()) {
                     saveDirectory(childItem);
                 } else if (childItem->isFile()) {
-                    saveFile(childItem);
+                    if (!mMissingHostFiles.contains(childItem)) {
+                        saveFile(childItem);
+                    }
                 } else if (childItem->isSymLink()) {
                     saveSymLink(childItem);
                 }
@@ -297,12 +865,32 @@ void YaffsModel::saveFile(YaffsItem* fileItem) {
 
         if (fileItem->isFile()) {
             YaffsItem::Condition condition = fileItem->getCondition();
+            YaffsItem::Source source = fileItem->getSource();
             size_t filesize = fileItem->getFileSize();
             int newObjectId = -1;
             int newHeaderPos = -1;
 
+            //if item is new and from an archive then read its data straight out of the archive, or
+            //out of what was kept of an archive that came down a pipe
+            if (condition == YaffsItem::NEW && source == YaffsItem::SOURCE_ARCHIVE) {
+                QString archiveFilename = fileItem->getExternalFilename();
+                qint64 offset = fileItem->getSourceOffset();
+                const char* data = NULL;
+                QHash<QString, QByteArray>::const_iterator kept = mArchiveData.constFind(archiveFilename);
+                if (kept != mArchiveData.constEnd()) {
+                    data = (offset + static_cast<qint64>(filesize) <= kept.value().size() ? kept.value().constData() + offset : NULL);
+                } else {
+                    YaffsArchiveReader*& reader = mArchiveReaders[archiveFilename];
+                    if (reader == NULL) {
+                        reader = new YaffsArchiveReader(archiveFilename);
+                    }
+                    data = reader->read(offset, filesize);
+                }
+                if (data) {
+                    newObjectId = mYaffsSaveControl->addFile(fileItem->getHeader(), newHeaderPos, data, static_cast<int>(filesize));
+                }
             //if item is new then get the data from the local file system
-            if (condition == YaffsItem::NEW) {
+            } else if (condition == YaffsItem::NEW && source == YaffsItem::SOURCE_FILE) {
                 char* data = new char[filesize];
                 QString filename = fileItem->getExternalFilename();
                 FILE* file = fopen(filename.toStdString().c_str(), "rb");
@@ -314,16 +902,15 @@ void YaffsModel::saveFile(YaffsItem* fileItem) {
                     fclose(file);
                 }
                 delete [] data;
-            //the data is in the opened image so get the it from there
+            //the data is in the opened image, or the one the item was copied from, so copy its chunks across
             } else {
-                int headerPosition = fileItem->getHeaderPosition();
-                YaffsControl yaffsControl(mImageFilename.toStdString().c_str(), NULL);
+                bool fromOtherImage = (condition == YaffsItem::NEW);
+                QString imageFilename = (fromOtherImage ? fileItem->getExternalFilename() : mImageFilename);
+                int headerPosition = (fromOtherImage ? static_cast<int>(fileItem->getSourceOffset()) : fileItem->getHeaderPosition());
+                YaffsControl yaffsControl(imageFilename.toStdString().c_str(), NULL);
                 if (yaffsControl.open(YaffsControl::OPEN_READ)) {
-                    size_t bytesExtracted = 0;
-                    char* data = yaffsControl.extractFile(headerPosition, bytesExtracted);
-                    if (bytesExtracted == filesize) {
-                        newObjectId = mYaffsSaveControl->addFile(fileItem->getHeader(), newHeaderPos, data, static_cast<int>(filesize));
-                    }
+                    yaffsControl.setChunkMap(fromOtherImage ? mSourceChunkMaps.value(imageFilename) : mChunkMap);
+                    newObjectId = mYaffsSaveControl->copyFile(fileItem->getHeader(), newHeaderPos, yaffsControl, headerPosition);
                 }
             }
 
@@ -368,35 +955,11 @@ QVariant YaffsModel::data(const QModelIndex& itemIndex, int role) const {
     YaffsItem* item = static_cast<YaffsItem*>(itemIndex.internalPointer());
     if (itemIndex.isValid() && item) {
         if (role == Qt::DisplayRole) {
-            result = item->data(itemIndex.column());
-        } else if (role == Qt::ForegroundRole) {
-            if (itemIndex.column() == YaffsItem::NAME) {
-                if (item->isDir()) {
-                    result = QVariant(QColor(Qt::blue));
-                } else if (item->isFile()) {
-                    result = QVariant(QColor(Qt::black));
-                } else if (item->isSymLink()) {
-                    result = QVariant(QColor(Qt::darkGreen));
-                }
-            }
-        } else if (role == Qt::BackgroundRole) {
-/*            static const QColor orange(255, 165, 0);
-
-            switch (item->getCondition()) {
-            case YaffsItem::CLEAN:
-                break;
-            case YaffsItem::DIRTY:
-                result = orange;
-                break;
-            case YaffsItem::NEW:
-                result = Qt::green;
-                break;
-            case YaffsItem::MOVED:
-                break;
-            }*/
-        } else if (role == Qt::FontRole) {
-            if (itemIndex.column() == YaffsItem::PERMISSIONS) {
-                result = QFont("Courier");
+            if (itemIndex.column() == YaffsItem::NAME && mImportPlaceholders.contains(item)) {
+                int numEntries = mPendingImports.value(mImportPlaceholders.value(item)).numEntries;
+                result = item->getName() + " (importing, " + QString::number(numEntries) + " found)";
+            } else {
+                result = displayData(item, itemIndex.column());
             }
         } else if (role == Qt::EditRole) {
             switch (itemIndex.column()) {
@@ -421,6 +984,24 @@ QVariant YaffsModel::data(const QModelIndex& itemIndex, int role) const {
     return result;
 }
 
+//formatting sizes, dates and ids on every paint is too slow for big trees so the text is kept
+//until the item says one of its values changed
+QVariant YaffsModel::displayData(const YaffsItem* item, int column) const {
+    if (column > YaffsItem::GROUP) {
+        return item->data(column);
+    }
+
+    uint slot = (static_cast<uint>(reinterpret_cast<quintptr>(item) >> 4) * YaffsItem::COLUMN_COUNT + column) & (DISPLAY_CACHE_SIZE - 1);
+    DisplayCacheEntry& entry = mDisplayCache[slot];
+    if (entry.item != item || entry.column != column || entry.version != item->getDisplayVersion()) {
+        entry.item = item;
+        entry.column = column;
+        entry.version = item->getDisplayVersion();
+        entry.value = item->data(column);
+    }
+    return entry.value;
+}
+
 bool YaffsModel::setData(const QModelIndex& itemIndex, const QVariant& value, int role) {
     bool result = false;
     if (role == Qt::EditRole) {
@@ -429,6 +1010,10 @@ bool YaffsModel::setData(const QModelIndex& itemIndex, const QVariant& value, in
             switch (itemIndex.column()) {
             case YaffsItem::NAME:
                 item->setName(value.toString());
+                if (item->isDir()) {
+                    mPathIndex.clear();
+                }
+                mNameIndex.clear();
                 result = true;
                 break;
             case YaffsItem::PERMISSIONS:
@@ -464,7 +1049,7 @@ Qt::ItemFlags YaffsModel::flags(const QModelIndex& itemIndex) const {
     if (itemIndex.isValid()) {
         flags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
         YaffsItem* item = static_cast<YaffsItem*>(itemIndex.internalPointer());
-        if (!item->isRoot() && itemIndex.column() == YaffsItem::NAME) {
+        if (!item->isRoot() && itemIndex.column() == YaffsItem::NAME && !mImportPlaceholders.contains(item)) {
             flags |= Qt::ItemIsEditable;
         }
     }
@@ -552,7 +1137,8 @@ int YaffsModel::rowCount(const QModelIndex& parentIndex) const {
     }
 
     if (parent) {
-        count = parent->childCount();
+        //only the rows fetched so far, children added in an open batch stay hidden until it ends
+        count = parent->fetchedCount();
     }
 
     return count;
@@ -562,6 +1148,164 @@ int YaffsModel::columnCount(const QModelIndex& /*parentIndex*/) const {
     return YaffsItem::COLUMN_COUNT;
 }
 
+//directories show as expandable before any of their rows have been fetched
+bool YaffsModel::hasChildren(const QModelIndex& parentIndex) const {
+    if (!parentIndex.isValid()) {
+        return (mYaffsRoot != NULL);
+    }
+    YaffsItem* parent = static_cast<YaffsItem*>(parentIndex.internalPointer());
+    return (parent && parent->childCount() > 0);
+}
+
+bool YaffsModel::canFetchMore(const QModelIndex& parentIndex) const {
+    YaffsItem* parent = static_cast<YaffsItem*>(parentIndex.internalPointer());
+    if (parentIndex.isValid() && parent && mBatchDepth == 0) {
+        return (parent->fetchedCount() < parent->childCount());
+    }
+    return false;
+}
+
+//children become rows a page at a time as directories are expanded and scrolled through
+void YaffsModel::fetchMore(const QModelIndex& parentIndex) {
+    YaffsItem* parent = static_cast<YaffsItem*>(parentIndex.internalPointer());
+    if (parentIndex.isValid() && parent && mBatchDepth == 0) {
+        int first = parent->fetchedCount();
+        int last = qMin(first + FETCH_PAGE_SIZE, parent->childCount()) - 1;
+        if (last >= first) {
+            beginInsertRows(parentIndex, first, last);
+            parent->setFetchedCount(last + 1);
+            endInsertRows();
+        }
+    }
+}
+
+//hand every row over to the view, for expanding the whole tree
+void YaffsModel::fetchAll() {
+    if (mYaffsRoot && mBatchDepth == 0) {
+        fetchAllRows(mYaffsRoot);
+    }
+}
+
+void YaffsModel::fetchAllRows(YaffsItem* dirItem) {
+    int first = dirItem->fetchedCount();
+    int last = dirItem->childCount() - 1;
+    if (last >= first) {
+        beginInsertRows(createIndex(dirItem->row(), 0, dirItem), first, last);
+        dirItem->setFetchedCount(last + 1);
+        endInsertRows();
+    }
+
+    for (int i = 0; i <= last; ++i) {
+        YaffsItem* childItem = dirItem->child(i);
+        if (childItem->isDir()) {
+            fetchAllRows(childItem);
+        }
+    }
+}
+
+//sorts the children of every directory in place, rows that are equal keep their order
+void YaffsModel::sort(int column, Qt::SortOrder order) {
+    if (mYaffsRoot && column >= 0 && column < YaffsItem::COLUMN_COUNT && mBatchDepth == 0) {
+        emit layoutAboutToBeChanged();
+
+        QModelIndexList oldIndexes = persistentIndexList();
+        sortChildren(mYaffsRoot, column, order);
+
+        //rows that moved past what the view has fetched can't be kept
+        QModelIndexList newIndexes;
+        foreach (QModelIndex index, oldIndexes) {
+            YaffsItem* item = static_cast<YaffsItem*>(index.internalPointer());
+            if (item && isVisible(item)) {
+                newIndexes.append(createIndex(item->row(), index.column(), item));
+            } else {
+                newIndexes.append(QModelIndex());
+            }
+        }
+        changePersistentIndexList(oldIndexes, newIndexes);
+
+        emit layoutChanged();
+    }
+}
+
+void YaffsModel::sortChildren(YaffsItem* dirItem, int column, Qt::SortOrder order) {
+    int count = dirItem->childCount();
+    if (count > 1) {
+        QVector<SortKey> keys(count);
+        for (int i = 0; i < count; ++i) {
+            makeSortKey(keys[i], dirItem->child(i), column);
+        }
+
+        std::stable_sort(keys.begin(), keys.end(), (order == Qt::AscendingOrder ? sortKeyLessThan : sortKeyGreaterThan));
+
+        QVector<YaffsItem*> items(count);
+        for (int i = 0; i < count; ++i) {
+            items[i] = keys.at(i).item;
+        }
+        dirItem->reorderChildren(items.constData());
+    }
+
+    for (int i = 0; i < count; ++i) {
+        YaffsItem* childItem = dirItem->child(i);
+        if (childItem->isDir()) {
+            sortChildren(childItem, column, order);
+        }
+    }
+}
+
+//items whose name, or full path if the pattern has a slash in it, matches the pattern
+QList<YaffsItem*> YaffsModel::findItems(const QString& pattern, YaffsNameIndex::MatchMode mode) {
+    if (!mNameIndex.isBuilt()) {
+        mNameIndex.build(mYaffsRoot);
+    }
+    return mNameIndex.search(pattern, mode);
+}
+
+//files whose data in the image contains the pattern
+QList<YaffsContentMatch> YaffsModel::findContent(const QString& pattern, bool regex) {
+    QList<YaffsContentMatch> matches;
+    YaffsContentSearch contentSearch(mImageFilename, mChunkMap);
+    if (mYaffsRoot && contentSearch.open()) {
+        matches = contentSearch.search(mYaffsRoot, pattern, regex);
+    }
+    return matches;
+}
+
+//the directories below the root with the biggest totals, biggest first
+QList<YaffsItem*> YaffsModel::largestDirectories(int count) const {
+    QList<YaffsItem*> result;
+    if (mYaffsRoot) {
+        QVector<YaffsItem*> dirs;
+        collectDirectories(mYaffsRoot, dirs);
+
+        int resultCount = qMin(count, dirs.size());
+        std::partial_sort(dirs.begin(), dirs.begin() + resultCount, dirs.end(), totalSizeGreaterThan);
+        for (int i = 0; i < resultCount; ++i) {
+            result.append(dirs.at(i));
+        }
+    }
+    return result;
+}
+
+QModelIndex YaffsModel::itemIndex(YaffsItem* item) const {
+    return (item ? createIndex(item->row(), 0, item) : QModelIndex());
+}
+
+//makes sure the item and the directories above it have been fetched as far as the item's row
+void YaffsModel::fetchItem(YaffsItem* item) {
+    if (item && !item->isRoot() && mBatchDepth == 0) {
+        YaffsItem* parentItem = item->parent();
+        fetchItem(parentItem);
+
+        int first = parentItem->fetchedCount();
+        int last = item->row();
+        if (last >= first) {
+            beginInsertRows(createIndex(parentItem->row(), 0, parentItem), first, last);
+            parentItem->setFetchedCount(last + 1);
+            endInsertRows();
+        }
+    }
+}
+
 int YaffsModel::removeRows(const QModelIndexList& selectedRows) {
     //mark all selected items for delete
     foreach (QModelIndex index, selectedRows) {
@@ -572,125 +1316,146 @@ int YaffsModel::removeRows(const QModelIndexList& selectedRows) {
     }
 
     //iterate through ALL items and process the marked ones
-    return processChildItemsForDelete(mYaffsRoot);
+    QList<YaffsItem*> deletedItems;
+    int itemsDeleted = processChildItemsForDelete(mYaffsRoot, deletedItems);
+
+    //nothing refers to the removed items any more so they can all go back to the arena, the
+    //display cache is keyed on item addresses which are about to be reused. imports whose
+    //placeholder went with them are dropped, their jobs notice and stop
+    if (deletedItems.size() > 0) {
+        if (mPendingImports.size() > 0) {
+            QSet<YaffsItem*> deletedSet = deletedItems.toSet();
+            foreach (int importId, mPendingImports.keys()) {
+                YaffsItem* placeholder = mPendingImports.value(importId).placeholder;
+                for (YaffsItem* item = placeholder; item != NULL; item = item->parent()) {
+                    if (deletedSet.contains(item)) {
+                        mPendingImports.remove(importId);
+                        mImportPlaceholders.remove(placeholder);
+                        break;
+                    }
+                }
+            }
+        }
+        mPathIndex.clear();
+        mNameIndex.clear();
+        foreach (YaffsItem* item, deletedItems) {
+            YaffsItem::release(item);
+        }
+        DisplayCacheEntry emptyEntry = { NULL, 0, 0, QVariant() };
+        mDisplayCache.fill(emptyEntry);
+    }
+
+    mItemsDeleted += itemsDeleted;
+    return itemsDeleted;
 }
 
-int YaffsModel::processChildItemsForDelete(YaffsItem* item) {
+int YaffsModel::processChildItemsForDelete(YaffsItem* item, QList<YaffsItem*>& deletedItems) {
     int itemsDeleted = 0;
     if (item->hasChildMarkedForDelete()) {
         QList<int> rowsToDelete;
 
-        //iterate through child items to build up list of items to delete
+        //iterate through child items to build up list of items to delete, rows come out in order
         for (int i = 0; i < item->childCount(); ++i) {
             YaffsItem* childItem = item->child(i);
             if (childItem->isMarkedForDelete()) {
-                rowsToDelete.append(childItem->row());
+                rowsToDelete.append(i);
             } else if (childItem->hasChildMarkedForDelete()) {
-                itemsDeleted += processChildItemsForDelete(childItem);
+                itemsDeleted += processChildItemsForDelete(childItem, deletedItems);
                 item->setHasChildMarkedForDelete(false);
             }
         }
 
-        itemsDeleted += calculateAndDeleteContiguousRows(rowsToDelete, item);
+        itemsDeleted += deleteContiguousRows(rowsToDelete, item, deletedItems);
     }
     return itemsDeleted;
 }
 
-int YaffsModel::calculateAndDeleteContiguousRows(QList<int>& rows, YaffsItem* parentItem) {
+//each run of adjacent rows is removed with one beginRemoveRows()/endRemoveRows(), working from
+//the last run back so the earlier rows keep their numbers
+int YaffsModel::deleteContiguousRows(const QList<int>& rows, YaffsItem* parentItem, QList<YaffsItem*>& deletedItems) {
     int itemsDeleted = 0;
+    QModelIndex parentIndex = createIndex(parentItem->row(), 0, parentItem);
 
-    qSort(rows);
-
-    int size = rows.size();
-    int thisRow, nextRow;
-    int count = 1;
-
-    for (int i = size - 1; i >= 0; --i) {
-        thisRow = rows.at(i);
-        bool lastRow = (i == 0);
-
-        if (!lastRow) {
-            nextRow = rows.at(i - 1);
+    int last = rows.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1) {
+            --first;
         }
 
-        if (lastRow || nextRow != thisRow - 1) {
-            qDebug() << "Removing rows (start, count): (" << thisRow << ", " << count << ")";
-            QModelIndex parentIndex = createIndex(parentItem->row(), 0, parentItem);
-            itemsDeleted += deleteRows(thisRow, count, parentIndex);
-            count = 0;
-
-            if (lastRow) {
-                break;
-            }
+        int row = rows.at(first);
+        int count = last - first + 1;
+        qDebug() << "Removing rows (start, count): (" << row << ", " << count << ")";
+
+        qint64 totalSize = 0;
+        int totalCount = 0;
+        for (int i = row; i < row + count; ++i) {
+            YaffsItem* item = parentItem->child(i);
+            deletedItems.append(item);
+            totalSize += item->getTotalSize();
+            totalCount += 1 + item->getTotalCount();
+        }
+        parentItem->addToTotals(-totalSize, -totalCount);
+
+        //rows past the fetched count were never given to the view
+        int fetched = parentItem->fetchedCount();
+        if (row < fetched) {
+            beginRemoveRows(parentIndex, row, qMin(row + count, fetched) - 1);
+            parentItem->removeChildren(row, count);
+            endRemoveRows();
+        } else {
+            parentItem->removeChildren(row, count);
         }
 
-        ++count;
+        itemsDeleted += count;
+        last = first - 1;
     }
 
-    return itemsDeleted;
-}
-
-int YaffsModel::deleteRows(int row, int count, const QModelIndex& parentIndex) {
-    int itemsDeleted = 0;
-
-    if (parentIndex.isValid()) {
-        beginRemoveRows(parentIndex, row, row + (count - 1));
-        for (int i = row + (count - 1); i >= row; --i) {
-            YaffsItem* parentItem = static_cast<YaffsItem*>(parentIndex.internalPointer());
-            parentItem->removeChild(row);
-            itemsDeleted++;
-        }
-        endRemoveRows();
-        emit layoutChanged();
+    if (itemsDeleted > 0) {
+        totalsChanged(parentItem);
     }
 
-    mItemsDeleted += itemsDeleted;
     return itemsDeleted;
 }
 
 //from YaffsReaderObserver
 void YaffsModel::newItem(int yaffsObjectId, const yaffs_obj_hdr* yaffsObjectHeader, int fileOffset) {
     if (yaffsObjectId == YAFFS_OBJECTID_ROOT) {
-        mYaffsRoot = new YaffsItem(NULL, yaffsObjectHeader, fileOffset, yaffsObjectId);
+        mYaffsRoot = YaffsItem::create(mArena, yaffsObjectHeader, fileOffset, yaffsObjectId);
         mYaffsRoot->setName("/");
-        mYaffsObjectsItemMap.insert(YAFFS_OBJECTID_ROOT, mYaffsRoot);
+        mYaffsObjects.insert(YAFFS_OBJECTID_ROOT, mYaffsRoot);
         return;
     }
 
-    //get childs parent
-    YaffsItem* parent = mYaffsObjectsItemMap.value(yaffsObjectHeader->parent_obj_id);
-
-    //create item and map it
-    YaffsItem* child = new YaffsItem(parent, yaffsObjectHeader, fileOffset, yaffsObjectId);
-    mYaffsObjectsItemMap.insert(yaffsObjectId, child);
-
-    if (parent) {
-        //add child to parent
-        parent->appendChild(child);
-    } else {
-        qDebug() << "error, parent not found, id: " << yaffsObjectHeader->parent_obj_id;
-        mYaffsObjectsWithoutParent.append(child);
-    }
+    //parents are found once everything has been read, so children can come before them in the file
+    YaffsItem* item = YaffsItem::create(mArena, yaffsObjectHeader, fileOffset, yaffsObjectId);
+    mYaffsObjects.insert(yaffsObjectId, item);
+    mYaffsObjectsRead.append(item);
 }
 
 void YaffsModel::readComplete() {
     //if image didn't contain a root but did contain other stuff, give model a root
-    if (mYaffsRoot == NULL && mYaffsObjectsItemMap.size() > 0) {
-        mYaffsRoot = YaffsItem::createRoot();
-        mYaffsObjectsItemMap.insert(YAFFS_OBJECTID_ROOT, mYaffsRoot);
-    }
-
-    if (mYaffsObjectsWithoutParent.size() > 0) {
-        //child objects might have been before parent
-        foreach (YaffsItem* child, mYaffsObjectsWithoutParent) {
-            YaffsItem* parent = mYaffsObjectsItemMap.value(child->getHeader().parent_obj_id);
-            if (parent) {
-                parent->appendChild(child);
-                qDebug() << "child came before parent in file, parent id: " << child->getHeader().parent_obj_id;
-            } else {
-                qDebug() << "parent still not found, item name: " << child->getName();
-            }
+    if (mYaffsRoot == NULL && mYaffsObjects.size() > 0) {
+        mYaffsRoot = YaffsItem::createRoot(mArena);
+        mYaffsObjects.insert(YAFFS_OBJECTID_ROOT, mYaffsRoot);
+    }
+
+    int count = mYaffsObjectsRead.size();
+    for (int i = 0; i < count; ++i) {
+        YaffsItem* item = mYaffsObjectsRead.at(i);
+        YaffsItem* parent = mYaffsObjects.value(item->getParentObjectId());
+        if (parent && parent != item && parent->isDir()) {
+            parent->appendChild(item);
+        } else {
+            qDebug() << "parent not found, id: " << item->getParentObjectId() << ", item name: " << item->getName();
         }
     }
-    mYaffsObjectsWithoutParent.clear();
+
+    if (mYaffsRoot) {
+        mYaffsRoot->computeTotals();
+    }
+
+    //the table is only needed while reading
+    mYaffsObjectsRead.clear();
+    mYaffsObjects.clear();
 }
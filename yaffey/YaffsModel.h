@@ -21,10 +21,19 @@
 
 #include <QAbstractItemModel>
 #include <QModelIndex>
-#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
 
 #include "YaffsControl.h"
 #include "YaffsItem.h"
+#include "YaffsObjectTable.h"
+#include "YaffsNameIndex.h"
+#include "YaffsContentSearch.h"
+#include "YaffsImportWalker.h"
+#include "YaffsFsConfig.h"
+#include "YaffsArchive.h"
+#include "YaffsOverlay.h"
 
 struct YaffsSaveInfo {
     int numFilesSaved;
@@ -33,6 +42,9 @@ struct YaffsSaveInfo {
     int numDirsFailed;
     int numSymLinksSaved;
     int numSymLinksFailed;
+    int numFilesRefreshed;              //imported files that had changed since
+    int numFilesMissing;                //imported files that had gone, left out of the image
+    bool checkpointWritten;
 };
 
 class YaffsModel : public QAbstractItemModel,
@@ -51,9 +63,24 @@ public:
     YaffsItem* importFile(const QString& externalFilenameWithPath, const QString& internalFilenameWithPath, uint uid, uint gid, uint permissions);
     YaffsItem* importFile(YaffsItem* parentItem, const QString& filenameWithPath);
     void importDirectory(YaffsItem* parentItem, const QString& dirNameWithPath);
+    YaffsItem* importDirectory(YaffsItem* parentItem, const YaffsImportEntry* dirEntry, const YaffsFsConfig* fsConfig = NULL);
+    int beginImport(YaffsItem* parentItem, const QString& dirName);
+    void setImportProgress(int importId, int numEntries);
+    YaffsItem* finishImport(int importId, const YaffsImportEntry* dirEntry);
+    bool isImportPending(int importId) const { return mPendingImports.contains(importId); }
+    bool isImportPlaceholder(const YaffsItem* item) const { return mImportPlaceholders.contains(item); }
+    int getNumPendingImports() const { return mPendingImports.size(); }
+    int importLayers(YaffsItem* parentItem, const YaffsOverlay& overlay, const YaffsFsConfig* fsConfig = NULL);
+    int importArchive(YaffsItem* parentItem, const YaffsArchive& archive);
+    int importFromImage(YaffsItem* parentItem, const YaffsModel& sourceModel, const QString& sourcePath);
     YaffsItem* createSymLink(const QString& internalFilenameWithPath, const QString& alias, uint uid, uint gid, uint permissions);
+    void beginBatch();
+    void endBatch();
     bool saveAs(const QString& filename, YaffsSaveInfo& saveInfo);
+    void setWriteOptions(const YaffsWriteOptions& writeOptions) { mWriteOptions = writeOptions; }
+    const YaffsWriteOptions& getWriteOptions() const { return mWriteOptions; }
     QString getImageFilename() const { return mImageFilename; }
+    const YaffsChunkMap& getChunkMap() const { return mChunkMap; }
     bool isDirty() const { return (mItemsDirty + mItemsDeleted + mItemsNew); }
     bool isImageOpen() const { return (mYaffsRoot != NULL); }
 
@@ -66,6 +93,18 @@ public:
     QModelIndex parent(const QModelIndex& itemIndex) const;
     int rowCount(const QModelIndex& parentIndex = QModelIndex()) const;
     int columnCount(const QModelIndex& parentIndex = QModelIndex()) const;
+    bool hasChildren(const QModelIndex& parentIndex = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex& parentIndex) const;
+    void fetchMore(const QModelIndex& parentIndex);
+    void fetchAll();
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+    QList<YaffsItem*> findItems(const QString& pattern, YaffsNameIndex::MatchMode mode);
+    bool isNameIndexBuilt() const { return mNameIndex.isBuilt(); }     //false once the tree changes after a findItems()
+    QList<YaffsContentMatch> findContent(const QString& pattern, bool regex);
+    QList<YaffsItem*> largestDirectories(int count) const;
+    QModelIndex itemIndex(YaffsItem* item) const;
+    YaffsItem* itemAtPath(const QString& path) const;
+    void fetchItem(YaffsItem* item);
     int removeRows(const QModelIndexList& selectedRows);
 
 protected:
@@ -74,25 +113,64 @@ protected:
     void readComplete();
 
 private:
+    void refreshHostFiles();
+    void collectHostFiles(YaffsItem* dirItem, QList<YaffsItem*>& items);
     void saveDirectory(YaffsItem* dirItem);
     void saveFile(YaffsItem* dirItem);
     void saveSymLink(YaffsItem* dirItem);
-    int processChildItemsForDelete(YaffsItem* item);
-    int calculateAndDeleteContiguousRows(QList<int>& rows, YaffsItem* parentItem);
-    int deleteRows(int row, int count, const QModelIndex& parentIndex);
+    int processChildItemsForDelete(YaffsItem* item, QList<YaffsItem*>& deletedItems);
+    int deleteContiguousRows(const QList<int>& rows, YaffsItem* parentItem, QList<YaffsItem*>& deletedItems);
     YaffsItem* pathToItem(const QString& path);
+    void insertChild(YaffsItem* parentItem, YaffsItem* childItem);
+    YaffsItem* archiveDirectory(YaffsItem* parentItem, const QString& path, QHash<QString, YaffsItem*>& dirs);
+    int importCopy(YaffsItem* parentItem, const YaffsItem* sourceItem, const QString& sourceImageFilename);
+    int createCopiedItems(YaffsItem* dirItem, const YaffsItem* sourceDir, const QString& sourceImageFilename);
+    int createImportedItems(YaffsItem* dirItem, const YaffsImportEntry* dirEntry, const QString& dirPath, const YaffsFsConfig* fsConfig);
+    bool isVisible(const YaffsItem* item) const;
+    void totalsChanged(YaffsItem* item);
+    void fetchAllRows(YaffsItem* dirItem);
+    void sortChildren(YaffsItem* dirItem, int column, Qt::SortOrder order);
+    QVariant displayData(const YaffsItem* item, int column) const;
 
 private:
+    struct PendingImport {
+        YaffsItem* placeholder;
+        int numEntries;                         //found by the walk so far
+    };
+
+    struct DisplayCacheEntry {
+        const YaffsItem* item;
+        int column;
+        uint version;
+        QVariant value;
+    };
+
     QString mImageFilename;
+    YaffsArena* mArena;
     YaffsItem* mYaffsRoot;
-    QMap<int, YaffsItem*> mYaffsObjectsItemMap;
-    QList<YaffsItem*> mYaffsObjectsWithoutParent;
+    YaffsObjectTable mYaffsObjects;
+    QVector<YaffsItem*> mYaffsObjectsRead;      //in the order they were read, linked to their parents once the read completes
+    QHash<QString, YaffsItem*> mPathIndex;
+    YaffsNameIndex mNameIndex;                  //built on the first search after the tree changes
     YaffsControl* mYaffsSaveControl;
+    YaffsChunkMap mChunkMap;                    //from the image's checkpoint, empty if the image was scanned
+    QHash<QString, YaffsChunkMap> mSourceChunkMaps;     //of the other images files were copied from
+    QSet<const YaffsItem*> mMissingHostFiles;   //imported files found to have gone while saving
+    QHash<QString, QByteArray> mArchiveData;    //file data of archives read from a pipe, by the name their items have
+    QHash<QString, YaffsArchiveReader*> mArchiveReaders;    //open while saving
+    YaffsWriteOptions mWriteOptions;
+    int mBatchDepth;
+    QSet<YaffsItem*> mBatchParents;
+    QSet<YaffsItem*> mBatchTotals;              //directories whose totals changed during the batch
+    QHash<int, PendingImport> mPendingImports;  //directories still being walked, by import id
+    QHash<const YaffsItem*, int> mImportPlaceholders;   //import ids by placeholder
+    int mNextImportId;
     int mItemsNew;
     int mItemsDirty;
     int mItemsDeleted;
 
     YaffsSaveInfo* mSaveInfo;
+    mutable QVector<DisplayCacheEntry> mDisplayCache;
 };
 
 #endif  //YAFFSMODEL_H
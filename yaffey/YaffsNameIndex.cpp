@@ -0,0 +1,329 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QRegExp>
+#include <QStringList>
+
+#include <algorithm>
+#include <string.h>
+
+#include "YaffsNameIndex.h"
+#include "YaffsItem.h"
+
+YaffsNameIndex::YaffsNameIndex() {
+    mLastMode = MATCH_SUBSTRING;
+}
+
+void YaffsNameIndex::build(YaffsItem* root) {
+    clear();
+    if (root) {
+        addItems(root);
+    }
+}
+
+void YaffsNameIndex::clear() {
+    mItems.clear();
+    mSubtreeEnd.clear();
+    mTrigrams.clear();
+    mLastPattern.clear();
+    mLastMatches.clear();
+}
+
+void YaffsNameIndex::addItems(YaffsItem* item) {
+    int index = mItems.size();
+    mItems.append(item);
+    mSubtreeEnd.append(index + 1);
+
+    //each trigram of the folded name points at the item once
+    char name[YAFFS_MAX_NAME_LENGTH + 1];
+    fold(item->getNameUtf8(), name, sizeof(name));
+    int length = static_cast<int>(strlen(name));
+    for (int i = 0; i + 3 <= length; ++i) {
+        QVector<int>& postings = mTrigrams[trigram(name + i)];
+        if (postings.isEmpty() || postings.last() != index) {
+            postings.append(index);
+        }
+    }
+
+    int childCount = item->childCount();
+    for (int i = 0; i < childCount; ++i) {
+        addItems(item->child(i));
+    }
+    mSubtreeEnd[index] = mItems.size();
+}
+
+//patterns with a slash in them are matched against full paths, anything else against names
+QList<YaffsItem*> YaffsNameIndex::search(const QString& pattern, MatchMode mode) {
+    QVector<int> matches;
+    if (pattern.contains('/')) {
+        matches = searchPaths(pattern, mode);
+        mLastPattern.clear();
+    } else {
+        bool refine = (mode == MATCH_SUBSTRING && mode == mLastMode && mLastPattern.length() > 0 &&
+                       pattern.contains(mLastPattern, Qt::CaseInsensitive));
+        matches = searchNames(pattern, mode, (refine ? &mLastMatches : NULL));
+        mLastPattern = pattern;
+        mLastMode = mode;
+        mLastMatches = matches;
+    }
+
+    QList<YaffsItem*> result;
+    result.reserve(matches.size());
+    foreach (int index, matches) {
+        result.append(mItems.at(index));
+    }
+    return result;
+}
+
+QVector<int> YaffsNameIndex::searchNames(const QString& pattern, MatchMode mode, const QVector<int>* previous) const {
+    QVector<int> matches;
+
+    QRegExp regExp(pattern, Qt::CaseInsensitive, (mode == MATCH_WILDCARD ? QRegExp::Wildcard : QRegExp::RegExp2));
+    if (mode != MATCH_SUBSTRING && !regExp.isValid()) {
+        return matches;
+    }
+
+    QByteArray folded = pattern.toUtf8();
+    fold(folded.constData(), folded.data(), folded.size() + 1);
+
+    //the previous matches for a shorter substring are a superset of this one's
+    QVector<int> candidateList;
+    if (previous) {
+        candidateList = *previous;
+    } else {
+        candidateList = candidates(literalForPattern(pattern, mode));
+    }
+
+    //wildcards like *.so or lib* are just a prefix or suffix compare
+    bool anyStart = false;
+    bool anyEnd = false;
+    if (mode == MATCH_WILDCARD) {
+        QString core = pattern;
+        anyStart = core.startsWith('*');
+        anyEnd = (core.length() > 1 && core.endsWith('*'));
+        core = core.mid(anyStart ? 1 : 0, core.length() - (anyStart ? 1 : 0) - (anyEnd ? 1 : 0));
+        if (!core.contains('*') && !core.contains('?') && !core.contains('[') && !core.contains('\\')) {
+            mode = MATCH_SUBSTRING;
+            folded = core.toUtf8();
+            fold(folded.constData(), folded.data(), folded.size() + 1);
+        } else {
+            anyStart = anyEnd = true;
+        }
+    } else {
+        anyStart = anyEnd = true;
+    }
+
+    char name[YAFFS_MAX_NAME_LENGTH + 1];
+    int foldedLength = folded.length();
+    foreach (int index, candidateList) {
+        const YaffsItem* item = mItems.at(index);
+        bool match;
+        if (mode == MATCH_SUBSTRING) {
+            fold(item->getNameUtf8(), name, sizeof(name));
+            if (anyStart && anyEnd) {
+                match = (strstr(name, folded.constData()) != NULL);
+            } else {
+                int length = static_cast<int>(strlen(name));
+                if (anyStart) {
+                    match = (length >= foldedLength && strcmp(name + length - foldedLength, folded.constData()) == 0);
+                } else if (anyEnd) {
+                    match = (strncmp(name, folded.constData(), foldedLength) == 0);
+                } else {
+                    match = (strcmp(name, folded.constData()) == 0);
+                }
+            }
+        } else if (mode == MATCH_WILDCARD) {
+            match = regExp.exactMatch(item->getName());
+        } else {
+            match = (regExp.indexIn(item->getName()) != -1);
+        }
+
+        if (match) {
+            matches.append(index);
+        }
+    }
+    return matches;
+}
+
+//a substring ending in some item's name means that name starts with whatever follows the
+//last slash, and once a directory's path matches so does everything below it. wildcards and
+//regexes must have a piece of their literal inside one of the names on the path, so only the
+//subtrees of the items with that piece in their name are checked
+QVector<int> YaffsNameIndex::searchPaths(const QString& pattern, MatchMode mode) const {
+    QVector<int> matches;
+
+    QRegExp regExp(pattern, Qt::CaseInsensitive, (mode == MATCH_WILDCARD ? QRegExp::Wildcard : QRegExp::RegExp2));
+    if (mode != MATCH_SUBSTRING && !regExp.isValid()) {
+        return matches;
+    }
+
+    QVector<int> candidateList;
+    if (mode == MATCH_SUBSTRING) {
+        candidateList = candidates(literalForPattern(pattern.section('/', -1), mode));
+    } else {
+        candidateList = candidates(longestComponent(literalForPattern(pattern, mode)));
+    }
+
+    int end = 0;
+    foreach (int index, candidateList) {
+        if (index < end) {
+            continue;
+        }
+
+        if (mode == MATCH_SUBSTRING) {
+            if (mItems.at(index)->getFullPath().contains(pattern, Qt::CaseInsensitive)) {
+                end = mSubtreeEnd.at(index);
+                for (int i = index; i < end; ++i) {
+                    matches.append(i);
+                }
+            }
+        } else {
+            end = mSubtreeEnd.at(index);
+            for (int i = index; i < end; ++i) {
+                QString path = mItems.at(i)->getFullPath();
+                if (mode == MATCH_WILDCARD ? regExp.exactMatch(path) : (regExp.indexIn(path) != -1)) {
+                    matches.append(i);
+                }
+            }
+        }
+    }
+    return matches;
+}
+
+//items whose names contain every trigram of the literal, or all items if it's too short to have any
+QVector<int> YaffsNameIndex::candidates(const QByteArray& literal) const {
+    QVector<int> result;
+    int length = literal.length();
+    if (length < 3) {
+        result.resize(mItems.size());
+        for (int i = 0; i < result.size(); ++i) {
+            result[i] = i;
+        }
+        return result;
+    }
+
+    QByteArray folded = literal;
+    fold(folded.constData(), folded.data(), folded.size() + 1);
+
+    //intersect the posting lists starting with the shortest
+    QList<const QVector<int>*> lists;
+    for (int i = 0; i + 3 <= length; ++i) {
+        QHash<quint32, QVector<int> >::const_iterator it = mTrigrams.constFind(trigram(folded.constData() + i));
+        if (it == mTrigrams.constEnd()) {
+            return result;
+        }
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), shorterList);
+
+    result = *lists.at(0);
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        const QVector<int>& other = *lists.at(i);
+        QVector<int> intersection;
+        std::set_intersection(result.constBegin(), result.constEnd(), other.constBegin(), other.constEnd(), std::back_inserter(intersection));
+        result = intersection;
+    }
+    return result;
+}
+
+//the longest run of plain characters every match has to contain
+QByteArray YaffsNameIndex::literalForPattern(const QString& pattern, MatchMode mode) {
+    if (mode == MATCH_SUBSTRING) {
+        return pattern.toUtf8();
+    }
+    //alternation and groups can make any run optional, e.g. (abc)? or (abc|x)
+    if (mode == MATCH_REGEX && (pattern.contains('|') || pattern.contains('('))) {
+        return QByteArray();
+    }
+
+    QString best;
+    QString run;
+    int length = pattern.length();
+    for (int i = 0; i <= length; ++i) {
+        QChar c = (i < length ? pattern.at(i) : QChar());
+        bool plain;
+        if (mode == MATCH_WILDCARD) {
+            plain = (i < length && c != '*' && c != '?' && c != '[' && c != ']' && c != '\\');
+        } else {
+            plain = (i < length && (c.isLetterOrNumber() || c == '_' || c == '-' || c == ' ' || c == ',' || c == '/'));
+        }
+
+        if (plain) {
+            run += c;
+        } else {
+            //in a regex the character before a quantifier that allows zero of it is optional
+            if (mode == MATCH_REGEX && run.length() > 0 && (c == '?' || c == '*' || c == '{')) {
+                run.chop(1);
+            }
+            if (run.length() > best.length()) {
+                best = run;
+            }
+            run.clear();
+
+            //skip over escapes, character classes and the counts in a quantifier like {0,1}
+            if (mode == MATCH_REGEX && c == '\\') {
+                ++i;
+            } else if (c == '[') {
+                while (i < length && pattern.at(i) != ']') {
+                    ++i;
+                }
+            } else if (mode == MATCH_REGEX && c == '{') {
+                while (i < length && pattern.at(i) != '}') {
+                    ++i;
+                }
+            }
+        }
+    }
+    return best.toUtf8();
+}
+
+//the longest part of the literal between slashes, which has to be inside a single name
+QByteArray YaffsNameIndex::longestComponent(const QByteArray& literal) {
+    int bestStart = 0;
+    int bestLength = 0;
+    int start = 0;
+    int length = literal.length();
+    for (int i = 0; i <= length; ++i) {
+        if (i == length || literal.at(i) == '/') {
+            if (i - start > bestLength) {
+                bestStart = start;
+                bestLength = i - start;
+            }
+            start = i + 1;
+        }
+    }
+    return literal.mid(bestStart, bestLength);
+}
+
+//ascii case folding, enough for the names found in images
+void YaffsNameIndex::fold(const char* str, char* dest, int destSize) {
+    int i = 0;
+    for (; str[i] && i < destSize - 1; ++i) {
+        char c = str[i];
+        dest[i] = (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+    }
+    dest[i] = '\0';
+}
+
+bool YaffsNameIndex::shorterList(const QVector<int>* a, const QVector<int>* b) {
+    return (a->size() < b->size());
+}
+
+quint32 YaffsNameIndex::trigram(const char* str) {
+    return (static_cast<quint8>(str[0]) << 16) | (static_cast<quint8>(str[1]) << 8) | static_cast<quint8>(str[2]);
+}
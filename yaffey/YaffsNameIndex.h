@@ -0,0 +1,70 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSNAMEINDEX_H
+#define YAFFSNAMEINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+class YaffsItem;
+
+//trigram index over the names of every item in the tree, used to find items by
+//substring, wildcard or regex without visiting them all. items are kept in
+//pre-order so a directory's subtree is a contiguous range
+class YaffsNameIndex {
+public:
+    enum MatchMode {
+        MATCH_SUBSTRING,
+        MATCH_WILDCARD,
+        MATCH_REGEX
+    };
+
+    YaffsNameIndex();
+
+    void build(YaffsItem* root);
+    void clear();
+    bool isBuilt() const { return (mItems.size() > 0); }
+    QList<YaffsItem*> search(const QString& pattern, MatchMode mode);
+
+private:
+    void addItems(YaffsItem* item);
+    QVector<int> candidates(const QByteArray& literal) const;
+    QVector<int> searchNames(const QString& pattern, MatchMode mode, const QVector<int>* previous) const;
+    QVector<int> searchPaths(const QString& pattern, MatchMode mode) const;
+    static QByteArray literalForPattern(const QString& pattern, MatchMode mode);
+    static QByteArray longestComponent(const QByteArray& literal);
+    static void fold(const char* str, char* dest, int destSize);
+    static quint32 trigram(const char* str);
+    static bool shorterList(const QVector<int>* a, const QVector<int>* b);
+
+private:
+    QVector<YaffsItem*> mItems;
+    QVector<int> mSubtreeEnd;               //index after the last item below each item
+    QHash<quint32, QVector<int> > mTrigrams;
+
+    //the last query, so typing more of a name only rechecks what already matched
+    QString mLastPattern;
+    MatchMode mLastMode;
+    QVector<int> mLastMatches;
+};
+
+#endif  //YAFFSNAMEINDEX_H
@@ -0,0 +1,60 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "YaffsObjectTable.h"
+
+//yaffs object ids are 18 bits
+static const int MAX_DENSE_OBJECT_ID = 0x40000;
+static const int MIN_DENSE_SIZE = 1024;
+
+YaffsObjectTable::YaffsObjectTable() {
+    mCount = 0;
+}
+
+void YaffsObjectTable::insert(int objectId, YaffsItem* item) {
+    if (objectId >= 0 && objectId < MAX_DENSE_OBJECT_ID) {
+        if (objectId >= mDense.size()) {
+            int size = qMax(mDense.size() * 2, MIN_DENSE_SIZE);
+            while (size <= objectId) {
+                size *= 2;
+            }
+            mDense.resize(qMin(size, MAX_DENSE_OBJECT_ID));
+        }
+        YaffsItem*& entry = mDense[objectId];
+        mCount += (entry == NULL ? 1 : 0);
+        entry = item;
+    } else {
+        mCount += (mSparse.contains(objectId) ? 0 : 1);
+        mSparse.insert(objectId, item);
+    }
+}
+
+YaffsItem* YaffsObjectTable::value(int objectId) const {
+    if (objectId >= 0 && objectId < mDense.size()) {
+        return mDense.at(objectId);
+    } else if (objectId >= MAX_DENSE_OBJECT_ID || objectId < 0) {
+        return mSparse.value(objectId);
+    }
+    return NULL;
+}
+
+void YaffsObjectTable::clear() {
+    mDense.clear();
+    mSparse.clear();
+    mCount = 0;
+}
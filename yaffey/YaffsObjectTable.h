@@ -0,0 +1,45 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSOBJECTTABLE_H
+#define YAFFSOBJECTTABLE_H
+
+#include <QVector>
+#include <QHash>
+
+class YaffsItem;
+
+//maps object ids to items while an image is read. ids handed out by yaffs are
+//small and dense so they index straight into an array, anything too big for
+//that goes in a hash
+class YaffsObjectTable {
+public:
+    YaffsObjectTable();
+
+    void insert(int objectId, YaffsItem* item);
+    YaffsItem* value(int objectId) const;
+    int size() const { return mCount; }
+    void clear();
+
+private:
+    QVector<YaffsItem*> mDense;
+    QHash<int, YaffsItem*> mSparse;
+    int mCount;
+};
+
+#endif  //YAFFSOBJECTTABLE_H
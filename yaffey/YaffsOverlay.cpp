@@ -0,0 +1,185 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QFileInfo>
+
+#include "YaffsOverlay.h"
+
+static const QString WHITEOUT_PREFIX = ".wh.";
+static const QString WHITEOUT_OPAQUE = ".wh..wh..opq";
+
+YaffsOverlay::YaffsOverlay() {
+    mRoot = NULL;
+    mNumReplaced = 0;
+    mNumWhiteouts = 0;
+}
+
+YaffsOverlay::~YaffsOverlay() {
+    delete mRoot;
+}
+
+//every layer is walked on the thread pool at once, the merge itself looks each path up once
+//in the index so it only takes as long as the layers have entries
+bool YaffsOverlay::compose(const QStringList& layerDirNames) {
+    qDebug() << "YaffsOverlay::compose(), layers: " << layerDirNames;
+
+    delete mRoot;
+    mRoot = NULL;
+    mPathIndex.clear();
+    mNumReplaced = 0;
+    mNumWhiteouts = 0;
+    mLayers.clear();
+    mError.clear();
+
+    foreach (QString layerDirName, layerDirNames) {
+        layerDirName.replace('\\', '/');
+        while (layerDirName.length() > 1 && layerDirName.endsWith('/')) {
+            layerDirName.chop(1);
+        }
+        if (!QFileInfo(layerDirName).isDir()) {
+            mError = layerDirName + " is not a directory";
+            mLayers.clear();
+            return false;
+        }
+        mLayers.append(layerDirName);
+    }
+
+    QList<YaffsImportWalker*> walkers;
+    foreach (const QString& layerDirName, mLayers) {
+        YaffsImportWalker* walker = new YaffsImportWalker(layerDirName);
+        walker->start();
+        walkers.append(walker);
+    }
+
+    mRoot = new YaffsImportEntry();
+    mRoot->isDir = true;
+    foreach (YaffsImportWalker* walker, walkers) {
+        walker->waitForFinished();
+        mergeDirectory(mRoot, walker->getRoot(), QString());
+        delete walker;
+    }
+    compact();
+
+    return true;
+}
+
+//whiteouts are done before anything else in the directory, they only apply to the layers below
+void YaffsOverlay::mergeDirectory(YaffsImportEntry* mergedDir, const YaffsImportEntry* layerDir, const QString& dirPath) {
+    QString prefix = (dirPath.isEmpty() ? dirPath : dirPath + "/");
+
+    foreach (const YaffsImportEntry* layerEntry, layerDir->children) {
+        if (layerEntry->name == WHITEOUT_OPAQUE) {
+            removeChildren(mergedDir, dirPath);
+            mNumWhiteouts++;
+        } else if (layerEntry->name.startsWith(WHITEOUT_PREFIX)) {
+            QString path = prefix + layerEntry->name.mid(WHITEOUT_PREFIX.length());
+            YaffsImportEntry* entry = mPathIndex.value(path);
+            if (entry) {
+                removeEntry(mergedDir, entry, path);
+            }
+            mNumWhiteouts++;
+        }
+    }
+
+    foreach (const YaffsImportEntry* layerEntry, layerDir->children) {
+        if (layerEntry->name.startsWith(WHITEOUT_PREFIX)) {
+            continue;
+        }
+
+        QString path = prefix + layerEntry->name;
+        YaffsImportEntry* entry = mPathIndex.value(path);
+        if (entry && entry->isDir && layerEntry->isDir) {
+            mergeDirectory(entry, layerEntry, path);
+        } else if (entry && !entry->isDir && !layerEntry->isDir) {
+            //a file over a file only changes where the data comes from
+            entry->path = layerEntry->path;
+            entry->hostFile = layerEntry->hostFile;
+            mNumReplaced++;
+        } else {
+            if (entry) {
+                removeEntry(mergedDir, entry, path);
+                mNumReplaced++;
+            }
+            entry = addEntry(mergedDir, layerEntry, path);
+            if (entry->isDir) {
+                mergeDirectory(entry, layerEntry, path);
+            }
+        }
+    }
+}
+
+YaffsImportEntry* YaffsOverlay::addEntry(YaffsImportEntry* mergedDir, const YaffsImportEntry* layerEntry, const QString& path) {
+    YaffsImportEntry* entry = new YaffsImportEntry();
+    entry->name = layerEntry->name;
+    entry->path = layerEntry->path;
+    entry->hostFile = layerEntry->hostFile;
+    entry->isDir = layerEntry->isDir;
+    mergedDir->children.append(entry);
+    mPathIndex.insert(path, entry);
+    return entry;
+}
+
+//taking an entry out of the middle of its directory's list would make big directories with a lot
+//of whiteouts slow, so it's only marked here and compact() takes them all out at the end
+void YaffsOverlay::removeEntry(YaffsImportEntry* mergedDir, YaffsImportEntry* entry, const QString& path) {
+    unindex(entry, path);
+    mRemoved.append(entry);
+    mRemovedSet.insert(entry);
+    mDirsChanged.insert(mergedDir);
+}
+
+void YaffsOverlay::removeChildren(YaffsImportEntry* mergedDir, const QString& dirPath) {
+    QString prefix = (dirPath.isEmpty() ? dirPath : dirPath + "/");
+    foreach (YaffsImportEntry* entry, mergedDir->children) {
+        if (!mRemovedSet.contains(entry)) {
+            removeEntry(mergedDir, entry, prefix + entry->name);
+        }
+    }
+}
+
+void YaffsOverlay::unindex(const YaffsImportEntry* entry, const QString& path) {
+    mPathIndex.remove(path);
+    if (entry->isDir) {
+        foreach (const YaffsImportEntry* child, entry->children) {
+            if (!mRemovedSet.contains(const_cast<YaffsImportEntry*>(child))) {
+                unindex(child, path + "/" + child->name);
+            }
+        }
+    }
+}
+
+//every changed directory lets go of its removed entries before any are deleted, a removed
+//directory deletes whatever is still in it
+void YaffsOverlay::compact() {
+    foreach (YaffsImportEntry* dirEntry, mDirsChanged) {
+        QList<YaffsImportEntry*> children;
+        children.reserve(dirEntry->children.size());
+        foreach (YaffsImportEntry* entry, dirEntry->children) {
+            if (!mRemovedSet.contains(entry)) {
+                children.append(entry);
+            }
+        }
+        dirEntry->children = children;
+    }
+    qDeleteAll(mRemoved);
+
+    mDirsChanged.clear();
+    mRemoved.clear();
+    mRemovedSet.clear();
+}
@@ -0,0 +1,69 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSOVERLAY_H
+#define YAFFSOVERLAY_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QList>
+
+#include "YaffsImportWalker.h"
+
+//puts an ordered list of local directories on top of each other the way overlayfs does. the
+//layers are walked at the same time and merged into one tree, a later layer wins where paths
+//clash and aufs style whiteouts take paths of the layers below away:
+//  .wh.<name>      removes <name> from the directory
+//  .wh..wh..opq    hides everything the layers below have in the directory
+//the merged entries keep the local path of the layer they came from
+class YaffsOverlay {
+public:
+    YaffsOverlay();
+    ~YaffsOverlay();
+
+    bool compose(const QStringList& layerDirNames);
+    const QStringList& getLayers() const { return mLayers; }
+    const YaffsImportEntry* getRoot() const { return mRoot; }
+    int getNumEntries() const { return mPathIndex.size(); }
+    int getNumReplaced() const { return mNumReplaced; }
+    int getNumWhiteouts() const { return mNumWhiteouts; }
+    QString getError() const { return mError; }
+
+private:
+    void mergeDirectory(YaffsImportEntry* mergedDir, const YaffsImportEntry* layerDir, const QString& dirPath);
+    YaffsImportEntry* addEntry(YaffsImportEntry* mergedDir, const YaffsImportEntry* layerEntry, const QString& path);
+    void removeEntry(YaffsImportEntry* mergedDir, YaffsImportEntry* entry, const QString& path);
+    void removeChildren(YaffsImportEntry* mergedDir, const QString& dirPath);
+    void unindex(const YaffsImportEntry* entry, const QString& path);
+    void compact();
+
+private:
+    QStringList mLayers;
+    YaffsImportEntry* mRoot;                            //owned
+    QHash<QString, YaffsImportEntry*> mPathIndex;       //relative path to merged entry, without the root
+    QSet<YaffsImportEntry*> mDirsChanged;               //directories that had entries taken away
+    QList<YaffsImportEntry*> mRemoved;                  //waiting for their directories to let go of them
+    QSet<YaffsImportEntry*> mRemovedSet;
+    int mNumReplaced;
+    int mNumWhiteouts;
+    QString mError;
+};
+
+#endif  //YAFFSOVERLAY_H
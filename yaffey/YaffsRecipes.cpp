@@ -0,0 +1,145 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+#include <string.h>
+
+#include "YaffsRecipes.h"
+#include "YaffsModel.h"
+
+//xml tag names and attributes
+static const char* TAG_MENUITEM = "menuitem";
+static const char* TAG_FILE = "file";
+static const char* TAG_SYMLINK = "symlink";
+static const char* ATTR_NAME = "name";
+static const char* ATTR_ALIAS = "alias";
+static const char* ATTR_DEST = "dest";
+static const char* ATTR_PERMISSIONS = "permissions";
+static const char* ATTR_USER = "user";
+static const char* ATTR_GROUP = "group";
+
+static void countItem(const YaffsItem* item, YaffsRecipeInfo& recipeInfo) {
+    if (item) {
+        recipeInfo.numItemsAdded++;
+    } else {
+        recipeInfo.numItemsFailed++;
+    }
+}
+
+YaffsRecipes::YaffsRecipes() {
+}
+
+bool YaffsRecipes::load(const QString& xmlFilename) {
+    bool result = false;
+    QFile file(xmlFilename);
+    if (file.open(QIODevice::ReadOnly)) {
+        QDomDocument doc(xmlFilename);
+        if (doc.setContent(&file)) {
+            QDomElement docElem = doc.documentElement();
+            if (docElem.hasAttribute(ATTR_NAME)) {
+                mDoc = doc;
+                mMenuName = docElem.attribute(ATTR_NAME);
+                mFilesPath = QFileInfo(xmlFilename).path();
+                result = true;
+            }
+        }
+        file.close();
+    }
+    return result;
+}
+
+QStringList YaffsRecipes::getNames() const {
+    QStringList names;
+    QDomNode node = mDoc.documentElement().firstChild();
+    while (!node.isNull()) {
+        QDomElement element = node.toElement();
+        if (!element.isNull() && element.tagName() == TAG_MENUITEM && element.hasAttribute(ATTR_NAME)) {
+            names.append(element.attribute(ATTR_NAME));
+        }
+        node = node.nextSibling();
+    }
+    return names;
+}
+
+QDomElement YaffsRecipes::findRecipe(const QString& name) const {
+    QDomNode node = mDoc.documentElement().firstChild();
+    while (!node.isNull()) {
+        QDomElement element = node.toElement();
+        if (!element.isNull() && element.tagName() == TAG_MENUITEM && element.attribute(ATTR_NAME) == name) {
+            return element;
+        }
+        node = node.nextSibling();
+    }
+    return QDomElement();
+}
+
+//returns false if there's no recipe with the name, the model is told about everything the recipe
+//added in one go at the end
+bool YaffsRecipes::apply(YaffsModel* yaffsModel, const QString& name, YaffsRecipeInfo& recipeInfo) const {
+    qDebug() << "YaffsRecipes::apply(), name: " << name;
+
+    memset(&recipeInfo, 0, sizeof(YaffsRecipeInfo));
+    QDomElement recipe = findRecipe(name);
+    if (recipe.isNull()) {
+        return false;
+    }
+
+    yaffsModel->beginBatch();
+    QDomNode node = recipe.firstChild();
+    while (!node.isNull()) {
+        QDomElement element = node.toElement();
+        if (!element.isNull()) {
+            QString tag = element.tagName();
+            QString dest = element.attribute(ATTR_DEST);
+            QString permissions = element.attribute(ATTR_PERMISSIONS);
+            QString user = element.attribute(ATTR_USER);
+            QString group = element.attribute(ATTR_GROUP);
+
+            if (dest.length() > 0 && permissions.length() > 0 && user.length() > 0 && group.length() > 0) {
+                uint uid = user.toUInt();
+                uint gid = group.toUInt();
+                uint perms = permissions.toUInt(0, 8);
+
+                if (tag == TAG_FILE) {
+                    QString fileName = element.attribute(ATTR_NAME);
+                    if (fileName.length() > 0) {
+                        countItem(yaffsModel->importFile(mFilesPath + "/" + fileName, dest, uid, gid, perms), recipeInfo);
+                    } else {
+                        recipeInfo.numXmlErrors++;
+                    }
+                } else if (tag == TAG_SYMLINK) {
+                    QString alias = element.attribute(ATTR_ALIAS);
+                    if (alias.length() > 0) {
+                        countItem(yaffsModel->createSymLink(dest, alias, uid, gid, perms), recipeInfo);
+                    } else {
+                        recipeInfo.numXmlErrors++;
+                    }
+                }
+            } else {
+                recipeInfo.numXmlErrors++;
+            }
+        }
+        node = node.nextSibling();
+    }
+    yaffsModel->endBatch();
+
+    return true;
+}
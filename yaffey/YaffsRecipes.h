@@ -0,0 +1,58 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef YAFFSRECIPES_H
+#define YAFFSRECIPES_H
+
+#include <QString>
+#include <QStringList>
+#include <QDomDocument>
+
+class YaffsModel;
+
+struct YaffsRecipeInfo {
+    int numItemsAdded;
+    int numItemsFailed;                 //a file that couldn't be read or a name that was taken
+    int numXmlErrors;
+};
+
+//the recipes in a menu xml file, each menuitem is a list of files and symlinks to add to an image:
+//  <menu name="...">
+//    <menuitem name="...">
+//      <file name="..." dest="..." permissions="755" user="0" group="0"/>
+//      <symlink alias="..." dest="..." permissions="755" user="0" group="0"/>
+//the files are looked for in the directory the xml file is in
+class YaffsRecipes {
+public:
+    YaffsRecipes();
+
+    bool load(const QString& xmlFilename);
+    QString getMenuName() const { return mMenuName; }
+    QStringList getNames() const;
+    bool apply(YaffsModel* yaffsModel, const QString& name, YaffsRecipeInfo& recipeInfo) const;
+
+private:
+    QDomElement findRecipe(const QString& name) const;
+
+private:
+    QDomDocument mDoc;
+    QString mMenuName;
+    QString mFilesPath;
+};
+
+#endif  //YAFFSRECIPES_H
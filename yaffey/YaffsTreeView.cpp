@@ -22,16 +22,35 @@
 #include <QUrl>
 #include <QDir>
 #include <QMimeData>
+#include <QAbstractProxyModel>
 
 #include "YaffsTreeView.h"
 #include "YaffsItem.h"
 #include "YaffsModel.h"
 #include "YaffsManager.h"
+#include "YaffsImportJob.h"
 
 YaffsTreeView::YaffsTreeView(QWidget* parent) : QTreeView(parent) {
     qDebug() << "YaffsTreeView()";
 }
 
+QModelIndex YaffsTreeView::sourceIndex(const QModelIndex& index) const {
+    QAbstractProxyModel* proxyModel = qobject_cast<QAbstractProxyModel*>(model());
+    return (proxyModel ? proxyModel->mapToSource(index) : index);
+}
+
+QModelIndex YaffsTreeView::currentSourceIndex() const {
+    return sourceIndex(selectionModel()->currentIndex());
+}
+
+QModelIndexList YaffsTreeView::selectedSourceRows() const {
+    QModelIndexList sourceRows;
+    foreach (QModelIndex index, selectionModel()->selectedRows()) {
+        sourceRows.append(sourceIndex(index));
+    }
+    return sourceRows;
+}
+
 void YaffsTreeView::selectionChanged(const QItemSelection& selected, const QItemSelection& deselected) {
     QTreeView::selectionChanged(selected, deselected);
     emit selectionChanged();
@@ -49,11 +68,12 @@ void YaffsTreeView::dragEnterEvent(QDragEnterEvent* event) {
 void YaffsTreeView::dragMoveEvent(QDragMoveEvent* event) {
     bool accept = false;
 
-    QModelIndex modelIndex = indexAt(event->pos());
+    QModelIndex modelIndex = sourceIndex(indexAt(event->pos()));
     if (modelIndex.isValid()) {
         YaffsItem* item = static_cast<YaffsItem*>(modelIndex.internalPointer());
         if (item) {
-            if (item->isDir()) {
+            //a directory still being imported is filled in once its walk finishes
+            if (item->isDir() && !YaffsManager::getInstance()->getModel()->isImportPlaceholder(item)) {
                 accept = true;
             }
         }
@@ -73,7 +93,7 @@ void YaffsTreeView::dragLeaveEvent(QDragLeaveEvent* /*event*/) {
 void YaffsTreeView::dropEvent(QDropEvent* event) {
     qDebug() << "dropEvent";
 
-    QModelIndex modelIndex = indexAt(event->pos());
+    QModelIndex modelIndex = sourceIndex(indexAt(event->pos()));
     if (modelIndex.isValid()) {
         YaffsItem* parentItem = static_cast<YaffsItem*>(modelIndex.internalPointer());
         if (parentItem && parentItem->isDir()) {
@@ -81,20 +101,23 @@ void YaffsTreeView::dropEvent(QDropEvent* event) {
 
             const QMimeData* mimeData = event->mimeData();
             if (mimeData && mimeData->hasUrls()) {
-                YaffsModel* yaffsManagerModel = YaffsManager::getInstance()->getModel();
-                YaffsModel* yaffsModel = static_cast<YaffsModel*>(model());
+                YaffsModel* yaffsModel = YaffsManager::getInstance()->getModel();
 
                 //sanity check to make sure the view is showing the model that the manager has
-                if (yaffsManagerModel == yaffsModel) {
+                if (modelIndex.model() == yaffsModel && !yaffsModel->isImportPlaceholder(parentItem)) {
+                    //directories are walked in the background so the drop returns straight away
                     QList<QUrl> urls = mimeData->urls();
+                    yaffsModel->beginBatch();
                     foreach (QUrl url, urls) {
                         QFileInfo fileInfo(url.toLocalFile());
                         if (fileInfo.isDir()) {
-                            yaffsModel->importDirectory(parentItem, fileInfo.absoluteFilePath());
+                            YaffsImportJob* importJob = new YaffsImportJob(yaffsModel, parentItem, fileInfo.absoluteFilePath(), this);
+                            importJob->start();
                         } else if (fileInfo.isFile()) {
                             yaffsModel->importFile(parentItem, fileInfo.absoluteFilePath());
                         }
                     }
+                    yaffsModel->endBatch();
 
                     event->accept();
                 }
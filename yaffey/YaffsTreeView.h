@@ -28,6 +28,11 @@ class YaffsTreeView : public QTreeView {
 public:
     explicit YaffsTreeView(QWidget* parent = 0);
 
+    //the view may be looking at the model through a proxy, these give indexes into the model itself
+    QModelIndex sourceIndex(const QModelIndex& index) const;
+    QModelIndex currentSourceIndex() const;
+    QModelIndexList selectedSourceRows() const;
+
 Q_SIGNALS:
     void selectionChanged();
 
@@ -0,0 +1,39 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QStringList>
+#include <QTime>
+#include <QCoreApplication>
+
+#include "YaffsCli.h"
+
+//no QCoreApplication is made, nothing the commands do needs an event loop and leaving it out
+//keeps the startup down to reading the image
+int main(int argc, char* argv[]) {
+    QStringList args;
+    for (int i = 1; i < argc; ++i) {
+        args.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    //the pid goes into the seed as lots of these can be saving images next to each other
+    int seed = QTime::currentTime().msec() ^ QCoreApplication::applicationPid();
+    qsrand((uint)seed);
+
+    YaffsCli cli(args);
+    return cli.run();
+}
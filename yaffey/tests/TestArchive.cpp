@@ -0,0 +1,351 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include <string.h>
+#include <zlib.h>
+
+#include "TestArchive.h"
+#include "TestFiles.h"
+#include "YaffsArchive.h"
+
+static const int TAR_BLOCK_SIZE = 512;
+static const uint MTIME = 1234567890;
+static const QByteArray HOSTS = "127.0.0.1 localhost\n";
+
+static QByteArray padded(const QByteArray& data, int alignment) {
+    QByteArray result = data;
+    if (result.size() % alignment != 0) {
+        result.append(QByteArray(alignment - (result.size() % alignment), '\0'));
+    }
+    return result;
+}
+
+static QByteArray tarEntry(const QByteArray& name, char typeFlag, uint mode, const QByteArray& data = QByteArray(), const QByteArray& linkName = QByteArray()) {
+    QByteArray block(TAR_BLOCK_SIZE, '\0');
+    char* header = block.data();
+    memcpy(header, name.constData(), qMin(name.size(), 100));
+    qsnprintf(header + 100, 8, "%07o", mode);
+    qsnprintf(header + 108, 8, "%07o", 1000);
+    qsnprintf(header + 116, 8, "%07o", 1001);
+    qsnprintf(header + 124, 12, "%011o", data.size());
+    qsnprintf(header + 136, 12, "%011o", MTIME);
+    header[156] = typeFlag;
+    memcpy(header + 157, linkName.constData(), qMin(linkName.size(), 100));
+    memcpy(header + 257, "ustar\0" "00", 8);
+
+    //the checksum is taken with its own field as spaces
+    memset(header + 148, ' ', 8);
+    uint sum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; ++i) {
+        sum += static_cast<uchar>(header[i]);
+    }
+    qsnprintf(header + 148, 8, "%06o", sum);
+    return block + padded(data, TAR_BLOCK_SIZE);
+}
+
+static QByteArray tarEnd() {
+    return QByteArray(TAR_BLOCK_SIZE * 2, '\0');
+}
+
+//the length at the start counts the whole record, itself included
+static QByteArray paxRecord(const QByteArray& key, const QByteArray& value) {
+    int length = key.size() + value.size() + 3;
+    int total = length + QByteArray::number(length).size();
+    if (QByteArray::number(total).size() != QByteArray::number(length).size()) {
+        total++;
+    }
+    return QByteArray::number(total) + " " + key + "=" + value + "\n";
+}
+
+static QByteArray cpioEntry(const QByteArray& name, uint mode, uint inode, const QByteArray& data = QByteArray(), uint numLinks = 1) {
+    uint fields[13] = { inode, mode, 1000, 1001, numLinks, MTIME, static_cast<uint>(data.size()), 0, 0, 0, 0, static_cast<uint>(name.size() + 1), 0 };
+    QByteArray entry = "070701";
+    for (int i = 0; i < 13; ++i) {
+        char field[9];
+        qsnprintf(field, sizeof(field), "%08X", fields[i]);
+        entry.append(field, 8);
+    }
+    entry.append(name);
+    entry.append('\0');
+    return padded(entry, 4) + padded(data, 4);
+}
+
+//an entry with one of its header fields changed after the name and data were written
+static QByteArray withCpioField(const QByteArray& entry, int field, uint value) {
+    char text[9];
+    qsnprintf(text, sizeof(text), "%08X", value);
+    QByteArray result = entry;
+    result.replace(6 + (field * 8), 8, text);
+    return result;
+}
+
+static QByteArray cpioEnd() {
+    return padded(cpioEntry("TRAILER!!!", 0, 0), 512);
+}
+
+static QByteArray compress(const QByteArray& data) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    QByteArray result;
+    //15 window bits plus 16 writes a gzip header
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+        result.resize(static_cast<int>(deflateBound(&stream, data.size())) + 32);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+        stream.avail_in = data.size();
+        stream.next_out = reinterpret_cast<Bytef*>(result.data());
+        stream.avail_out = result.size();
+        int status = deflate(&stream, Z_FINISH);
+        result.resize(status == Z_STREAM_END ? static_cast<int>(stream.total_out) : 0);
+        deflateEnd(&stream);
+    }
+    return result;
+}
+
+static const YaffsArchiveEntry* findEntry(const YaffsArchive& archive, const QString& path) {
+    foreach (const YaffsArchiveEntry& entry, archive.getEntries()) {
+        if (entry.path == path) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+static QByteArray readData(YaffsArchiveReader& reader, const YaffsArchiveEntry* entry) {
+    const char* data = reader.read(entry->offset, entry->size);
+    return (data ? QByteArray(data, static_cast<int>(entry->size)) : QByteArray("missing"));
+}
+
+//a bit of everything, with a device and a path out of the archive that are both skipped
+void TestArchive::tar() {
+    QByteArray big(100000, '\0');
+    for (int i = 0; i < big.size(); ++i) {
+        big[i] = static_cast<char>(i * 7);
+    }
+
+    TestFiles files;
+    QVERIFY(files.write("a.tar", tarEntry("./", '5', 0755) +
+                                 tarEntry("./etc/", '5', 0755) +
+                                 tarEntry("./etc/hosts", '0', 0644, HOSTS) +
+                                 tarEntry("etc/link", '2', 0777, QByteArray(), "hosts") +
+                                 tarEntry("etc/hosts2", '1', 0644, QByteArray(), "./etc/hosts") +
+                                 tarEntry("dev/null", '3', 0666) +
+                                 tarEntry("../escaped", '0', 0644, "x") +
+                                 tarEntry("bin/big", '0', 04755, big) +
+                                 tarEntry("empty", '0', 0600) +
+                                 tarEnd()));
+
+    YaffsArchive archive;
+    QVERIFY2(archive.open(files.path("a.tar")), qPrintable(archive.getError()));
+    QCOMPARE(archive.getFormat(), YaffsArchive::FORMAT_TAR);
+    QVERIFY(!archive.isCompressed());
+    QVERIFY(!archive.isBuffered());
+    QCOMPARE(archive.getEntries().size(), 6);
+    QCOMPARE(archive.getNumSkipped(), 2);
+
+    const YaffsArchiveEntry* dir = findEntry(archive, "etc");
+    QVERIFY(dir != NULL);
+    QCOMPARE(dir->type, YAFFS_OBJECT_TYPE_DIRECTORY);
+    QCOMPARE(dir->mode, 0755u);
+
+    const YaffsArchiveEntry* hosts = findEntry(archive, "etc/hosts");
+    QVERIFY(hosts != NULL);
+    QCOMPARE(hosts->type, YAFFS_OBJECT_TYPE_FILE);
+    QCOMPARE(hosts->mode, 0644u);
+    QCOMPARE(hosts->uid, 1000u);
+    QCOMPARE(hosts->gid, 1001u);
+    QCOMPARE(hosts->mtime, MTIME);
+    QCOMPARE(hosts->size, static_cast<qint64>(HOSTS.size()));
+
+    const YaffsArchiveEntry* link = findEntry(archive, "etc/link");
+    QVERIFY(link != NULL);
+    QCOMPARE(link->type, YAFFS_OBJECT_TYPE_SYMLINK);
+    QCOMPARE(link->alias, QString("hosts"));
+
+    //a hard link is a copy of its target
+    const YaffsArchiveEntry* hardLink = findEntry(archive, "etc/hosts2");
+    QVERIFY(hardLink != NULL);
+    QCOMPARE(hardLink->offset, hosts->offset);
+    QCOMPARE(hardLink->size, hosts->size);
+
+    const YaffsArchiveEntry* bigFile = findEntry(archive, "bin/big");
+    QVERIFY(bigFile != NULL);
+    QCOMPARE(bigFile->mode, 04755u);
+
+    const YaffsArchiveEntry* empty = findEntry(archive, "empty");
+    QVERIFY(empty != NULL);
+    QCOMPARE(empty->size, 0LL);
+
+    YaffsArchiveReader reader(files.path("a.tar"));
+    QCOMPARE(readData(reader, bigFile), big);
+    QCOMPARE(readData(reader, hosts), HOSTS);
+    QCOMPARE(readData(reader, empty), QByteArray());
+}
+
+//pax headers override the ustar fields of the entry after them, gnu long names are a header of their own
+void TestArchive::pax() {
+    QByteArray longName = "usr/share/" + QByteArray(150, 'n') + "/file";
+    QByteArray paxData = paxRecord("path", longName) + paxRecord("uid", "123456789") + paxRecord("mtime", "1700000000.25");
+    QByteArray gnuName = "opt/" + QByteArray(120, 'g');
+
+    TestFiles files;
+    QVERIFY(files.write("a.tar", tarEntry("././@PaxHeader", 'x', 0644, paxData) +
+                                 tarEntry("truncated", '0', 0644, HOSTS) +
+                                 tarEntry("././@LongLink", 'L', 0644, gnuName + '\0') +
+                                 tarEntry(gnuName.left(100), '0', 0640, "gnu") +
+                                 tarEntry("short", '0', 0644, "ustar") +
+                                 tarEnd()));
+
+    YaffsArchive archive;
+    QVERIFY2(archive.open(files.path("a.tar")), qPrintable(archive.getError()));
+    QCOMPARE(archive.getEntries().size(), 3);
+
+    const YaffsArchiveEntry* paxEntry = findEntry(archive, QString::fromUtf8(longName));
+    QVERIFY(paxEntry != NULL);
+    QCOMPARE(paxEntry->uid, 123456789u);
+    QCOMPARE(paxEntry->gid, 1001u);
+    QCOMPARE(paxEntry->mtime, 1700000000u);
+
+    const YaffsArchiveEntry* gnuEntry = findEntry(archive, QString::fromUtf8(gnuName));
+    QVERIFY(gnuEntry != NULL);
+    QCOMPARE(gnuEntry->mode, 0640u);
+
+    //the extensions only apply to the one entry
+    const YaffsArchiveEntry* shortEntry = findEntry(archive, "short");
+    QVERIFY(shortEntry != NULL);
+    QCOMPARE(shortEntry->uid, 1000u);
+
+    YaffsArchiveReader reader(files.path("a.tar"));
+    QCOMPARE(readData(reader, paxEntry), HOSTS);
+    QCOMPARE(readData(reader, gnuEntry), QByteArray("gnu"));
+    QCOMPARE(readData(reader, shortEntry), QByteArray("ustar"));
+}
+
+//newc keeps the data of hard links with the last one, the others get it from there
+void TestArchive::newc() {
+    TestFiles files;
+    QVERIFY(files.write("a.cpio", cpioEntry(".", 0040755, 1) +
+                                  cpioEntry("etc", 0040755, 2) +
+                                  cpioEntry("etc/hosts", 0100644, 3, HOSTS) +
+                                  cpioEntry("etc/link", 0120777, 4, "hosts") +
+                                  cpioEntry("bin/a", 0100755, 5, QByteArray(), 2) +
+                                  cpioEntry("bin/b", 0100755, 5, "linked", 2) +
+                                  cpioEntry("dev/null", 0020666, 6) +
+                                  cpioEnd()));
+
+    YaffsArchive archive;
+    QVERIFY2(archive.open(files.path("a.cpio")), qPrintable(archive.getError()));
+    QCOMPARE(archive.getFormat(), YaffsArchive::FORMAT_CPIO);
+    QCOMPARE(archive.getEntries().size(), 5);
+    QCOMPARE(archive.getNumSkipped(), 1);
+
+    const YaffsArchiveEntry* hosts = findEntry(archive, "etc/hosts");
+    QVERIFY(hosts != NULL);
+    QCOMPARE(hosts->type, YAFFS_OBJECT_TYPE_FILE);
+    QCOMPARE(hosts->mode, 0644u);
+    QCOMPARE(hosts->uid, 1000u);
+    QCOMPARE(hosts->mtime, MTIME);
+
+    const YaffsArchiveEntry* link = findEntry(archive, "etc/link");
+    QVERIFY(link != NULL);
+    QCOMPARE(link->type, YAFFS_OBJECT_TYPE_SYMLINK);
+    QCOMPARE(link->alias, QString("hosts"));
+
+    const YaffsArchiveEntry* first = findEntry(archive, "bin/a");
+    const YaffsArchiveEntry* last = findEntry(archive, "bin/b");
+    QVERIFY(first != NULL && last != NULL);
+
+    YaffsArchiveReader reader(files.path("a.cpio"));
+    QCOMPARE(readData(reader, hosts), HOSTS);
+    QCOMPARE(readData(reader, first), QByteArray("linked"));
+    QCOMPARE(readData(reader, last), QByteArray("linked"));
+}
+
+//offsets are into the inflated data, which is inflated again going backwards. two members is
+//what concatenated gzip files look like
+void TestArchive::gzip() {
+    QByteArray big(300000, '\0');
+    for (int i = 0; i < big.size(); ++i) {
+        big[i] = static_cast<char>((i * 31) ^ (i >> 8));
+    }
+    QByteArray tar = tarEntry("big", '0', 0644, big) + tarEntry("hosts", '0', 0644, HOSTS) + tarEnd();
+    int half = tar.size() / 2;
+
+    TestFiles files;
+    QVERIFY(files.write("a.tar.gz", compress(tar.left(half)) + compress(tar.mid(half))));
+    QVERIFY(files.write("a.cpio.gz", compress(cpioEntry("hosts", 0100644, 1, HOSTS) + cpioEnd())));
+
+    YaffsArchive archive;
+    QVERIFY2(archive.open(files.path("a.tar.gz")), qPrintable(archive.getError()));
+    QCOMPARE(archive.getFormat(), YaffsArchive::FORMAT_TAR);
+    QVERIFY(archive.isCompressed());
+    QVERIFY(!archive.isBuffered());
+    QCOMPARE(archive.getEntries().size(), 2);
+
+    const YaffsArchiveEntry* bigFile = findEntry(archive, "big");
+    const YaffsArchiveEntry* hosts = findEntry(archive, "hosts");
+    QVERIFY(bigFile != NULL && hosts != NULL);
+
+    YaffsArchiveReader reader(files.path("a.tar.gz"));
+    QCOMPARE(readData(reader, hosts), HOSTS);
+    QCOMPARE(readData(reader, bigFile), big);
+    QCOMPARE(readData(reader, hosts), HOSTS);
+
+    YaffsArchive cpioArchive;
+    QVERIFY2(cpioArchive.open(files.path("a.cpio.gz")), qPrintable(cpioArchive.getError()));
+    QCOMPARE(cpioArchive.getFormat(), YaffsArchive::FORMAT_CPIO);
+    QVERIFY(cpioArchive.isCompressed());
+    QCOMPARE(cpioArchive.getEntries().size(), 1);
+}
+
+void TestArchive::notAnArchive() {
+    TestFiles files;
+    QVERIFY(files.write("text", QByteArray(2048, 'x')));
+    QVERIFY(files.write("a.tar.zst", QByteArray("\x28\xb5\x2f\xfd", 4) + QByteArray(2048, '\0')));
+    QVERIFY(files.write("truncated.tar", tarEntry("big", '0', 0644, QByteArray(5000, 'b')).left(2048)));
+
+    YaffsArchive archive;
+    QVERIFY(!archive.open(files.path("text")));
+    QVERIFY(!archive.open(files.path("a.tar.zst")));
+    QVERIFY(archive.getError().contains("gzip"));
+    QVERIFY(!archive.open(files.path("truncated.tar")));
+    QVERIFY(!archive.open(files.path("missing")));
+}
+
+//sizes that would have the name or a symlink's target read into a huge buffer
+void TestArchive::badCpioSizes() {
+    TestFiles files;
+    QVERIFY(files.write("name.cpio", withCpioField(cpioEntry("hosts", 0100644, 1, HOSTS), 11, 0xFFFFFFFF) + cpioEnd()));
+    QVERIFY(files.write("longname.cpio", cpioEntry(QByteArray(5000, 'n'), 0100644, 1, HOSTS) + cpioEnd()));
+    QVERIFY(files.write("link.cpio", withCpioField(cpioEntry("link", 0120777, 1, "hosts"), 6, 0x7FFFFFFF) + cpioEnd()));
+
+    YaffsArchive archive;
+    QVERIFY(!archive.open(files.path("name.cpio")));
+    QVERIFY2(archive.getError().startsWith("Bad cpio header"), qPrintable(archive.getError()));
+    QVERIFY(!archive.open(files.path("longname.cpio")));
+    QVERIFY2(archive.getError().startsWith("Bad cpio header"), qPrintable(archive.getError()));
+    QVERIFY(!archive.open(files.path("link.cpio")));
+    QVERIFY2(archive.getError().startsWith("Bad cpio header"), qPrintable(archive.getError()));
+
+    //a long target that's still a sensible size is fine
+    QVERIFY(files.write("longlink.cpio", cpioEntry("link", 0120777, 1, QByteArray(4000, 't')) + cpioEnd()));
+    QVERIFY2(archive.open(files.path("longlink.cpio")), qPrintable(archive.getError()));
+    QCOMPARE(archive.getEntries().size(), 1);
+    QCOMPARE(archive.getEntries().at(0).alias.length(), 4000);
+}
@@ -0,0 +1,157 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestCheckpoint.h"
+#include "YaffsCheckpoint.h"
+
+static const int PAGES_PER_BLOCK = 64;
+static const int NUM_BLOCKS = 8;
+static const int BIG_FILE_CHUNKS = 40;      //more than one level 0 tnode
+
+//a root directory, lost+found, a small file, a file spread over several tnodes and a symlink
+void TestCheckpoint::fill(YaffsCheckpoint& checkpoint) {
+    YaffsCheckpointBlock block;
+    block.state = YAFFS_BLOCK_STATE_FULL;
+    block.pagesInUse = PAGES_PER_BLOCK;
+    block.seqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER;
+    block.hasSummary = true;
+    checkpoint.setBlock(0, block);
+
+    block.state = YAFFS_BLOCK_STATE_ALLOCATING;
+    block.pagesInUse = 10;
+    block.seqNumber = YAFFS_LOWEST_SEQUENCE_NUMBER + 1;
+    block.hasSummary = false;
+    checkpoint.setBlock(1, block);
+    checkpoint.setAllocation(1, 10, YAFFS_LOWEST_SEQUENCE_NUMBER + 2);
+
+    QVector<YaffsCheckpointObject> objects;
+    QVector<int> dataPages;
+    YaffsCheckpointObject object = { YAFFS_OBJECTID_ROOT, YAFFS_OBJECTID_ROOT, YAFFS_OBJECT_TYPE_DIRECTORY, 0, false, 0, 0, 0 };
+    objects.append(object);
+
+    YaffsCheckpointObject lostAndFound = { YAFFS_OBJECTID_LOSTNFOUND, YAFFS_OBJECTID_ROOT, YAFFS_OBJECT_TYPE_DIRECTORY, -1, true, 0, 0, 0 };
+    objects.append(lostAndFound);
+
+    YaffsCheckpointObject smallFile = { 257, YAFFS_OBJECTID_ROOT, YAFFS_OBJECT_TYPE_FILE, 1, false, 5000, dataPages.size(), 3 };
+    dataPages << 2 << 3 << 4;
+    objects.append(smallFile);
+
+    YaffsCheckpointObject bigFile = { 258, YAFFS_OBJECTID_ROOT, YAFFS_OBJECT_TYPE_FILE, 5, false, BIG_FILE_CHUNKS * CHUNK_SIZE, dataPages.size(), BIG_FILE_CHUNKS };
+    for (int i = 0; i < BIG_FILE_CHUNKS; ++i) {
+        dataPages.append(PAGES_PER_BLOCK * 2 + i * 3);
+    }
+    objects.append(bigFile);
+
+    YaffsCheckpointObject symLink = { 259, 257, YAFFS_OBJECT_TYPE_SYMLINK, 6, false, 0, 0, 0 };
+    objects.append(symLink);
+
+    checkpoint.setObjects(objects, dataPages);
+}
+
+void TestCheckpoint::roundTrip() {
+    YaffsCheckpoint checkpoint(PAGES_PER_BLOCK, NUM_BLOCKS);
+    fill(checkpoint);
+    QByteArray data = checkpoint.build();
+
+    YaffsCheckpoint parsed(PAGES_PER_BLOCK, NUM_BLOCKS);
+    QVERIFY(parsed.parse(data));
+    QCOMPARE(parsed.getSeqNumber(), checkpoint.getSeqNumber());
+
+    for (int i = 0; i < NUM_BLOCKS; ++i) {
+        const YaffsCheckpointBlock& expected = checkpoint.getBlock(i);
+        const YaffsCheckpointBlock& block = parsed.getBlock(i);
+        QCOMPARE(block.state, expected.state);
+        QCOMPARE(block.pagesInUse, expected.pagesInUse);
+        QCOMPARE(block.seqNumber, expected.seqNumber);
+        QCOMPARE(block.hasSummary, expected.hasSummary);
+    }
+
+    //the data pages are only there for files
+    const QVector<YaffsCheckpointObject>& objects = checkpoint.getObjects();
+    QCOMPARE(parsed.getObjects().size(), objects.size());
+    for (int i = 0; i < objects.size(); ++i) {
+        const YaffsCheckpointObject& expected = objects.at(i);
+        const YaffsCheckpointObject& object = parsed.getObjects().at(i);
+        QCOMPARE(object.objectId, expected.objectId);
+        QCOMPARE(object.parentId, expected.parentId);
+        QCOMPARE(object.type, expected.type);
+        QCOMPARE(object.headerPage, expected.headerPage);
+        QCOMPARE(object.fake, expected.fake);
+        if (expected.type == YAFFS_OBJECT_TYPE_FILE) {
+            QCOMPARE(object.fileSize, expected.fileSize);
+            QCOMPARE(object.numDataChunks, expected.numDataChunks);
+            for (int chunk = 0; chunk < expected.numDataChunks; ++chunk) {
+                QCOMPARE(parsed.getDataPages().at(object.firstDataChunk + chunk), checkpoint.getDataPages().at(expected.firstDataChunk + chunk));
+            }
+        }
+    }
+
+    //building it again gives the same bytes
+    QCOMPARE(parsed.build(), data);
+}
+
+void TestCheckpoint::chunkMap() {
+    YaffsCheckpoint checkpoint(PAGES_PER_BLOCK, NUM_BLOCKS);
+    fill(checkpoint);
+    YaffsCheckpoint parsed(PAGES_PER_BLOCK, NUM_BLOCKS);
+    QVERIFY(parsed.parse(checkpoint.build()));
+
+    YaffsChunkMap chunkMap(parsed);
+    QVERIFY(!chunkMap.isEmpty());
+
+    YaffsCheckpointObject file;
+    QVERIFY(chunkMap.findFile(5 * PAGE_SIZE, file));
+    QCOMPARE(file.objectId, 258u);
+    QCOMPARE(chunkMap.getDataPage(file, 0), PAGES_PER_BLOCK * 2);
+    QCOMPARE(chunkMap.getDataPage(file, BIG_FILE_CHUNKS - 1), PAGES_PER_BLOCK * 2 + (BIG_FILE_CHUNKS - 1) * 3);
+    QCOMPARE(chunkMap.getDataPage(file, BIG_FILE_CHUNKS), -1);
+
+    QVERIFY(chunkMap.findFile(1 * PAGE_SIZE, file));
+    QCOMPARE(file.fileSize, 5000u);
+    QCOMPARE(chunkMap.getDataPage(file, 2), 4);
+
+    //only files are mapped
+    QVERIFY(!chunkMap.findFile(0, file));
+    QVERIFY(!chunkMap.findFile(6 * PAGE_SIZE, file));
+}
+
+void TestCheckpoint::badChecksum() {
+    YaffsCheckpoint checkpoint(PAGES_PER_BLOCK, NUM_BLOCKS);
+    fill(checkpoint);
+    QByteArray data = checkpoint.build();
+
+    //a block's sequence number, which nothing but the checksum covers
+    int pos = 16 + 36 + 4;
+    data[pos] = static_cast<char>(data.at(pos) ^ 0x01);
+
+    YaffsCheckpoint parsed(PAGES_PER_BLOCK, NUM_BLOCKS);
+    QVERIFY(!parsed.parse(data));
+}
+
+void TestCheckpoint::truncated() {
+    YaffsCheckpoint checkpoint(PAGES_PER_BLOCK, NUM_BLOCKS);
+    fill(checkpoint);
+    QByteArray data = checkpoint.build();
+
+    YaffsCheckpoint parsed(PAGES_PER_BLOCK, NUM_BLOCKS);
+    QVERIFY(!parsed.parse(data.left(data.size() - 4)));
+    QVERIFY(!parsed.parse(data.left(data.size() / 2)));
+    QVERIFY(!parsed.parse(QByteArray()));
+}
@@ -0,0 +1,117 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestContentSearch.h"
+
+//the contents of a file of size bytes with the needle at each of the offsets
+static QByteArray contents(int size, const QByteArray& needle, const QList<int>& offsets) {
+    QByteArray data(size, 'x');
+    foreach (int offset, offsets) {
+        data.replace(offset, needle.size(), needle);
+    }
+    return data;
+}
+
+//the files are written to an image and searched in the image read back from it
+void TestContentSearch::initTestCase() {
+    QVERIFY(mFiles.write("big", contents(3 * CHUNK_SIZE + 100, "NEEDLE", QList<int>() << CHUNK_SIZE - 3 << 2 * CHUNK_SIZE << 3 * CHUNK_SIZE + 94)));
+    QVERIFY(mFiles.write("small", "a NEEDLE b"));
+    QVERIFY(mFiles.write("lower", "a needle b"));
+    QVERIFY(mFiles.write("regex", contents(5 * CHUNK_SIZE, "id=12345;", QList<int>() << CHUNK_SIZE - 4 << 4 * CHUNK_SIZE - 2)));
+    QVERIFY(mFiles.makeDir("dir"));
+    QVERIFY(mFiles.write("dir/nested", "NEEDLENEEDLE"));
+
+    YaffsModel model;
+    model.newImage(mFiles.path("search.img"));
+    YaffsItem* root = model.itemAtPath("/");
+    QVERIFY(model.importFile(root, mFiles.path("big")) != NULL);
+    QVERIFY(model.importFile(root, mFiles.path("small")) != NULL);
+    QVERIFY(model.importFile(root, mFiles.path("lower")) != NULL);
+    QVERIFY(model.importFile(root, mFiles.path("regex")) != NULL);
+    model.importDirectory(root, mFiles.path("dir"));
+
+    YaffsSaveInfo saveInfo;
+    QVERIFY(model.saveAs(mFiles.path("saved.img"), saveInfo));
+    QCOMPARE(saveInfo.numFilesSaved, 5);
+    mModel.openImage(mFiles.path("saved.img"));
+    QVERIFY(mModel.isImageOpen());
+}
+
+void TestContentSearch::results() {
+    QList<YaffsContentMatch> matches = mModel.findContent("NEEDLE", false);
+    QCOMPARE(matches.size(), 3);
+
+    const YaffsContentMatch* small = findMatch(matches, "small");
+    QVERIFY(small != NULL);
+    QCOMPARE(small->numMatches, 1);
+    QCOMPARE(small->offsets, QList<qint64>() << 2);
+
+    //matches don't overlap, the search is case sensitive and goes into directories
+    const YaffsContentMatch* nested = findMatch(matches, "nested");
+    QVERIFY(nested != NULL);
+    QCOMPARE(nested->item->getFullPath(), QString("/dir/nested"));
+    QCOMPARE(nested->offsets, QList<qint64>() << 0 << 6);
+    QVERIFY(findMatch(matches, "lower") == NULL);
+
+    QVERIFY(mModel.findContent("not in any file", false).isEmpty());
+}
+
+//a match can straddle two chunks, start one or end the file
+void TestContentSearch::chunkBoundaries() {
+    QList<YaffsContentMatch> matches = mModel.findContent("NEEDLE", false);
+    const YaffsContentMatch* big = findMatch(matches, "big");
+    QVERIFY(big != NULL);
+    QCOMPARE(big->numMatches, 3);
+    QCOMPARE(big->offsets, QList<qint64>() << CHUNK_SIZE - 3 << 2 * CHUNK_SIZE << 3 * CHUNK_SIZE + 94);
+
+    //two byte patterns, one of them split across chunks
+    matches = mModel.findContent("xN", false);
+    big = findMatch(matches, "big");
+    QVERIFY(big != NULL);
+    QCOMPARE(big->offsets, QList<qint64>() << CHUNK_SIZE - 4 << 2 * CHUNK_SIZE - 1 << 3 * CHUNK_SIZE + 93);
+    matches = mModel.findContent("Ex", false);
+    big = findMatch(matches, "big");
+    QVERIFY(big != NULL);
+    QCOMPARE(big->offsets, QList<qint64>() << CHUNK_SIZE + 2 << 2 * CHUNK_SIZE + 5);
+}
+
+//regex matches that straddle a chunk or come after the window the first chunks were searched in
+void TestContentSearch::regex() {
+    QList<YaffsContentMatch> matches = mModel.findContent("id=[0-9]+;", true);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches.at(0).item->getName(), QString("regex"));
+    QCOMPARE(matches.at(0).offsets, QList<qint64>() << CHUNK_SIZE - 4 << 4 * CHUNK_SIZE - 2);
+
+    matches = mModel.findContent("N[E]+DLE$", true);
+    QCOMPARE(matches.size(), 2);
+    const YaffsContentMatch* big = findMatch(matches, "big");
+    QVERIFY(big != NULL);
+    QCOMPARE(big->offsets, QList<qint64>() << 3 * CHUNK_SIZE + 94);
+    QVERIFY(findMatch(matches, "nested") != NULL);
+}
+
+const YaffsContentMatch* TestContentSearch::findMatch(const QList<YaffsContentMatch>& matches, const QString& name) {
+    for (int i = 0; i < matches.size(); ++i) {
+        if (matches.at(i).item->getName() == name) {
+            return &matches.at(i);
+        }
+    }
+    return NULL;
+}
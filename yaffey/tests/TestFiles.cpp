@@ -0,0 +1,62 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "TestFiles.h"
+
+TestFiles::TestFiles() {
+    static int count = 0;
+    mDirName = QDir::tempPath() + "/yaffey-tests-" + QString::number(QCoreApplication::applicationPid()) + "-" + QString::number(count++);
+    QDir().mkpath(mDirName);
+}
+
+TestFiles::~TestFiles() {
+    removeDir(mDirName);
+}
+
+QString TestFiles::path(const QString& relativePath) const {
+    return (relativePath.isEmpty() ? mDirName : mDirName + "/" + relativePath);
+}
+
+bool TestFiles::makeDir(const QString& relativePath) const {
+    return QDir().mkpath(path(relativePath));
+}
+
+bool TestFiles::write(const QString& relativePath, const QByteArray& data) const {
+    QString filename = path(relativePath);
+    QDir().mkpath(QFileInfo(filename).path());
+    QFile file(filename);
+    return (file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size());
+}
+
+//links are removed rather than followed
+void TestFiles::removeDir(const QString& dirName) {
+    QDir dir(dirName);
+    foreach (const QFileInfo& info, dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System)) {
+        if (info.isDir() && !info.isSymLink()) {
+            removeDir(info.filePath());
+        } else {
+            dir.remove(info.fileName());
+        }
+    }
+    QDir().rmdir(dirName);
+}
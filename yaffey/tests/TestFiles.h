@@ -0,0 +1,45 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef TESTFILES_H
+#define TESTFILES_H
+
+#include <QString>
+#include <QByteArray>
+
+//a scratch directory in the system temp directory, removed along with everything in it when it goes
+class TestFiles {
+public:
+    TestFiles();
+    ~TestFiles();
+
+    QString path(const QString& relativePath = QString()) const;
+    bool makeDir(const QString& relativePath) const;
+    bool write(const QString& relativePath, const QByteArray& data) const;
+
+private:
+    TestFiles(const TestFiles&);
+    TestFiles& operator=(const TestFiles&);
+
+    static void removeDir(const QString& dirName);
+
+private:
+    QString mDirName;
+};
+
+#endif  //TESTFILES_H
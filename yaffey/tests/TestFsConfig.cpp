@@ -0,0 +1,112 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestFsConfig.h"
+#include "TestFiles.h"
+#include "YaffsFsConfig.h"
+#include "YaffsArena.h"
+#include "YaffsItem.h"
+
+static const QByteArray FS_CONFIG =
+    "# comment\n"
+    "\n"
+    "system 0 0 0755\n"
+    "system/bin/* root shell 0755\n"
+    "system/bin/sh 0 2000 0750\n"
+    "system/* 1000 1000 0644\n"
+    "system/xbin/su 0 0 06755 capabilities=0\n"
+    "system/etc 0 0 rw-r--r--\n"
+    "too few fields\n";
+
+//the owner and permissions the entry for the path gave a directory, whose type bits have to stay
+static QString applied(const YaffsFsConfig& fsConfig, const QString& path) {
+    YaffsArena arena;
+    YaffsItem* root = YaffsItem::createRoot(&arena);
+    YaffsItem* item = YaffsItem::createDirectory(root, "item");
+    uint typeBits = item->getPermissions() & ~07777;
+    if (!fsConfig.apply(item, path)) {
+        return "none";
+    }
+    if ((item->getPermissions() & ~07777) != typeBits) {
+        return "type changed";
+    }
+    return QString("%1 %2 %3").arg(item->getUserId()).arg(item->getGroupId()).arg(item->getPermissions() & 07777, 0, 8);
+}
+
+void TestFsConfig::load() {
+    TestFiles files;
+    QVERIFY(files.write("fs_config", FS_CONFIG));
+
+    YaffsFsConfig fsConfig;
+    QVERIFY(fsConfig.load(files.path("fs_config"), "/system/"));
+    QCOMPARE(fsConfig.getNumEntries(), 5);
+    QCOMPARE(fsConfig.getNumErrors(), 2);
+    QVERIFY(!fsConfig.load(files.path("missing"), "system"));
+}
+
+void TestFsConfig::exactPath() {
+    TestFiles files;
+    QVERIFY(files.write("fs_config", FS_CONFIG));
+    YaffsFsConfig fsConfig;
+    QVERIFY(fsConfig.load(files.path("fs_config"), "/system/"));
+
+    //an exact entry wins over the prefix covering it, the mount point is the image root
+    QCOMPARE(applied(fsConfig, "/bin/sh"), QString("0 2000 750"));
+    QCOMPARE(applied(fsConfig, "/"), QString("0 0 755"));
+    QCOMPARE(applied(fsConfig, "/xbin/su"), QString("0 0 6755"));
+}
+
+void TestFsConfig::longestPrefix() {
+    TestFiles files;
+    QVERIFY(files.write("fs_config", FS_CONFIG));
+    YaffsFsConfig fsConfig;
+    QVERIFY(fsConfig.load(files.path("fs_config"), "system"));
+
+    //android names are looked up, root is 0 and shell 2000
+    QCOMPARE(applied(fsConfig, "/bin/ls"), QString("0 2000 755"));
+    QCOMPARE(applied(fsConfig, "/bin/sub/deeper/file"), QString("0 2000 755"));
+
+    //a directory isn't below itself, bin is covered by system/*
+    QCOMPARE(applied(fsConfig, "/bin"), QString("1000 1000 644"));
+    QCOMPARE(applied(fsConfig, "/app/a.apk"), QString("1000 1000 644"));
+    QCOMPARE(applied(fsConfig, "/binary"), QString("1000 1000 644"));
+    QCOMPARE(applied(fsConfig, "/etc"), QString("1000 1000 644"));
+}
+
+void TestFsConfig::bareStar() {
+    TestFiles files;
+    QVERIFY(files.write("fs_config", "* 1 2 0600\ndata/* 3 4 0640\n"));
+    YaffsFsConfig fsConfig;
+    QVERIFY(fsConfig.load(files.path("fs_config"), ""));
+
+    QCOMPARE(applied(fsConfig, "/data/x"), QString("3 4 640"));
+    QCOMPARE(applied(fsConfig, "/other/x"), QString("1 2 600"));
+    QCOMPARE(applied(fsConfig, "/"), QString("1 2 600"));
+}
+
+void TestFsConfig::notCovered() {
+    TestFiles files;
+    QVERIFY(files.write("fs_config", FS_CONFIG));
+    YaffsFsConfig fsConfig;
+    QVERIFY(fsConfig.load(files.path("fs_config"), "vendor"));
+
+    QCOMPARE(applied(fsConfig, "/bin/sh"), QString("none"));
+    QCOMPARE(applied(fsConfig, "/"), QString("none"));
+}
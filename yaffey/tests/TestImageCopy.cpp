@@ -0,0 +1,149 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestImageCopy.h"
+
+//more pages than a block holds, so the big file crosses a block's summary chunk
+static const int PAGES_PER_BLOCK = 64;
+static const int BIG_FILE_SIZE = 100 * CHUNK_SIZE + 7;
+static const int PARTITION_BLOCKS = 16;
+
+static const QByteArray SMALL_DATA = "small file\n";
+
+void TestImageCopy::initTestCase() {
+    mBigData.resize(BIG_FILE_SIZE);
+    for (int i = 0; i < BIG_FILE_SIZE; ++i) {
+        mBigData[i] = static_cast<char>((i * 31) % 251);
+    }
+    QVERIFY(mFiles.makeDir("dir"));
+    QVERIFY(mFiles.write("dir/big", mBigData));
+    QVERIFY(mFiles.write("small", SMALL_DATA));
+
+    //one image is read by its block summaries, the other through its checkpoint
+    YaffsWriteOptions writeOptions = YaffsControl::getDefaultWriteOptions();
+    writeOptions.pagesPerBlock = PAGES_PER_BLOCK;
+    writeOptions.writeSummary = true;
+    QVERIFY(writeSourceImage(mFiles.path("summary.img"), writeOptions));
+
+    writeOptions.partitionBlocks = PARTITION_BLOCKS;
+    writeOptions.writeCheckpoint = true;
+    QVERIFY(writeSourceImage(mFiles.path("checkpoint.img"), writeOptions));
+}
+
+//the copies are saved into a new image and their data read back out of it
+void TestImageCopy::copyScanned() {
+    YaffsModel source;
+    YaffsWriteOptions writeOptions = YaffsControl::getDefaultWriteOptions();
+    writeOptions.pagesPerBlock = PAGES_PER_BLOCK;
+    source.setWriteOptions(writeOptions);
+    QVERIFY(source.openImage(mFiles.path("summary.img")).result);
+    QVERIFY(source.getChunkMap().isEmpty());
+
+    YaffsModel model;
+    model.newImage(mFiles.path("new.img"));
+    QCOMPARE(model.importFromImage(model.itemAtPath("/"), source, "/"), 4);
+
+    YaffsSaveInfo saveInfo;
+    QVERIFY(model.saveAs(mFiles.path("scanned.img"), saveInfo));
+    QCOMPARE(saveInfo.numFilesSaved, 2);
+    QCOMPARE(saveInfo.numSymLinksSaved, 1);
+
+    YaffsModel saved;
+    QVERIFY(saved.openImage(mFiles.path("scanned.img")).result);
+    const YaffsItem* big = saved.itemAtPath("/dir/big");
+    const YaffsItem* small = saved.itemAtPath("/small");
+    const YaffsItem* link = saved.itemAtPath("/dir/link");
+    QVERIFY(big != NULL && small != NULL && link != NULL);
+    QCOMPARE(static_cast<int>(big->getFileSize()), BIG_FILE_SIZE);
+    QVERIFY(extract(mFiles.path("scanned.img"), big) == mBigData);
+    QCOMPARE(extract(mFiles.path("scanned.img"), small), SMALL_DATA);
+    QCOMPARE(link->getAlias(), QString("big"));
+    QCOMPARE(big->getPermissions() & 07777, 0640u);
+}
+
+//a subtree copied by its path, with the chunks found through the source's checkpoint
+void TestImageCopy::copyThroughCheckpoint() {
+    YaffsModel source;
+    YaffsWriteOptions writeOptions = YaffsControl::getDefaultWriteOptions();
+    writeOptions.pagesPerBlock = PAGES_PER_BLOCK;
+    source.setWriteOptions(writeOptions);
+    QVERIFY(source.openImage(mFiles.path("checkpoint.img")).fromCheckpoint);
+    QVERIFY(!source.getChunkMap().isEmpty());
+
+    YaffsModel model;
+    model.newImage(mFiles.path("new.img"));
+    QCOMPARE(model.importFromImage(model.itemAtPath("/"), source, "/dir"), 3);
+
+    YaffsSaveInfo saveInfo;
+    QVERIFY(model.saveAs(mFiles.path("mapped.img"), saveInfo));
+    QCOMPARE(saveInfo.numFilesSaved, 1);
+
+    YaffsModel saved;
+    QVERIFY(saved.openImage(mFiles.path("mapped.img")).result);
+    const YaffsItem* big = saved.itemAtPath("/dir/big");
+    QVERIFY(big != NULL);
+    QVERIFY(saved.itemAtPath("/small") == NULL);
+    QVERIFY(extract(mFiles.path("mapped.img"), big) == mBigData);
+}
+
+//an item isn't copied over one with the same name
+void TestImageCopy::nameTaken() {
+    YaffsModel source;
+    QVERIFY(source.openImage(mFiles.path("summary.img")).result);
+
+    YaffsModel model;
+    model.newImage(mFiles.path("new.img"));
+    QVERIFY(model.importFile(model.itemAtPath("/"), mFiles.path("small")) != NULL);
+    QCOMPARE(model.importFromImage(model.itemAtPath("/"), source, "/small"), 0);
+    QCOMPARE(model.importFromImage(model.itemAtPath("/"), source, "/missing"), 0);
+    QCOMPARE(model.itemAtPath("/")->childCount(), 1);
+}
+
+//small at the root, big and a link to it in dir
+bool TestImageCopy::writeSourceImage(const QString& imageFilename, const YaffsWriteOptions& writeOptions) {
+    YaffsModel model;
+    model.setWriteOptions(writeOptions);
+    model.newImage(imageFilename + ".new");
+    YaffsItem* root = model.itemAtPath("/");
+    model.importDirectory(root, mFiles.path("dir"));
+    YaffsItem* big = model.itemAtPath("/dir/big");
+    if (big == NULL || model.importFile(root, mFiles.path("small")) == NULL ||
+        model.createSymLink("/dir/link", "big", 0, 0, 0777) == NULL) {
+        return false;
+    }
+    big->setPermissions((big->getPermissions() & ~07777) | 0640);
+
+    YaffsSaveInfo saveInfo;
+    return (model.saveAs(imageFilename, saveInfo) && saveInfo.checkpointWritten == writeOptions.writeCheckpoint);
+}
+
+QByteArray TestImageCopy::extract(const QString& imageFilename, const YaffsItem* item) {
+    QByteArray result;
+    YaffsControl yaffsControl(imageFilename.toStdString().c_str(), NULL);
+    if (yaffsControl.open(YaffsControl::OPEN_READ)) {
+        size_t size = 0;
+        char* data = yaffsControl.extractFile(item->getHeaderPosition(), size);
+        if (data) {
+            result = QByteArray(data, static_cast<int>(size));
+            delete [] data;
+        }
+    }
+    return result;
+}
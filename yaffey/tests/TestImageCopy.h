@@ -0,0 +1,45 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef TESTIMAGECOPY_H
+#define TESTIMAGECOPY_H
+
+#include <QObject>
+
+#include "TestFiles.h"
+#include "YaffsModel.h"
+
+class TestImageCopy : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void copyScanned();
+    void copyThroughCheckpoint();
+    void nameTaken();
+
+private:
+    bool writeSourceImage(const QString& imageFilename, const YaffsWriteOptions& writeOptions);
+    static QByteArray extract(const QString& imageFilename, const YaffsItem* item);
+
+private:
+    TestFiles mFiles;
+    QByteArray mBigData;
+};
+
+#endif  //TESTIMAGECOPY_H
@@ -0,0 +1,104 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+#include <QFile>
+
+#include "TestImport.h"
+#include "TestFiles.h"
+#include "YaffsModel.h"
+#include "YaffsImportWalker.h"
+
+//imported files are looked at again when saving, one that has gone is left out and one
+//that has changed is saved as it is now
+void TestImport::missingFiles() {
+    TestFiles files;
+    QVERIFY(files.makeDir("src"));
+    QVERIFY(files.write("src/kept", "kept"));
+    QVERIFY(files.write("src/gone", "gone"));
+    QVERIFY(files.write("src/changed", "changed"));
+
+    YaffsModel model;
+    model.newImage(files.path("new.img"));
+    model.importDirectory(model.itemAtPath("/"), files.path("src"));
+    QVERIFY(model.itemAtPath("/src/gone") != NULL);
+
+    QVERIFY(QFile::remove(files.path("src/gone")));
+    QVERIFY(files.write("src/changed", "changed since the import"));
+
+    YaffsSaveInfo saveInfo;
+    QVERIFY(model.saveAs(files.path("saved.img"), saveInfo));
+    QCOMPARE(saveInfo.numFilesMissing, 1);
+    QCOMPARE(saveInfo.numFilesRefreshed, 1);
+    QCOMPARE(saveInfo.numFilesSaved, 2);
+    QCOMPARE(saveInfo.numFilesFailed, 0);
+
+    YaffsModel saved;
+    QVERIFY(saved.openImage(files.path("saved.img")).result);
+    QVERIFY(saved.itemAtPath("/src/kept") != NULL);
+    QVERIFY(saved.itemAtPath("/src/gone") == NULL);
+    const YaffsItem* changed = saved.itemAtPath("/src/changed");
+    QVERIFY(changed != NULL);
+    QCOMPARE(static_cast<int>(changed->getFileSize()), QByteArray("changed since the import").size());
+    QCOMPARE(saved.itemAtPath("/src")->childCount(), 2);
+}
+
+//deleting a directory that is still being walked, or one above it, drops its import so the
+//walked entries have nowhere to go
+void TestImport::cancelOnDelete() {
+    TestFiles files;
+    QVERIFY(files.makeDir("outer"));
+
+    YaffsModel model;
+    model.newImage(files.path("new.img"));
+    YaffsItem* root = model.itemAtPath("/");
+    model.importDirectory(root, files.path("outer"));
+    YaffsItem* outer = model.itemAtPath("/outer");
+    QVERIFY(outer != NULL);
+
+    int walkedId = model.beginImport(root, "walked");
+    int innerId = model.beginImport(outer, "inner");
+    int keptId = model.beginImport(root, "kept");
+    QCOMPARE(model.getNumPendingImports(), 3);
+    YaffsItem* walked = model.itemAtPath("/walked");
+    QVERIFY(walked != NULL && model.isImportPlaceholder(walked));
+    model.fetchAll();
+
+    QCOMPARE(model.removeRows(QModelIndexList() << model.itemIndex(walked)), 1);
+    QVERIFY(!model.isImportPending(walkedId));
+    QVERIFY(model.isImportPending(innerId));
+
+    QCOMPARE(model.removeRows(QModelIndexList() << model.itemIndex(outer)), 1);
+    QVERIFY(!model.isImportPending(innerId));
+    QCOMPARE(model.getNumPendingImports(), 1);
+
+    YaffsImportEntry dirEntry;
+    dirEntry.name = "walked";
+    dirEntry.path = files.path("outer");
+    dirEntry.isDir = true;
+    QVERIFY(model.finishImport(walkedId, &dirEntry) == NULL);
+    QVERIFY(model.finishImport(innerId, &dirEntry) == NULL);
+    QVERIFY(model.itemAtPath("/walked") == NULL);
+    QVERIFY(model.itemAtPath("/outer") == NULL);
+
+    YaffsItem* kept = model.itemAtPath("/kept");
+    QVERIFY(kept != NULL);
+    QVERIFY(model.finishImport(keptId, &dirEntry) == kept);
+    QVERIFY(!model.isImportPlaceholder(kept));
+    QCOMPARE(model.getNumPendingImports(), 0);
+}
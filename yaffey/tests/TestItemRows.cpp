@@ -0,0 +1,151 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestItemRows.h"
+#include "YaffsModel.h"
+
+static const int NUM_ENTRIES = 100000;
+
+TestItemRows::TestItemRows() {
+    mModel = NULL;
+    mDirItem = NULL;
+}
+
+//the files don't exist locally, nothing is read until the image is saved
+YaffsItem* TestItemRows::createFlatDirectory(YaffsModel& model, int numEntries) {
+    YaffsImportEntry dirEntry;
+    dirEntry.name = "flat";
+    dirEntry.isDir = true;
+    for (int i = 0; i < numEntries; ++i) {
+        YaffsImportEntry* entry = new YaffsImportEntry();
+        entry->name = QString("file%1").arg(i, 6, 10, QChar('0'));
+        entry->path = "/nonexistent/" + entry->name;
+        entry->isDir = false;
+        entry->hostFile.size = i;
+        dirEntry.children.append(entry);
+    }
+
+    model.newImage("flat.img");
+    YaffsItem* dirItem = model.importDirectory(model.itemAtPath("/"), &dirEntry);
+    model.fetchAll();
+    return dirItem;
+}
+
+//every child is at the row it says it is and its parent's index is the directory's
+bool TestItemRows::checkRows(const YaffsModel& model, YaffsItem* dirItem) {
+    QModelIndex dirIndex = model.itemIndex(dirItem);
+    for (int i = 0; i < dirItem->childCount(); ++i) {
+        YaffsItem* item = dirItem->child(i);
+        if (item->row() != i || model.parent(model.itemIndex(item)) != dirIndex) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestItemRows::initTestCase() {
+    mModel = new YaffsModel();
+    mDirItem = createFlatDirectory(*mModel, NUM_ENTRIES);
+    QVERIFY(mDirItem != NULL);
+    QCOMPARE(mDirItem->childCount(), NUM_ENTRIES);
+    QCOMPARE(mModel->rowCount(mModel->itemIndex(mDirItem)), NUM_ENTRIES);
+}
+
+void TestItemRows::cleanupTestCase() {
+    delete mModel;
+    mModel = NULL;
+}
+
+void TestItemRows::benchmarkRow() {
+    qint64 sum = 0;
+    QBENCHMARK {
+        sum = 0;
+        for (int i = 0; i < NUM_ENTRIES; ++i) {
+            sum += mDirItem->child(i)->row();
+        }
+    }
+    QCOMPARE(sum, static_cast<qint64>(NUM_ENTRIES) * (NUM_ENTRIES - 1) / 2);
+}
+
+void TestItemRows::benchmarkParent() {
+    QModelIndex dirIndex = mModel->itemIndex(mDirItem);
+    QModelIndexList indexes;
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        indexes.append(mModel->index(i, 0, dirIndex));
+    }
+
+    int numWrong = 0;
+    QBENCHMARK {
+        numWrong = 0;
+        foreach (const QModelIndex& index, indexes) {
+            if (mModel->parent(index) != dirIndex) {
+                numWrong++;
+            }
+        }
+    }
+    QCOMPARE(numWrong, 0);
+}
+
+//what a view scrolling through the directory does, index() for each row and parent() of that
+void TestItemRows::benchmarkIndex() {
+    QModelIndex dirIndex = mModel->itemIndex(mDirItem);
+    int numWrong = 0;
+    QBENCHMARK {
+        numWrong = 0;
+        for (int i = 0; i < NUM_ENTRIES; ++i) {
+            QModelIndex index = mModel->index(i, YaffsItem::NAME, dirIndex);
+            if (index.row() != i || mModel->parent(index) != dirIndex) {
+                numWrong++;
+            }
+        }
+    }
+    QCOMPARE(numWrong, 0);
+}
+
+//the rows after the ones taken out move up
+void TestItemRows::rowsAfterRemove() {
+    YaffsModel model;
+    YaffsItem* dirItem = createFlatDirectory(model, NUM_ENTRIES);
+    QModelIndex dirIndex = model.itemIndex(dirItem);
+
+    QModelIndexList selectedRows;
+    selectedRows << model.index(0, 0, dirIndex) << model.index(1, 0, dirIndex) << model.index(NUM_ENTRIES / 2, 0, dirIndex) << model.index(NUM_ENTRIES - 1, 0, dirIndex);
+    QCOMPARE(model.removeRows(selectedRows), selectedRows.size());
+
+    QCOMPARE(dirItem->childCount(), NUM_ENTRIES - selectedRows.size());
+    QCOMPARE(dirItem->child(0)->getName(), QString("file000002"));
+    QCOMPARE(model.itemAtPath("/flat/file000003")->row(), 1);
+    QVERIFY(model.itemAtPath("/flat/file050000") == NULL);
+    QVERIFY(checkRows(model, dirItem));
+}
+
+void TestItemRows::rowsAfterSort() {
+    YaffsModel model;
+    YaffsItem* dirItem = createFlatDirectory(model, NUM_ENTRIES);
+
+    model.sort(YaffsItem::NAME, Qt::DescendingOrder);
+    QCOMPARE(dirItem->child(0)->getName(), QString("file099999"));
+    QCOMPARE(model.itemAtPath("/flat/file000000")->row(), NUM_ENTRIES - 1);
+    QVERIFY(checkRows(model, dirItem));
+
+    model.sort(YaffsItem::NAME, Qt::AscendingOrder);
+    QCOMPARE(model.itemAtPath("/flat/file000000")->row(), 0);
+    QVERIFY(checkRows(model, dirItem));
+}
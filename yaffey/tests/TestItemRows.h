@@ -0,0 +1,52 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef TESTITEMROWS_H
+#define TESTITEMROWS_H
+
+#include <QObject>
+
+class YaffsModel;
+class YaffsItem;
+
+//row() and parent() on a directory of 100k files, every index the view asks about goes through them
+class TestItemRows : public QObject {
+    Q_OBJECT
+
+public:
+    TestItemRows();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkRow();
+    void benchmarkParent();
+    void benchmarkIndex();
+    void rowsAfterRemove();
+    void rowsAfterSort();
+
+private:
+    static YaffsItem* createFlatDirectory(YaffsModel& model, int numEntries);
+    static bool checkRows(const YaffsModel& model, YaffsItem* dirItem);
+
+private:
+    YaffsModel* mModel;
+    YaffsItem* mDirItem;
+};
+
+#endif  //TESTITEMROWS_H
@@ -0,0 +1,108 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+#include <QRegExp>
+
+#include "TestNameIndex.h"
+#include "YaffsItem.h"
+
+//names with runs that quantifiers, classes and escapes can make optional
+static const char* const NAMES[] = {
+    "libc.so", "libcutils.so", "libc++.so", "liblog.so", "lib", "libs", "LIBCAPS.SO", "lic.so",
+    "lib0,1c", "libbc", "liiib", "sh", "toolbox", "app_process", "a.b", "axb", "a{b}", "x-y z",
+    "Settings.apk", "framework-res.apk", "build.prop", "file12.txt", "file123.txt", "File1_2.txt"
+};
+static const char* const DIRS[] = { "system", "bin", "lib", "app", "etc", "LibDir" };
+
+void TestNameIndex::initTestCase() {
+    //the same names in a few directories at different depths, so path patterns have subtrees to match
+    mRoot = YaffsItem::createRoot(&mArena);
+    int numDirs = sizeof(DIRS) / sizeof(DIRS[0]);
+    int numNames = sizeof(NAMES) / sizeof(NAMES[0]);
+    YaffsItem* parent = mRoot;
+    for (int i = 0; i < numDirs; ++i) {
+        YaffsItem* dir = YaffsItem::createDirectory(parent, DIRS[i]);
+        parent->appendChild(dir);
+        for (int j = 0; j < numNames; ++j) {
+            dir->appendChild(YaffsItem::createSymLink(dir, NAMES[j], "target"));
+        }
+        parent = (i % 2 == 0 ? dir : mRoot);
+    }
+    mIndex.build(mRoot);
+}
+
+void TestNameIndex::substring() {
+    //a longer substring rechecks the last matches, so these run in the order they're typed
+    compare(QStringList() << "l" << "li" << "lib" << "libc" << "libc." << "libc.so" << "LIBC" << "b" << "xyz"
+                          << "file1" << "file12" << "file123" << "." << "{b}" << "-res" << " z",
+            YaffsNameIndex::MATCH_SUBSTRING);
+}
+
+void TestNameIndex::wildcard() {
+    compare(QStringList() << "*" << "*.so" << "lib*" << "lib*.so" << "*c*" << "lib?.so" << "li?c*" << "lib[cl]*"
+                          << "*[0-9].txt" << "file1?.txt" << "*.SO" << "libc.so" << "a{b}" << "*{*" << "x-y*",
+            YaffsNameIndex::MATCH_WILDCARD);
+}
+
+void TestNameIndex::regex() {
+    compare(QStringList() << "libc" << "^libc\\.so$" << "lib{0,1}c" << "lib{2}c" << "li{1,3}b" << "libc?\\.so"
+                          << "lib.*log" << "libcu?tils" << "lib[cl]o?g?" << "[a-z]+\\d+\\.txt" << "file\\d{2,}"
+                          << "file1+2" << "a\\.b" << "a.b" << "a\\{b\\}" << "(libc|liblog)\\.so" << "(lib)?c\\.so"
+                          << "^s" << "apk$" << "x-y\\sz" << "lib(",
+            YaffsNameIndex::MATCH_REGEX);
+}
+
+void TestNameIndex::paths() {
+    compare(QStringList() << "/system/bin" << "system/bin/lib" << "bin/libc." << "/lib/" << "/LIBDIR/sh",
+            YaffsNameIndex::MATCH_SUBSTRING);
+    compare(QStringList() << "/system/*" << "*/bin/lib*.so" << "*/lib*/a?b" << "/app/*",
+            YaffsNameIndex::MATCH_WILDCARD);
+    compare(QStringList() << "/bin/libc" << "^/system/bin/lib{0,1}c" << "lib/(sh|toolbox)$" << "[bn]/file\\d+\\.txt",
+            YaffsNameIndex::MATCH_REGEX);
+}
+
+//the index has to find exactly the items that checking every one with QRegExp finds, in the same order
+void TestNameIndex::compare(const QStringList& patterns, YaffsNameIndex::MatchMode mode) {
+    foreach (const QString& pattern, patterns) {
+        QList<YaffsItem*> expected;
+        bruteForce(mRoot, pattern, mode, expected);
+        QList<YaffsItem*> found = mIndex.search(pattern, mode);
+        QVERIFY2(found == expected, qPrintable(QString("%1: %2 found, %3 expected").arg(pattern).arg(found.size()).arg(expected.size())));
+    }
+}
+
+void TestNameIndex::bruteForce(YaffsItem* item, const QString& pattern, YaffsNameIndex::MatchMode mode, QList<YaffsItem*>& matches) const {
+    QString text = (pattern.contains('/') ? item->getFullPath() : item->getName());
+    bool match;
+    if (mode == YaffsNameIndex::MATCH_SUBSTRING) {
+        match = text.contains(pattern, Qt::CaseInsensitive);
+    } else if (mode == YaffsNameIndex::MATCH_WILDCARD) {
+        match = QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard).exactMatch(text);
+    } else {
+        QRegExp regExp(pattern, Qt::CaseInsensitive, QRegExp::RegExp2);
+        match = (regExp.isValid() && regExp.indexIn(text) != -1);
+    }
+    if (match) {
+        matches.append(item);
+    }
+
+    for (int i = 0; i < item->childCount(); ++i) {
+        bruteForce(item->child(i), pattern, mode, matches);
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef TESTNAMEINDEX_H
+#define TESTNAMEINDEX_H
+
+#include <QObject>
+#include <QStringList>
+
+#include "YaffsArena.h"
+#include "YaffsNameIndex.h"
+
+class YaffsItem;
+
+class TestNameIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void substring();
+    void wildcard();
+    void regex();
+    void paths();
+
+private:
+    void compare(const QStringList& patterns, YaffsNameIndex::MatchMode mode);
+    void bruteForce(YaffsItem* item, const QString& pattern, YaffsNameIndex::MatchMode mode, QList<YaffsItem*>& matches) const;
+
+private:
+    YaffsArena mArena;
+    YaffsItem* mRoot;
+    YaffsNameIndex mIndex;
+};
+
+#endif  //TESTNAMEINDEX_H
@@ -0,0 +1,159 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtTest>
+
+#include "TestOverlay.h"
+#include "TestFiles.h"
+#include "YaffsOverlay.h"
+
+//the merged tree as sorted relative paths, directories end with a slash
+static void flatten(const YaffsImportEntry* dirEntry, const QString& prefix, QStringList& paths) {
+    foreach (const YaffsImportEntry* entry, dirEntry->children) {
+        QString path = prefix + entry->name;
+        if (entry->isDir) {
+            paths.append(path + "/");
+            flatten(entry, path + "/", paths);
+        } else {
+            paths.append(path);
+        }
+    }
+}
+
+static QStringList flatten(const YaffsOverlay& overlay) {
+    QStringList paths;
+    flatten(overlay.getRoot(), QString(), paths);
+    paths.sort();
+    return paths;
+}
+
+static const YaffsImportEntry* findEntry(const YaffsImportEntry* dirEntry, const QString& path) {
+    const YaffsImportEntry* entry = dirEntry;
+    foreach (const QString& name, path.split('/')) {
+        const YaffsImportEntry* child = NULL;
+        foreach (const YaffsImportEntry* childEntry, entry->children) {
+            if (childEntry->name == name) {
+                child = childEntry;
+            }
+        }
+        if (child == NULL) {
+            return NULL;
+        }
+        entry = child;
+    }
+    return entry;
+}
+
+void TestOverlay::whiteouts() {
+    TestFiles files;
+    QVERIFY(files.write("lower/a/x", "lower"));
+    QVERIFY(files.write("lower/a/y", "lower"));
+    QVERIFY(files.write("lower/b/z", "lower"));
+    QVERIFY(files.write("lower/c/w", "lower"));
+    QVERIFY(files.write("lower/c/sub/w", "lower"));
+    QVERIFY(files.write("upper/.wh.b", ""));
+    QVERIFY(files.write("upper/a/.wh.x", ""));
+    QVERIFY(files.write("upper/c/.wh..wh..opq", ""));
+    QVERIFY(files.write("upper/c/v", "upper"));
+    QVERIFY(files.write("upper/.wh.nothing", ""));
+
+    YaffsOverlay overlay;
+    QVERIFY2(overlay.compose(QStringList() << files.path("lower") << files.path("upper")), qPrintable(overlay.getError()));
+    QCOMPARE(overlay.getLayers().size(), 2);
+    QCOMPARE(overlay.getNumWhiteouts(), 4);
+    QCOMPARE(overlay.getNumReplaced(), 0);
+
+    //the whiteouts themselves aren't in the result either
+    QStringList expected;
+    expected << "a/" << "a/y" << "c/" << "c/v";
+    QCOMPARE(flatten(overlay), expected);
+    QCOMPARE(overlay.getNumEntries(), expected.size());
+}
+
+void TestOverlay::replaced() {
+    TestFiles files;
+    QVERIFY(files.write("lower/a/y", "lower"));
+    QVERIFY(files.write("lower/f", "lower"));
+    QVERIFY(files.write("lower/g/inner", "lower"));
+    QVERIFY(files.write("upper/a/y", "upper"));
+    QVERIFY(files.write("upper/f/inner", "upper"));
+    QVERIFY(files.write("upper/g", "upper"));
+    QVERIFY(files.write("upper/d", "upper"));
+
+    YaffsOverlay overlay;
+    QVERIFY2(overlay.compose(QStringList() << files.path("lower") << files.path("upper")), qPrintable(overlay.getError()));
+    QCOMPARE(overlay.getNumWhiteouts(), 0);
+    QCOMPARE(overlay.getNumReplaced(), 3);
+
+    QStringList expected;
+    expected << "a/" << "a/y" << "d" << "f/" << "f/inner" << "g";
+    QCOMPARE(flatten(overlay), expected);
+
+    //the data of a replaced file comes from the layer that won
+    const YaffsImportEntry* entry = findEntry(overlay.getRoot(), "a/y");
+    QVERIFY(entry != NULL);
+    QCOMPARE(entry->path, files.path("upper/a/y"));
+    QCOMPARE(entry->hostFile.size, 5LL);
+
+    entry = findEntry(overlay.getRoot(), "g");
+    QVERIFY(entry != NULL && !entry->isDir);
+    QCOMPARE(entry->path, files.path("upper/g"));
+}
+
+//a whiteout only takes away what the layers below it have, a layer above can put it back
+void TestOverlay::layerOrder() {
+    TestFiles files;
+    QVERIFY(files.write("1/etc/hosts", "first"));
+    QVERIFY(files.write("1/etc/passwd", "first"));
+    QVERIFY(files.write("2/etc/.wh.hosts", ""));
+    QVERIFY(files.write("2/etc/.wh..wh..opq", ""));
+    QVERIFY(files.write("2/etc/group", "second"));
+    QVERIFY(files.write("3/etc/hosts", "third"));
+
+    YaffsOverlay overlay;
+    QVERIFY2(overlay.compose(QStringList() << files.path("1") << files.path("2") << files.path("3")), qPrintable(overlay.getError()));
+
+    QStringList expected;
+    expected << "etc/" << "etc/group" << "etc/hosts";
+    QCOMPARE(flatten(overlay), expected);
+
+    const YaffsImportEntry* entry = findEntry(overlay.getRoot(), "etc/hosts");
+    QVERIFY(entry != NULL);
+    QCOMPARE(entry->path, files.path("3/etc/hosts"));
+
+    //whiteouts in the lowest layer have nothing to take away
+    YaffsOverlay reversed;
+    QVERIFY(reversed.compose(QStringList() << files.path("3") << files.path("2") << files.path("1")));
+    expected.clear();
+    expected << "etc/" << "etc/group" << "etc/hosts" << "etc/passwd";
+    QCOMPARE(flatten(reversed), expected);
+    entry = findEntry(reversed.getRoot(), "etc/hosts");
+    QVERIFY(entry != NULL);
+    QCOMPARE(entry->path, files.path("1/etc/hosts"));
+}
+
+void TestOverlay::notADirectory() {
+    TestFiles files;
+    QVERIFY(files.makeDir("layer"));
+    QVERIFY(files.write("file", "file"));
+
+    YaffsOverlay overlay;
+    QVERIFY(!overlay.compose(QStringList() << files.path("layer") << files.path("file")));
+    QVERIFY(overlay.getError().contains("not a directory"));
+    QVERIFY(!overlay.compose(QStringList() << files.path("layer") << files.path("missing")));
+}
@@ -0,0 +1,57 @@
+/*
+ * yaffey: Utility for reading, editing and writing YAFFS2 images
+ * Copyright (C) 2012 David Place <david.t.place@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "TestCheckpoint.h"
+#include "TestItemRows.h"
+#include "TestNameIndex.h"
+#include "TestContentSearch.h"
+#include "TestFsConfig.h"
+#include "TestArchive.h"
+#include "TestImageCopy.h"
+#include "TestImport.h"
+#include "TestOverlay.h"
+
+//every test class runs with the same arguments, e.g. -iterations 10 for the benchmarks. the exit
+//code is the number of classes with a failure
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+
+    TestCheckpoint testCheckpoint;
+    TestItemRows testItemRows;
+    TestNameIndex testNameIndex;
+    TestContentSearch testContentSearch;
+    TestFsConfig testFsConfig;
+    TestArchive testArchive;
+    TestImageCopy testImageCopy;
+    TestImport testImport;
+    TestOverlay testOverlay;
+
+    QList<QObject*> tests;
+    tests << &testCheckpoint << &testItemRows << &testNameIndex << &testContentSearch << &testFsConfig << &testArchive << &testImageCopy << &testImport << &testOverlay;
+
+    int failed = 0;
+    foreach (QObject* test, tests) {
+        if (QTest::qExec(test, argc, argv) != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
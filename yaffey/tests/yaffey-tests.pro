@@ -0,0 +1,84 @@
+#-------------------------------------------------
+#
+# Tests and benchmarks, run them with make check
+#
+#-------------------------------------------------
+
+QT         = core testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
+#the content search uses std::regex
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++11
+else: QMAKE_CXXFLAGS += -std=c++11
+
+#gzipped archives are inflated with zlib, on windows the copy built into qt
+unix: LIBS += -lz
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+
+TARGET     = yaffey-tests
+TEMPLATE   = app
+CONFIG    += console testcase
+CONFIG    -= app_bundle
+DEFINES   += QT_NO_DEBUG_OUTPUT
+INCLUDEPATH += ..
+
+SOURCES   += main_tests.cpp \
+    TestFiles.cpp \
+    TestCheckpoint.cpp \
+    TestItemRows.cpp \
+    TestNameIndex.cpp \
+    TestContentSearch.cpp \
+    TestFsConfig.cpp \
+    TestArchive.cpp \
+    TestImageCopy.cpp \
+    TestImport.cpp \
+    TestOverlay.cpp \
+    ../YaffsModel.cpp \
+    ../YaffsItem.cpp \
+    ../YaffsControl.cpp \
+    ../yaffs2/yaffs_packedtags2.c \
+    ../yaffs2/yaffs_hweight.c \
+    ../yaffs2/yaffs_ecc.c \
+    ../yaffs2/yaffs_summary.c \
+    ../Utils.cpp \
+    ../YaffsCheckpoint.cpp \
+    ../YaffsArena.cpp \
+    ../YaffsObjectTable.cpp \
+    ../YaffsNameIndex.cpp \
+    ../YaffsContentSearch.cpp \
+    ../YaffsImportWalker.cpp \
+    ../YaffsFsConfig.cpp \
+    ../YaffsArchive.cpp \
+    ../YaffsGzipDevice.cpp \
+    ../YaffsHostFile.cpp \
+    ../YaffsOverlay.cpp
+
+HEADERS   += \
+    TestFiles.h \
+    TestCheckpoint.h \
+    TestItemRows.h \
+    TestNameIndex.h \
+    TestContentSearch.h \
+    TestFsConfig.h \
+    TestArchive.h \
+    TestImageCopy.h \
+    TestImport.h \
+    TestOverlay.h \
+    ../YaffsModel.h \
+    ../YaffsItem.h \
+    ../YaffsControl.h \
+    ../Yaffs2.h \
+    ../AndroidIDs.h \
+    ../Utils.h \
+    ../YaffsCheckpoint.h \
+    ../YaffsArena.h \
+    ../YaffsObjectTable.h \
+    ../YaffsNameIndex.h \
+    ../YaffsContentSearch.h \
+    ../YaffsImportWalker.h \
+    ../YaffsFsConfig.h \
+    ../YaffsArchive.h \
+    ../YaffsGzipDevice.h \
+    ../YaffsHostFile.h \
+    ../YaffsOverlay.h
@@ -0,0 +1,73 @@
+#-------------------------------------------------
+#
+# Headless command line tool, only needs QtCore
+#
+#-------------------------------------------------
+
+QT         = core xml
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
+#the content search uses std::regex
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++11
+else: QMAKE_CXXFLAGS += -std=c++11
+
+#gzipped archives are inflated with zlib, on windows the copy built into qt
+unix: LIBS += -lz
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+
+TARGET     = yaffey-cli
+TEMPLATE   = app
+CONFIG    += console
+CONFIG    -= app_bundle
+DEFINES   += QT_NO_DEBUG_OUTPUT
+
+SOURCES   += main_cli.cpp \
+    YaffsCli.cpp \
+    YaffsModel.cpp \
+    YaffsItem.cpp \
+    YaffsControl.cpp \
+    yaffs2/yaffs_packedtags2.c \
+    yaffs2/yaffs_hweight.c \
+    yaffs2/yaffs_ecc.c \
+    yaffs2/yaffs_summary.c \
+    Utils.cpp \
+    YaffsCheckpoint.cpp \
+    YaffsArena.cpp \
+    YaffsObjectTable.cpp \
+    YaffsNameIndex.cpp \
+    YaffsContentSearch.cpp \
+    YaffsImportWalker.cpp \
+    YaffsFsConfig.cpp \
+    YaffsArchive.cpp \
+    YaffsGzipDevice.cpp \
+    YaffsHostFile.cpp \
+    YaffsOverlay.cpp \
+    YaffsRecipes.cpp
+
+HEADERS   += \
+    YaffsCli.h \
+    YaffsModel.h \
+    YaffsItem.h \
+    YaffsControl.h \
+    yaffs2/yaffs_trace.h \
+    yaffs2/yaffs_packedtags2.h \
+    yaffs2/yaffs_hweight.h \
+    yaffs2/yaffs_guts.h \
+    yaffs2/yaffs_ecc.h \
+    yaffs2/yaffs_summary.h \
+    AndroidIDs.h \
+    Yaffs2.h \
+    Utils.h \
+    YaffsCheckpoint.h \
+    YaffsArena.h \
+    YaffsObjectTable.h \
+    YaffsNameIndex.h \
+    YaffsContentSearch.h \
+    YaffsImportWalker.h \
+    YaffsFsConfig.h \
+    YaffsArchive.h \
+    YaffsGzipDevice.h \
+    YaffsHostFile.h \
+    YaffsOverlay.h \
+    YaffsRecipes.h
@@ -6,7 +6,15 @@
 
 QT        += core gui xml
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
+
+#the content search uses std::regex
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++11
+else: QMAKE_CXXFLAGS += -std=c++11
+
+#gzipped archives are inflated with zlib, on windows the copy built into qt
+unix: LIBS += -lz
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
 
 TARGET     = yaffey
 TEMPLATE   = app
@@ -22,10 +30,26 @@ SOURCES   += main.cpp\
     yaffs2/yaffs_packedtags2.c \
     yaffs2/yaffs_hweight.c \
     yaffs2/yaffs_ecc.c \
+    yaffs2/yaffs_summary.c \
     DialogFastboot.cpp \
     DialogImport.cpp \
     YaffsManager.cpp \
-    Utils.cpp
+    Utils.cpp \
+    YaffsCheckpoint.cpp \
+    YaffsArena.cpp \
+    YaffsObjectTable.cpp \
+    YaffsNameIndex.cpp \
+    YaffsFilterProxyModel.cpp \
+    YaffsContentSearch.cpp \
+    DialogLargestDirectories.cpp \
+    YaffsImportWalker.cpp \
+    YaffsFsConfig.cpp \
+    YaffsArchive.cpp \
+    YaffsGzipDevice.cpp \
+    YaffsHostFile.cpp \
+    YaffsImportJob.cpp \
+    YaffsOverlay.cpp \
+    YaffsRecipes.cpp
 
 HEADERS   += \
     MainWindow.h \
@@ -39,18 +63,35 @@ HEADERS   += \
     yaffs2/yaffs_hweight.h \
     yaffs2/yaffs_guts.h \
     yaffs2/yaffs_ecc.h \
+    yaffs2/yaffs_summary.h \
     AndroidIDs.h \
     Yaffs2.h \
     DialogFastboot.h \
     DialogImport.h \
     YaffsManager.h \
-    Utils.h
+    Utils.h \
+    YaffsCheckpoint.h \
+    YaffsArena.h \
+    YaffsObjectTable.h \
+    YaffsNameIndex.h \
+    YaffsFilterProxyModel.h \
+    YaffsContentSearch.h \
+    DialogLargestDirectories.h \
+    YaffsImportWalker.h \
+    YaffsFsConfig.h \
+    YaffsArchive.h \
+    YaffsGzipDevice.h \
+    YaffsHostFile.h \
+    YaffsImportJob.h \
+    YaffsOverlay.h \
+    YaffsRecipes.h
 
 FORMS     += \
     MainWindow.ui \
     DialogEditProperties.ui \
     DialogFastboot.ui \
-    DialogImport.ui
+    DialogImport.ui \
+    DialogLargestDirectories.ui
 
 RESOURCES += \
     icons.qrc
@@ -40,6 +40,19 @@ typedef unsigned u32;
 #define YAFFS_OBJECTID_UNLINKED         3
 #define YAFFS_OBJECTID_DELETED          4
 
+/* Pseudo object id used for block summary chunks */
+#define YAFFS_OBJECTID_SUMMARY          0x10
+
+/* Pseudo object id and sequence number used for checkpoint data */
+#define YAFFS_OBJECTID_CHECKPOINT_DATA  0x20
+#define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
+
+#define YAFFS_MAGIC                     0x5941ff53
+
+/* Tnodes map the chunks of a file, the lowest level holds 16 entries */
+#define YAFFS_NTNODES_LEVEL0            16
+#define YAFFS_TNODES_LEVEL0_BITS        4
+
 enum yaffs_ecc_result {
     YAFFS_ECC_RESULT_UNKNOWN,
     YAFFS_ECC_RESULT_NO_ERROR,
@@ -58,6 +71,19 @@ enum yaffs_obj_type {
 
 #define YAFFS_OBJECT_TYPE_MAX           YAFFS_OBJECT_TYPE_SPECIAL
 
+enum yaffs_block_state {
+    YAFFS_BLOCK_STATE_UNKNOWN = 0,
+    YAFFS_BLOCK_STATE_SCANNING,
+    YAFFS_BLOCK_STATE_NEEDS_SCAN,
+    YAFFS_BLOCK_STATE_EMPTY,
+    YAFFS_BLOCK_STATE_ALLOCATING,
+    YAFFS_BLOCK_STATE_FULL,
+    YAFFS_BLOCK_STATE_DIRTY,
+    YAFFS_BLOCK_STATE_CHECKPOINT,
+    YAFFS_BLOCK_STATE_COLLECTING,
+    YAFFS_BLOCK_STATE_DEAD
+};
+
 struct yaffs_ext_tags {
     unsigned chunk_used;	/*  Status of the chunk: used or unused */
     unsigned obj_id;	/* If 0 this is not used */
@@ -0,0 +1,65 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2011 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yaffs_summary.h"
+
+/* Each summary chunk starts with a copy of the header, the tags of all the
+ * data chunks in the block follow on across as many chunks as needed.
+ */
+int yaffs_summary_chunks(int chunks_per_block, int data_bytes_per_chunk)
+{
+	int sum_bytes = chunks_per_block * sizeof(struct yaffs_summary_tags);
+	int sum_bytes_per_chunk =
+	    data_bytes_per_chunk - sizeof(struct yaffs_summary_header);
+
+	return (sum_bytes + sum_bytes_per_chunk - 1) / sum_bytes_per_chunk;
+}
+
+unsigned yaffs_summary_sum(const struct yaffs_summary_tags *sum_tags,
+			   int n_tags)
+{
+	const unsigned char *sum_buffer = (const unsigned char *)sum_tags;
+	int i = sizeof(struct yaffs_summary_tags) * n_tags;
+	unsigned sum = 0;
+
+	while (i > 0) {
+		sum += *sum_buffer;
+		sum_buffer++;
+		i--;
+	}
+	return sum;
+}
+
+void yaffs_summary_add(struct yaffs_summary_tags *sum_tags,
+		       const struct yaffs_ext_tags *t)
+{
+	struct yaffs_packed_tags2_tags_only tags_only;
+
+	yaffs_pack_tags2_tags_only(&tags_only, t);
+	sum_tags->obj_id = tags_only.obj_id;
+	sum_tags->chunk_id = tags_only.chunk_id;
+	sum_tags->n_bytes = tags_only.n_bytes;
+}
+
+void yaffs_summary_fetch(struct yaffs_ext_tags *t,
+			 const struct yaffs_summary_tags *sum_tags,
+			 unsigned seq_number)
+{
+	struct yaffs_packed_tags2_tags_only tags_only;
+
+	tags_only.seq_number = seq_number;
+	tags_only.obj_id = sum_tags->obj_id;
+	tags_only.chunk_id = sum_tags->chunk_id;
+	tags_only.n_bytes = sum_tags->n_bytes;
+	yaffs_unpack_tags2_tags_only(t, &tags_only);
+}
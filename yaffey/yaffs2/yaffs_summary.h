@@ -0,0 +1,50 @@
+/*
+ * YAFFS: Yet another Flash File System . A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2011 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1 as
+ * published by the Free Software Foundation.
+ *
+ * Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
+ */
+
+/* Block summaries hold the tags of every data chunk in a block, written
+ * into the last chunks of the block so a scan can read them in one go.
+ */
+
+#ifndef __YAFFS_SUMMARY_H__
+#define __YAFFS_SUMMARY_H__
+
+#include "yaffs_packedtags2.h"
+
+#define YAFFS_SUMMARY_VERSION	1
+
+struct yaffs_summary_tags {
+	unsigned obj_id;
+	unsigned chunk_id;
+	unsigned n_bytes;
+};
+
+struct yaffs_summary_header {
+	unsigned version;	/* Must match current version */
+	unsigned block;		/* Must be this block */
+	unsigned seq;		/* Must be this sequence number */
+	unsigned sum;		/* Just add up all the bytes in the tags */
+};
+
+/* Number of chunks at the end of each block taken by the summary */
+int yaffs_summary_chunks(int chunks_per_block, int data_bytes_per_chunk);
+
+unsigned yaffs_summary_sum(const struct yaffs_summary_tags *sum_tags,
+			   int n_tags);
+void yaffs_summary_add(struct yaffs_summary_tags *sum_tags,
+		       const struct yaffs_ext_tags *t);
+void yaffs_summary_fetch(struct yaffs_ext_tags *t,
+			 const struct yaffs_summary_tags *sum_tags,
+			 unsigned seq_number);
+#endif